@@ -0,0 +1,407 @@
+/*******************************************************************************
+ * Delta OTA updates
+ * Applies a binary patch made by tools/delta_ota_tool against the running
+ * app partition and streams the result into the inactive OTA slot, so only
+ * the changed parts of the image travel over Wi-Fi. The patch is decoded as a
+ * stream with a fixed ~600 byte state; nothing is buffered beyond that.
+ *
+ * Patch format (all integers are LEB128 varints, seek is zigzag):
+ *   "DOTA" | version | new size | new crc32 | old size | old crc32
+ *   records until new size is reached:
+ *     diff len | extra len | seek
+ *     diff:  { zero run | literal len | literal bytes } ... covering diff len
+ *            (new byte = old byte + diff byte, zero runs are unchanged bytes)
+ *     extra: extra len bytes copied as-is
+ *   seek moves the old pointer before the diff copy (bsdiff style control).
+ *
+ * Usage on the device:
+ *   delta_ota_begin();
+ *   while (...) delta_ota_write(chunk, len);   // e.g. from an HTTPClient stream
+ *   if (delta_ota_end()) ESP.restart();
+ * delta_ota_write() checks the header's base image size and CRC against the
+ * running partition before it decodes any record; on any error it aborts the
+ * OTA slot itself and returns false.
+ ******************************************************************************/
+#ifndef _DELTA_OTA_H
+#define _DELTA_OTA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#define DELTA_OTA_MAGIC "DOTA"
+#define DELTA_OTA_VERSION 1
+#define DELTA_OTA_OLD_CHUNK 256   // old image bytes read from flash at a time
+#define DELTA_OTA_OUT_CHUNK 256   // output bytes handed to the writer at a time
+
+typedef bool (*delta_ota_read_t)(void *ctx, uint32_t offset, uint8_t *buf, size_t len);
+typedef bool (*delta_ota_write_t)(void *ctx, const uint8_t *buf, size_t len);
+
+enum delta_ota_state_t
+{
+    DELTA_OTA_HEADER,
+    DELTA_OTA_CTRL,
+    DELTA_OTA_ZRUN,
+    DELTA_OTA_LLEN,
+    DELTA_OTA_LIT,
+    DELTA_OTA_EXTRA,
+    DELTA_OTA_DONE,
+    DELTA_OTA_ERROR
+};
+
+typedef struct
+{
+    uint8_t state;
+    // header fields
+    uint8_t header_field;
+    uint8_t magic_len;
+    uint32_t new_size, new_crc, old_size, old_crc;
+    // current record
+    uint8_t ctrl_field;
+    uint32_t diff_left, extra_left, lit_left;
+    uint32_t old_pos, new_pos;
+    // varint accumulator
+    uint32_t var;
+    uint8_t var_shift;
+    // old image window
+    uint8_t old_buf[DELTA_OTA_OLD_CHUNK];
+    uint32_t old_buf_pos;
+    size_t old_buf_len;
+    // output staging
+    uint8_t out_buf[DELTA_OTA_OUT_CHUNK];
+    size_t out_len;
+    uint32_t crc;
+    delta_ota_read_t read_old;
+    delta_ota_write_t write_new;
+    void *ctx;
+} delta_ota_t;
+
+static uint32_t delta_ota_crc32(uint32_t crc, const uint8_t *p, size_t len)
+{
+    static const uint32_t nibble[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+    crc = ~crc;
+    while (len--)
+    {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ nibble[crc & 15];
+        crc = (crc >> 4) ^ nibble[crc & 15];
+    }
+    return ~crc;
+}
+
+void delta_ota_init(delta_ota_t *d, delta_ota_read_t read_old, delta_ota_write_t write_new, void *ctx)
+{
+    memset(d, 0, sizeof(*d));
+    d->read_old = read_old;
+    d->write_new = write_new;
+    d->ctx = ctx;
+    d->old_buf_pos = UINT32_MAX;
+}
+
+static bool delta_ota_flush(delta_ota_t *d)
+{
+    if (!d->out_len)
+        return true;
+    d->crc = delta_ota_crc32(d->crc, d->out_buf, d->out_len);
+    bool ok = d->write_new(d->ctx, d->out_buf, d->out_len);
+    d->out_len = 0;
+    return ok;
+}
+
+static bool delta_ota_emit(delta_ota_t *d, uint8_t b)
+{
+    d->out_buf[d->out_len++] = b;
+    d->new_pos++;
+    return d->out_len < DELTA_OTA_OUT_CHUNK || delta_ota_flush(d);
+}
+
+/* Byte of the old image at old_pos, through a small read-ahead window */
+static bool delta_ota_old_byte(delta_ota_t *d, uint8_t *b)
+{
+    uint32_t pos = d->old_pos++;
+    if (pos >= d->old_size)
+    {
+        *b = 0;
+        return true;
+    }
+    if (d->old_buf_pos == UINT32_MAX || pos < d->old_buf_pos || pos >= d->old_buf_pos + d->old_buf_len)
+    {
+        d->old_buf_pos = pos;
+        d->old_buf_len = d->old_size - pos < DELTA_OTA_OLD_CHUNK ? d->old_size - pos : DELTA_OTA_OLD_CHUNK;
+        if (!d->read_old(d->ctx, pos, d->old_buf, d->old_buf_len))
+            return false;
+    }
+    *b = d->old_buf[pos - d->old_buf_pos];
+    return true;
+}
+
+/* Varint accumulator: returns true when a value is complete in d->var */
+static bool delta_ota_varint(delta_ota_t *d, uint8_t b)
+{
+    if (d->var_shift == 0)
+        d->var = 0;
+    // the 5th byte holds bits 28..31: anything above would be cut off
+    if (d->var_shift == 28 && (b & 0x70))
+    {
+        d->state = DELTA_OTA_ERROR;
+        return false;
+    }
+    d->var |= (uint32_t)(b & 0x7F) << d->var_shift;
+    if (b & 0x80)
+    {
+        d->var_shift += 7;
+        if (d->var_shift > 28)
+            d->state = DELTA_OTA_ERROR;
+        return false;
+    }
+    d->var_shift = 0;
+    return true;
+}
+
+static void delta_ota_next_section(delta_ota_t *d)
+{
+    if (d->diff_left)
+        d->state = DELTA_OTA_ZRUN;
+    else if (d->extra_left)
+        d->state = DELTA_OTA_EXTRA;
+    else
+        d->state = d->new_pos >= d->new_size ? DELTA_OTA_DONE : DELTA_OTA_CTRL;
+}
+
+/* Feeds patch bytes; returns false once the patch is invalid or I/O failed */
+bool delta_ota_feed(delta_ota_t *d, const uint8_t *p, size_t len)
+{
+    for (size_t i = 0; i < len && d->state != DELTA_OTA_ERROR; i++)
+    {
+        uint8_t b = p[i];
+        switch (d->state)
+        {
+        case DELTA_OTA_HEADER:
+            if (d->magic_len < 4)
+            {
+                if (b != (uint8_t)DELTA_OTA_MAGIC[d->magic_len++])
+                    d->state = DELTA_OTA_ERROR;
+                break;
+            }
+            if (!delta_ota_varint(d, b))
+                break;
+            switch (d->header_field++)
+            {
+            case 0:
+                if (d->var != DELTA_OTA_VERSION)
+                    d->state = DELTA_OTA_ERROR;
+                break;
+            case 1: d->new_size = d->var; break;
+            case 2: d->new_crc = d->var; break;
+            case 3: d->old_size = d->var; break;
+            case 4:
+                d->old_crc = d->var;
+                d->state = d->new_size ? DELTA_OTA_CTRL : DELTA_OTA_DONE;
+                break;
+            }
+            break;
+
+        case DELTA_OTA_CTRL:
+            if (!delta_ota_varint(d, b))
+                break;
+            switch (d->ctrl_field++)
+            {
+            case 0: d->diff_left = d->var; break;
+            case 1: d->extra_left = d->var; break;
+            case 2:
+                d->old_pos += (uint32_t)((int32_t)(d->var >> 1) ^ -(int32_t)(d->var & 1));
+                d->ctrl_field = 0;
+                if ((uint64_t)d->new_pos + d->diff_left + d->extra_left > d->new_size)
+                    d->state = DELTA_OTA_ERROR;
+                else
+                    delta_ota_next_section(d);
+                break;
+            }
+            break;
+
+        case DELTA_OTA_ZRUN:
+            if (!delta_ota_varint(d, b))
+                break;
+            if (d->var > d->diff_left)
+            {
+                d->state = DELTA_OTA_ERROR;
+                break;
+            }
+            for (uint32_t n = d->var; n; n--)
+            {
+                uint8_t o;
+                if (!delta_ota_old_byte(d, &o) || !delta_ota_emit(d, o))
+                {
+                    d->state = DELTA_OTA_ERROR;
+                    break;
+                }
+            }
+            if (d->state == DELTA_OTA_ERROR)
+                break;
+            d->diff_left -= d->var;
+            if (d->diff_left)
+                d->state = DELTA_OTA_LLEN;
+            else
+                delta_ota_next_section(d);
+            break;
+
+        case DELTA_OTA_LLEN:
+            if (!delta_ota_varint(d, b))
+                break;
+            if (d->var > d->diff_left)
+                d->state = DELTA_OTA_ERROR;
+            else if ((d->lit_left = d->var) != 0)
+                d->state = DELTA_OTA_LIT;
+            else
+                delta_ota_next_section(d);
+            break;
+
+        case DELTA_OTA_LIT:
+        {
+            uint8_t o;
+            if (!delta_ota_old_byte(d, &o) || !delta_ota_emit(d, (uint8_t)(o + b)))
+            {
+                d->state = DELTA_OTA_ERROR;
+                break;
+            }
+            d->diff_left--;
+            if (--d->lit_left == 0)
+                delta_ota_next_section(d);
+            break;
+        }
+
+        case DELTA_OTA_EXTRA:
+            if (!delta_ota_emit(d, b))
+            {
+                d->state = DELTA_OTA_ERROR;
+                break;
+            }
+            if (--d->extra_left == 0)
+                delta_ota_next_section(d);
+            break;
+
+        default:
+            d->state = DELTA_OTA_ERROR; // trailing bytes after the image
+            break;
+        }
+    }
+    return d->state != DELTA_OTA_ERROR;
+}
+
+/* True when the whole image was produced and its CRC matches the header */
+bool delta_ota_finish(delta_ota_t *d)
+{
+    if (d->state != DELTA_OTA_DONE || !delta_ota_flush(d))
+        return false;
+    return d->crc == d->new_crc;
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+
+static delta_ota_t delta_ota;
+static const esp_partition_t *delta_ota_src;
+static const esp_partition_t *delta_ota_dst;
+static esp_ota_handle_t delta_ota_handle;
+static bool delta_ota_open = false;         // delta_ota_handle still needs esp_ota_end/abort
+static bool delta_ota_base_checked;
+
+static bool delta_ota_read_flash(void *, uint32_t offset, uint8_t *buf, size_t len)
+{
+    return esp_partition_read(delta_ota_src, offset, buf, len) == ESP_OK;
+}
+
+static bool delta_ota_write_flash(void *, const uint8_t *buf, size_t len)
+{
+    return esp_ota_write(delta_ota_handle, buf, len) == ESP_OK;
+}
+
+/* Any error: the slot is released here, delta_ota_end() is not needed */
+static bool delta_ota_fail(const char *why)
+{
+    Serial.printf("Delta OTA: %s\n", why);
+    delta_ota.state = DELTA_OTA_ERROR;
+    if (delta_ota_open)
+    {
+        esp_ota_abort(delta_ota_handle);
+        delta_ota_open = false;
+    }
+    return false;
+}
+
+bool delta_ota_begin()
+{
+    delta_ota_src = esp_ota_get_running_partition();
+    delta_ota_dst = esp_ota_get_next_update_partition(NULL);
+    if (!delta_ota_src || !delta_ota_dst)
+        return false;
+    if (esp_ota_begin(delta_ota_dst, OTA_SIZE_UNKNOWN, &delta_ota_handle) != ESP_OK)
+        return false;
+    delta_ota_open = true;
+    delta_ota_init(&delta_ota, delta_ota_read_flash, delta_ota_write_flash, NULL);
+    delta_ota_base_checked = false;
+    return true;
+}
+
+/* The running image must be the patch's base before any record is decoded */
+static bool delta_ota_check_base()
+{
+    if (delta_ota.old_size > delta_ota_src->size)
+        return delta_ota_fail("patch base is larger than the running partition");
+    uint32_t crc = 0;
+    uint8_t chunk[DELTA_OTA_OLD_CHUNK];
+    for (uint32_t pos = 0; pos < delta_ota.old_size; pos += sizeof(chunk))
+    {
+        size_t n = delta_ota.old_size - pos < sizeof(chunk) ? delta_ota.old_size - pos : sizeof(chunk);
+        if (esp_partition_read(delta_ota_src, pos, chunk, n) != ESP_OK)
+            return delta_ota_fail("read error on the running partition");
+        crc = delta_ota_crc32(crc, chunk, n);
+    }
+    if (crc != delta_ota.old_crc)
+        return delta_ota_fail("patch does not match the running image");
+    return true;
+}
+
+bool delta_ota_write(const uint8_t *buf, size_t len)
+{
+    if (!delta_ota_open)
+        return false;
+    size_t i = 0;
+    // header byte by byte: the base check runs before the first record byte
+    while (!delta_ota_base_checked && i < len)
+    {
+        if (!delta_ota_feed(&delta_ota, &buf[i++], 1))
+            return delta_ota_fail("invalid patch header");
+        if (delta_ota.state != DELTA_OTA_HEADER)
+        {
+            delta_ota_base_checked = true;
+            if (!delta_ota_check_base())
+                return false;
+        }
+    }
+    if (i < len && !delta_ota_feed(&delta_ota, buf + i, len - i))
+        return delta_ota_fail("invalid patch or flash write error");
+    return true;
+}
+
+/* Validates the image and marks the new slot bootable */
+bool delta_ota_end()
+{
+    if (!delta_ota_open)
+        return false; // already released by a failed delta_ota_write()
+    if (!delta_ota_finish(&delta_ota))
+        return delta_ota_fail("image incomplete or CRC mismatch");
+    delta_ota_open = false;
+    if (esp_ota_end(delta_ota_handle) != ESP_OK || esp_ota_set_boot_partition(delta_ota_dst) != ESP_OK)
+        return false;
+    Serial.printf("Delta OTA: %u bytes written to %s\n", (unsigned)delta_ota.new_pos, delta_ota_dst->label);
+    return true;
+}
+#endif
+
+#endif // _DELTA_OTA_H
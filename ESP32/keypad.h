@@ -0,0 +1,392 @@
+/*******************************************************************************
+ * 4x3 keypad scanner
+ * Interrupt driven: while idle all rows are driven LOW and the columns wait on
+ * a falling-edge interrupt. Activity starts a 1 ms scan timer that runs a
+ * per-key integrator debounce and pushes timestamped events into a lock-free
+ * single-producer / single-consumer queue. The timer stops again once every
+ * key has settled released, so an idle keypad costs no CPU at all.
+ *
+ * The matrix has no diodes. Any two keys held together are reported
+ * correctly, but three keys on the corners of a rectangle (e.g. 1, 2 and 4)
+ * connect the fourth corner (5) through the floating rows, and it is
+ * reported pressed as well. Combinations beyond two keys are not reliable.
+ *
+ * Usage:
+ *   keypad_init();
+ *   keypad_event_t ev;
+ *   while (keypad_get_event(&ev)) { ... }
+ *
+ * Build without ARDUINO defined to get a simulated GPIO matrix
+ * (keypad_sim_set_key / keypad_sim_advance) for host measurements.
+ ******************************************************************************/
+#ifndef _KEYPAD_H
+#define _KEYPAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <atomic>
+#include "parameters.h"
+
+#define KEYPAD_ROWS 4
+#define KEYPAD_COLS 3
+#define KEYPAD_KEYS (KEYPAD_ROWS * KEYPAD_COLS)
+
+#define KEYPAD_SCAN_PERIOD_MS 1     // scan burst period while a key is active
+#define KEYPAD_INTEGRATOR_MAX 5     // consecutive agreeing samples to change state (~5 ms)
+#define KEYPAD_REPEAT_DELAY_MS 500  // hold time before the first repeat event
+#define KEYPAD_REPEAT_RATE_MS 100   // interval between repeat events
+#define KEYPAD_QUEUE_SIZE 16        // must be a power of two
+
+static const uint8_t keypad_row_pins[KEYPAD_ROWS] = {R1, R2, R3, R4};
+static const uint8_t keypad_col_pins[KEYPAD_COLS] = {C1, C2, C3};
+static const char keypad_keymap[KEYPAD_ROWS][KEYPAD_COLS] = {
+    {'1', '2', '3'},
+    {'4', '5', '6'},
+    {'7', '8', '9'},
+    {'*', '0', '#'}};
+
+enum keypad_event_type_t
+{
+    KEYPAD_PRESS,
+    KEYPAD_RELEASE,
+    KEYPAD_REPEAT
+};
+
+typedef struct
+{
+    char key;
+    uint8_t type;     // keypad_event_type_t
+    uint32_t time_ms; // time the debounced state changed
+} keypad_event_t;
+
+typedef struct
+{
+    uint32_t wakeups;         // column interrupts that started a scan burst
+    uint32_t scans;           // matrix scans performed
+    uint64_t scan_cycles;     // total CPU cycles (ns on host) spent scanning; 32 bits wrap after ~18 s at 240 MHz
+    uint32_t scan_cycles_max; // worst single scan
+    uint32_t latency_ms_max;  // first raw contact -> press event
+    uint32_t dropped;         // events lost to a full queue
+} keypad_stats_t;
+
+/* Hardware layer */
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <driver/gpio.h>
+
+static esp_timer_handle_t keypad_timer;
+
+#define KEYPAD_SETTLE_US 5 // released row: column pull-ups recharge the lines
+
+static inline uint32_t keypad_now_ms() { return millis(); }
+static inline uint32_t keypad_cycles() { return ESP.getCycleCount(); }
+
+static inline void keypad_row_drive(uint8_t row, bool active)
+{
+    // inactive rows float so two keys in one column cannot short two rows
+    if (active)
+    {
+        pinMode(keypad_row_pins[row], OUTPUT);
+        digitalWrite(keypad_row_pins[row], LOW);
+    }
+    else
+    {
+        pinMode(keypad_row_pins[row], INPUT);
+    }
+}
+
+static inline bool keypad_col_active(uint8_t col) { return digitalRead(keypad_col_pins[col]) == LOW; }
+
+static inline void keypad_settle() { delayMicroseconds(KEYPAD_SETTLE_US); }
+
+static inline void keypad_timer_start() { esp_timer_start_once(keypad_timer, KEYPAD_SCAN_PERIOD_MS * 1000); }
+
+#else
+#include <stdio.h>
+#include <time.h>
+
+static uint32_t keypad_sim_time_ms = 0;
+static uint8_t keypad_sim_matrix[KEYPAD_ROWS]; // bit per column, 1 = key closed
+static uint8_t keypad_sim_rows_driven = 0;     // bit per row
+static bool keypad_sim_timer_running = false;
+static bool keypad_sim_irq_enabled = false;
+static uint32_t keypad_sim_next_scan_ms = 0;
+
+static inline uint32_t keypad_now_ms() { return keypad_sim_time_ms; }
+static inline uint32_t keypad_cycles()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+static inline void keypad_row_drive(uint8_t row, bool active)
+{
+    if (active)
+        keypad_sim_rows_driven |= (1 << row);
+    else
+        keypad_sim_rows_driven &= ~(1 << row);
+}
+
+/* A column reads LOW if a closed-key path reaches a driven row; floating rows
+   pass the level on, which is how the real matrix ghosts */
+static inline bool keypad_col_active(uint8_t col)
+{
+    uint8_t rows = keypad_sim_rows_driven, cols = 0;
+    for (uint8_t pass = 0; pass < KEYPAD_ROWS + KEYPAD_COLS; pass++)
+    {
+        for (uint8_t r = 0; r < KEYPAD_ROWS; r++)
+        {
+            if (rows & (1 << r))
+                cols |= keypad_sim_matrix[r];
+            else if (keypad_sim_matrix[r] & cols)
+                rows |= (1 << r);
+        }
+    }
+    return cols & (1 << col);
+}
+
+static inline void keypad_settle() {}
+
+static inline void keypad_timer_start()
+{
+    keypad_sim_timer_running = true;
+    keypad_sim_next_scan_ms = keypad_sim_time_ms + KEYPAD_SCAN_PERIOD_MS;
+}
+#endif
+
+/* Scanner state */
+static uint8_t keypad_integrator[KEYPAD_KEYS];
+static uint16_t keypad_state;                // debounced, bit per key
+static uint16_t keypad_raw_seen;             // raw contact seen but not yet debounced
+static uint32_t keypad_raw_time[KEYPAD_KEYS]; // first raw contact, for latency stats
+static uint32_t keypad_next_repeat[KEYPAD_KEYS];
+static volatile bool keypad_scanning = false;
+static volatile uint32_t keypad_wake_ms;     // column edge that started the burst
+static volatile bool keypad_wake_pending = false;
+static keypad_stats_t keypad_stats;
+
+/* SPSC event queue: scan context produces, loop() consumes */
+static keypad_event_t keypad_queue[KEYPAD_QUEUE_SIZE];
+static std::atomic<uint32_t> keypad_queue_head(0);
+static std::atomic<uint32_t> keypad_queue_tail(0);
+
+static void keypad_push(char key, uint8_t type, uint32_t now)
+{
+    uint32_t head = keypad_queue_head.load(std::memory_order_relaxed);
+    if (head - keypad_queue_tail.load(std::memory_order_acquire) >= KEYPAD_QUEUE_SIZE)
+    {
+        keypad_stats.dropped++;
+        return;
+    }
+    keypad_event_t *ev = &keypad_queue[head & (KEYPAD_QUEUE_SIZE - 1)];
+    ev->key = key;
+    ev->type = type;
+    ev->time_ms = now;
+    keypad_queue_head.store(head + 1, std::memory_order_release);
+}
+
+bool keypad_get_event(keypad_event_t *ev)
+{
+    uint32_t tail = keypad_queue_tail.load(std::memory_order_relaxed);
+    if (tail == keypad_queue_head.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+    *ev = keypad_queue[tail & (KEYPAD_QUEUE_SIZE - 1)];
+    keypad_queue_tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+static void keypad_arm_idle();
+
+/* One scan of the matrix: drive each row in turn and integrate every key */
+static void keypad_scan()
+{
+    uint32_t start = keypad_cycles();
+    uint32_t now = keypad_now_ms();
+    bool busy = false;
+
+    // the first scan of a burst starts with every row still driven from idle
+    for (uint8_t r = 0; r < KEYPAD_ROWS; r++)
+        keypad_row_drive(r, false);
+    keypad_settle();
+
+    for (uint8_t r = 0; r < KEYPAD_ROWS; r++)
+    {
+        keypad_row_drive(r, true);
+        for (uint8_t c = 0; c < KEYPAD_COLS; c++)
+        {
+            uint8_t k = r * KEYPAD_COLS + c;
+            uint16_t bit = 1 << k;
+            bool raw = keypad_col_active(c);
+
+            if (raw && keypad_integrator[k] < KEYPAD_INTEGRATOR_MAX)
+            {
+                if (!(keypad_raw_seen & bit))
+                {
+                    keypad_raw_seen |= bit;
+                    // the edge interrupt already timestamped the first contact
+                    keypad_raw_time[k] = keypad_wake_pending ? keypad_wake_ms : now;
+                }
+                keypad_integrator[k]++;
+            }
+            else if (!raw && keypad_integrator[k] > 0)
+            {
+                keypad_integrator[k]--;
+            }
+
+            if (keypad_integrator[k] == KEYPAD_INTEGRATOR_MAX && !(keypad_state & bit))
+            {
+                keypad_state |= bit;
+                keypad_raw_seen &= ~bit;
+                keypad_next_repeat[k] = now + KEYPAD_REPEAT_DELAY_MS;
+                if (now - keypad_raw_time[k] > keypad_stats.latency_ms_max)
+                    keypad_stats.latency_ms_max = now - keypad_raw_time[k];
+                keypad_push(keypad_keymap[r][c], KEYPAD_PRESS, now);
+            }
+            else if (keypad_integrator[k] == 0 && (keypad_state & bit))
+            {
+                keypad_state &= ~bit;
+                keypad_push(keypad_keymap[r][c], KEYPAD_RELEASE, now);
+            }
+            else if ((keypad_state & bit) && (int32_t)(now - keypad_next_repeat[k]) >= 0)
+            {
+                keypad_next_repeat[k] = now + KEYPAD_REPEAT_RATE_MS;
+                keypad_push(keypad_keymap[r][c], KEYPAD_REPEAT, now);
+            }
+
+            if (keypad_integrator[k] != 0)
+                busy = true;
+        }
+        keypad_row_drive(r, false);
+        keypad_settle();
+    }
+    keypad_wake_pending = false;
+    if (!busy)
+        keypad_raw_seen = 0; // bounce that never reached the threshold
+
+    uint32_t spent = keypad_cycles() - start;
+    keypad_stats.scans++;
+    keypad_stats.scan_cycles += spent;
+    if (spent > keypad_stats.scan_cycles_max)
+        keypad_stats.scan_cycles_max = spent;
+
+    if (busy)
+        keypad_timer_start();
+    else
+        keypad_arm_idle();
+}
+
+/* Column edge: leave idle mode and start a scan burst */
+#ifdef ARDUINO
+static void IRAM_ATTR keypad_col_isr()
+#else
+static void keypad_col_isr()
+#endif
+{
+    if (keypad_scanning)
+        return;
+    keypad_scanning = true;
+    keypad_wake_ms = keypad_now_ms();
+    keypad_wake_pending = true;
+    keypad_stats.wakeups++;
+#ifdef ARDUINO
+    for (uint8_t c = 0; c < KEYPAD_COLS; c++)
+        gpio_intr_disable((gpio_num_t)keypad_col_pins[c]);
+#else
+    keypad_sim_irq_enabled = false;
+#endif
+    // one-shot: each busy scan re-arms it from the esp_timer task
+    keypad_timer_start();
+}
+
+/* Every key settled released: drive all rows and sleep on the columns */
+static void keypad_arm_idle()
+{
+    for (uint8_t r = 0; r < KEYPAD_ROWS; r++)
+        keypad_row_drive(r, true);
+    keypad_scanning = false;
+#ifdef ARDUINO
+    for (uint8_t c = 0; c < KEYPAD_COLS; c++)
+        gpio_intr_enable((gpio_num_t)keypad_col_pins[c]);
+#else
+    keypad_sim_irq_enabled = true;
+#endif
+}
+
+void keypad_init()
+{
+    for (uint8_t c = 0; c < KEYPAD_COLS; c++)
+    {
+#ifdef ARDUINO
+        pinMode(keypad_col_pins[c], INPUT_PULLUP);
+#endif
+    }
+#ifdef ARDUINO
+    esp_timer_create_args_t args = {};
+    args.callback = [](void *) { keypad_scan(); };
+    args.name = "keypad";
+    esp_timer_create(&args, &keypad_timer);
+    // attached once; the ISR and keypad_arm_idle() only mask and unmask them
+    for (uint8_t c = 0; c < KEYPAD_COLS; c++)
+        attachInterrupt(digitalPinToInterrupt(keypad_col_pins[c]), keypad_col_isr, FALLING);
+#endif
+    keypad_arm_idle();
+}
+
+bool keypad_is_pressed(char key)
+{
+    for (uint8_t k = 0; k < KEYPAD_KEYS; k++)
+    {
+        if (keypad_keymap[k / KEYPAD_COLS][k % KEYPAD_COLS] == key)
+            return keypad_state & (1 << k);
+    }
+    return false;
+}
+
+const keypad_stats_t *keypad_get_stats() { return &keypad_stats; }
+
+void keypad_print_stats()
+{
+    const keypad_stats_t *s = keypad_get_stats();
+#ifdef ARDUINO
+    Serial.printf(
+#else
+    printf(
+#endif
+        "keypad: wakeups %u scans %u avg %u max %u cycles, latency max %u ms, dropped %u\n",
+           (unsigned)s->wakeups, (unsigned)s->scans,
+           (unsigned)(s->scans ? s->scan_cycles / s->scans : 0), (unsigned)s->scan_cycles_max,
+           (unsigned)s->latency_ms_max, (unsigned)s->dropped);
+}
+
+#ifndef ARDUINO
+/* Host simulation: close/open a key, then advance virtual time */
+void keypad_sim_set_key(uint8_t row, uint8_t col, bool closed)
+{
+    if (closed)
+        keypad_sim_matrix[row] |= (1 << col);
+    else
+        keypad_sim_matrix[row] &= ~(1 << col);
+    if (closed && keypad_sim_irq_enabled && keypad_col_active(col))
+        keypad_col_isr();
+}
+
+void keypad_sim_advance(uint32_t ms)
+{
+    uint32_t end = keypad_sim_time_ms + ms;
+    while (keypad_sim_time_ms != end)
+    {
+        keypad_sim_time_ms++;
+        if (keypad_sim_timer_running && (int32_t)(keypad_sim_time_ms - keypad_sim_next_scan_ms) >= 0)
+        {
+            keypad_sim_timer_running = false;
+            keypad_scan();
+        }
+    }
+}
+#endif
+
+#endif // _KEYPAD_H
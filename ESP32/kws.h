@@ -0,0 +1,671 @@
+/*******************************************************************************
+ * On-device keyword spotting for the INMP441 microphone
+ * Short commands ("next tab", "stop", ...) are recognised locally so they do
+ * not pay for a round trip to speech.googleapis.com. Anything that sounds like
+ * speech but is not a confident keyword is handed to the cloud path instead.
+ *
+ * Pipeline, all integer at run time:
+ *   16 kHz PCM -> 512-sample Hann window every 20 ms -> block floating point
+ *   radix-2 FFT -> 40 mel bands (20..4000 Hz) -> log2 (Q8) -> DCT -> 10 MFCCs
+ *   49 frames (1 s) of int8 MFCCs -> DS-CNN: conv 10x4/2 + 3 depthwise
+ *   separable blocks + average pool + fully connected -> int8 logits
+ *
+ * The classifier runs every KWS_INFER_HOPS frames, and only while the energy
+ * VAD sees an utterance, so silence costs the front-end alone. Logits are
+ * summed over the last KWS_SMOOTH inferences; a keyword fires when it leads
+ * the runner-up by the model's margin. An utterance that ends without a
+ * keyword is passed to the cloud callback, audio included.
+ *
+ * The window, FFT and log2 come from libraries/q15_dsp, which the spectrum
+ * meter of the touch display sketch shares.
+ *
+ * All NN activations live in a fixed arena (KWS_ARENA_BYTES); weights stay
+ * in flash. Models are trained and exported with tools/kws_tool.cpp:
+ *
+ *   #include "kws_model.h"   // generated: kws_tool header model.kws kws_model.h
+ *   kws_begin(kws_model, sizeof(kws_model), on_keyword, on_cloud);
+ *
+ * On the device kws_begin() also starts the I2S capture task; both callbacks
+ * run on that task and must hand work off instead of blocking. The audio
+ * given to on_cloud points into the capture ring buffer, which the task
+ * overwrites as soon as the callback returns: copy it (e.g. into the upload
+ * task's buffer) before returning, never keep the pointers.
+ * Without ARDUINO, feed audio with kws_process() (host evaluation).
+ ******************************************************************************/
+#ifndef _KWS_H
+#define _KWS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <q15_dsp.h>
+#include "parameters.h"
+
+#define KWS_SAMPLE_RATE 16000
+#define KWS_FFT_BITS 9
+#define KWS_FFT_LEN (1 << KWS_FFT_BITS)   // analysis window, 32 ms
+#define KWS_HOP 320                       // 20 ms
+#define KWS_MEL_BANDS 40
+#define KWS_MEL_LOW_HZ 20
+#define KWS_MEL_HIGH_HZ 4000
+#define KWS_MFCC 10
+#define KWS_FRAMES 49                     // 1 s of context
+
+/* Network shape (the model blob must match) */
+#define KWS_CONV_KT 10
+#define KWS_CONV_KF 4
+#define KWS_T1 ((KWS_FRAMES + 1) / 2)     // after the stride 2 conv: 25 x 5
+#define KWS_F1 ((KWS_MFCC + 1) / 2)
+#define KWS_MAX_CHANNELS 64
+#define KWS_MAX_BLOCKS 4
+#define KWS_MAX_CLASSES 12
+#define KWS_LABEL_LEN 16
+#define KWS_ARENA_BYTES (2 * KWS_T1 * KWS_F1 * KWS_MAX_CHANNELS + KWS_FRAMES * KWS_MFCC)
+
+/* Detection */
+#define KWS_INFER_HOPS 2                  // classify every 40 ms during an utterance
+#define KWS_SMOOTH 3                      // inferences summed before deciding
+#define KWS_SUPPRESS_MS 1000              // no second keyword right after one
+
+/* Energy VAD on the frame log2 energy (Q8: 256 = 3 dB) */
+#define KWS_VAD_MARGIN_Q8 (4 * 256)       // 12 dB over the noise floor
+#define KWS_VAD_START_FRAMES 3
+#define KWS_VAD_HANG_FRAMES 15            // 300 ms of quiet ends an utterance
+#define KWS_MIN_UTTERANCE_MS 200          // shorter blips are not sent to the cloud
+#define KWS_PREROLL_MS 200
+#define KWS_AUDIO_MS 1600                 // utterance audio kept for the cloud fallback
+#define KWS_AUDIO_SAMPLES (KWS_SAMPLE_RATE / 1000 * KWS_AUDIO_MS)
+
+#define KWS_MODEL_MAGIC "KWS1"
+
+typedef void (*kws_keyword_cb_t)(uint8_t id, const char *label);
+/* The utterance as up to two ring buffer segments, oldest first; valid only
+ * until the callback returns, copy them before handing them to another task */
+typedef void (*kws_cloud_cb_t)(const int16_t *a, size_t a_len, const int16_t *b, size_t b_len);
+
+typedef struct
+{
+    uint32_t frames;
+    uint32_t inferences;
+    uint32_t utterances;
+    uint32_t keywords;
+    uint32_t cloud;
+    uint32_t frontend_us;
+    uint32_t nn_us;
+} kws_stats_t;
+
+/* Platform layer */
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <driver/i2s.h>
+static inline uint32_t kws_us() { return micros(); }
+#define KWS_PRINTF Serial.printf
+#else
+#include <stdio.h>
+#include <time.h>
+static inline uint32_t kws_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+#define KWS_PRINTF printf
+#endif
+
+/*******************************************************************************
+ * Front-end
+ ******************************************************************************/
+static int16_t kws_hann[KWS_FFT_LEN];
+static int16_t kws_cos[KWS_FFT_LEN / 2], kws_sin[KWS_FFT_LEN / 2];
+static uint16_t kws_mel_start[KWS_MEL_BANDS];
+static uint8_t kws_mel_len[KWS_MEL_BANDS];
+static uint16_t kws_mel_w[2 * (KWS_FFT_LEN / 2 + 1)];   // Q15, filters back to back
+static int16_t kws_dct[KWS_MFCC][KWS_MEL_BANDS];        // Q15
+static int16_t kws_fft_re[KWS_FFT_LEN], kws_fft_im[KWS_FFT_LEN];
+static bool kws_frontend_ready = false;
+
+static float kws_hz_to_mel(float hz) { return 1127.0f * logf(1.0f + hz / 700.0f); }
+static float kws_mel_to_hz(float mel) { return 700.0f * (expf(mel / 1127.0f) - 1.0f); }
+
+/* Tables are built once with floating point; everything per frame is integer */
+void kws_frontend_init()
+{
+    if (kws_frontend_ready)
+        return;
+    const float pi = 3.14159265358979f;
+    q15_hann(kws_hann, KWS_FFT_LEN);
+    q15_twiddles(kws_cos, kws_sin, KWS_FFT_LEN);
+
+    float lo = kws_hz_to_mel(KWS_MEL_LOW_HZ), hi = kws_hz_to_mel(KWS_MEL_HIGH_HZ);
+    float bin_hz = (float)KWS_SAMPLE_RATE / KWS_FFT_LEN;
+    uint16_t used = 0;
+    for (int m = 0; m < KWS_MEL_BANDS; m++)
+    {
+        float left = kws_mel_to_hz(lo + (hi - lo) * m / (KWS_MEL_BANDS + 1)) / bin_hz;
+        float centre = kws_mel_to_hz(lo + (hi - lo) * (m + 1) / (KWS_MEL_BANDS + 1)) / bin_hz;
+        float right = kws_mel_to_hz(lo + (hi - lo) * (m + 2) / (KWS_MEL_BANDS + 1)) / bin_hz;
+        int first = (int)ceilf(left), last = (int)floorf(right);
+        kws_mel_start[m] = (uint16_t)first;
+        kws_mel_len[m] = 0;
+        for (int k = first; k <= last && used < sizeof(kws_mel_w) / sizeof(kws_mel_w[0]); k++)
+        {
+            float w = k <= centre ? (k - left) / (centre - left) : (right - k) / (right - centre);
+            kws_mel_w[used++] = (uint16_t)lrintf(32767.0f * (w < 0 ? 0 : w));
+            kws_mel_len[m]++;
+        }
+        if (!kws_mel_len[m])
+        {
+            // low bands are narrower than one FFT bin: take the nearest bin
+            kws_mel_start[m] = (uint16_t)lrintf(centre);
+            kws_mel_w[used++] = 32767;
+            kws_mel_len[m] = 1;
+        }
+    }
+    for (int j = 0; j < KWS_MFCC; j++)
+        for (int m = 0; m < KWS_MEL_BANDS; m++)
+            kws_dct[j][m] = (int16_t)lrintf(32767.0f * cosf(pi * j * (m + 0.5f) / KWS_MEL_BANDS));
+    kws_frontend_ready = true;
+}
+
+/* One analysis window -> MFCCs and frame energy, both log2 Q8 */
+void kws_mfcc(const int16_t *window, int32_t *mfcc, int32_t *log_energy)
+{
+    int16_t *re = kws_fft_re, *im = kws_fft_im;
+    int32_t peak = 0;
+    for (uint16_t i = 0; i < KWS_FFT_LEN; i++)
+    {
+        re[i] = (int16_t)((window[i] * kws_hann[i] + (1 << 14)) >> 15);
+        im[i] = 0;
+        int32_t a = re[i] < 0 ? -re[i] : re[i];
+        peak = a > peak ? a : peak;
+    }
+    // use the full int16 range before the FFT: quiet input keeps its precision
+    int exp = 0;
+    if (peak)
+    {
+        while (peak < 6786)
+        {
+            peak <<= 1;
+            exp--;
+        }
+        for (uint16_t i = 0; i < KWS_FFT_LEN && exp; i++)
+            re[i] = (int16_t)(re[i] * (1 << -exp));
+        exp += q15_fft(re, im, KWS_FFT_BITS, kws_cos, kws_sin, Q15_FFT_BLOCK_FLOAT);
+    }
+
+    static uint32_t power[KWS_FFT_LEN / 2 + 1];
+    uint64_t total = 0;
+    for (uint16_t k = 0; k <= KWS_FFT_LEN / 2; k++)
+    {
+        power[k] = peak ? (uint32_t)(re[k] * re[k]) + (uint32_t)(im[k] * im[k]) : 0;
+        total += power[k];
+    }
+    // log of the true energy, floored at 1 (an all-zero window)
+    int32_t e = q15_log2_q8(total + 1) + 2 * exp * 256;
+    *log_energy = e > 0 ? e : 0;
+
+    int32_t lm[KWS_MEL_BANDS];
+    const uint16_t *w = kws_mel_w;
+    for (uint8_t m = 0; m < KWS_MEL_BANDS; m++)
+    {
+        uint64_t acc = 0;
+        for (uint8_t k = 0; k < kws_mel_len[m]; k++)
+            acc += (uint64_t)power[kws_mel_start[m] + k] * *w++;
+        int32_t v = q15_log2_q8((acc >> 15) + 1) + 2 * exp * 256;
+        lm[m] = v > 0 ? v : 0;
+    }
+    for (uint8_t j = 0; j < KWS_MFCC; j++)
+    {
+        int64_t acc = 0;
+        for (uint8_t m = 0; m < KWS_MEL_BANDS; m++)
+            acc += (int64_t)lm[m] * kws_dct[j][m];
+        mfcc[j] = (int32_t)(acc >> 15);
+    }
+}
+
+/*******************************************************************************
+ * Quantized DS-CNN
+ * Blob layout (little endian, sections padded to 4 bytes):
+ *   "KWS1" classes channels blocks margin
+ *   labels[classes][KWS_LABEL_LEN]
+ *   input  offset[KWS_MFCC] i32, mult[KWS_MFCC] i32, shift[KWS_MFCC] i8
+ *   layer  weights i8, bias[out] i32, mult[out] i32, shift[out] i8
+ *          for conv1, then dw/pw per block, pool (no weights), fc
+ * Activations are int8 with zero point 0; mult/shift requantize an int32
+ * accumulator: y = acc * mult / 2^(31 + shift), rounded.
+ ******************************************************************************/
+typedef struct
+{
+    const int8_t *w;
+    const uint8_t *bias; // i32[out], unaligned
+    const uint8_t *mult; // i32[out]
+    const int8_t *shift;
+    uint16_t out;
+} kws_layer_t;
+
+typedef struct
+{
+    uint8_t classes;
+    uint8_t channels;
+    uint8_t blocks;
+    uint8_t margin;      // int8 logit lead a keyword needs, per inference
+    const char *labels;
+    kws_layer_t input;   // bias = per-MFCC offset
+    kws_layer_t conv1;
+    kws_layer_t dw[KWS_MAX_BLOCKS];
+    kws_layer_t pw[KWS_MAX_BLOCKS];
+    kws_layer_t pool;
+    kws_layer_t fc;
+} kws_model_t;
+
+static inline int32_t kws_rd32(const uint8_t *p, uint16_t i)
+{
+    int32_t v;
+    memcpy(&v, p + 4 * i, 4);
+    return v;
+}
+
+static inline int32_t kws_requant(int32_t acc, int32_t mult, int8_t shift)
+{
+    int s = 31 + shift;
+    int64_t v = (int64_t)acc * mult;
+    return (int32_t)((v + ((int64_t)1 << (s - 1))) >> s);
+}
+
+static inline int8_t kws_sat8(int32_t v, int32_t lo)
+{
+    return (int8_t)(v < lo ? lo : v > 127 ? 127 : v);
+}
+
+static bool kws_parse_layer(const uint8_t *blob, size_t len, size_t *pos, uint32_t weights, uint16_t out, kws_layer_t *l)
+{
+    size_t need = ((weights + 3) & ~3u) + 8u * out + ((out + 3) & ~3u);
+    if (*pos + need > len)
+        return false;
+    l->w = (const int8_t *)(blob + *pos);
+    *pos += (weights + 3) & ~3u;
+    l->bias = blob + *pos;
+    *pos += 4u * out;
+    l->mult = blob + *pos;
+    *pos += 4u * out;
+    l->shift = (const int8_t *)(blob + *pos);
+    *pos += (out + 3) & ~3u;
+    l->out = out;
+    for (uint16_t i = 0; i < out; i++)
+        if (l->shift[i] < -30 || l->shift[i] > 31)
+            return false;
+    return true;
+}
+
+bool kws_model_parse(const uint8_t *blob, size_t len, kws_model_t *m)
+{
+    if (len < 8 || memcmp(blob, KWS_MODEL_MAGIC, 4))
+        return false;
+    m->classes = blob[4];
+    m->channels = blob[5];
+    m->blocks = blob[6];
+    m->margin = blob[7];
+    if (!m->classes || m->classes > KWS_MAX_CLASSES || !m->channels || m->channels > KWS_MAX_CHANNELS ||
+        m->blocks > KWS_MAX_BLOCKS)
+        return false;
+    size_t pos = 8;
+    m->labels = (const char *)(blob + pos);
+    pos += (size_t)m->classes * KWS_LABEL_LEN;
+    uint8_t c = m->channels;
+    bool ok = kws_parse_layer(blob, len, &pos, 0, KWS_MFCC, &m->input) &&
+              kws_parse_layer(blob, len, &pos, (uint32_t)c * KWS_CONV_KT * KWS_CONV_KF, c, &m->conv1);
+    for (uint8_t b = 0; ok && b < m->blocks; b++)
+        ok = kws_parse_layer(blob, len, &pos, (uint32_t)c * 9, c, &m->dw[b]) &&
+             kws_parse_layer(blob, len, &pos, (uint32_t)c * c, c, &m->pw[b]);
+    ok = ok && kws_parse_layer(blob, len, &pos, 0, 1, &m->pool) &&
+         kws_parse_layer(blob, len, &pos, (uint32_t)m->classes * c, m->classes, &m->fc);
+    return ok && pos == len;
+}
+
+/* MACs per inference, for the CPU budget */
+uint32_t kws_model_macs(const kws_model_t *m)
+{
+    uint32_t px = KWS_T1 * KWS_F1, c = m->channels;
+    return px * c * KWS_CONV_KT * KWS_CONV_KF + m->blocks * px * c * (9 + c) + m->classes * c;
+}
+
+static int8_t kws_arena[KWS_ARENA_BYTES];
+
+/* int32 MFCCs -> int8 network input */
+static inline int8_t kws_quantize_input(const kws_model_t *m, uint8_t j, int32_t mfcc)
+{
+    const kws_layer_t *l = &m->input;
+    return kws_sat8(kws_requant(mfcc - kws_rd32(l->bias, j), kws_rd32(l->mult, j), l->shift[j]), -127);
+}
+
+/* in: KWS_FRAMES x KWS_MFCC int8, oldest frame first; logits: m->classes */
+void kws_infer(const kws_model_t *m, const int8_t *in, int8_t *logits)
+{
+    const uint8_t C = m->channels;
+    int8_t *a = kws_arena + KWS_FRAMES * KWS_MFCC, *b = a + KWS_T1 * KWS_F1 * KWS_MAX_CHANNELS;
+
+    // conv 10x4, stride 2, same padding -> a[T1][F1][C]
+    const int pad_t = ((KWS_T1 - 1) * 2 + KWS_CONV_KT - KWS_FRAMES) / 2;
+    const int pad_f = ((KWS_F1 - 1) * 2 + KWS_CONV_KF - KWS_MFCC) / 2;
+    for (int t = 0; t < KWS_T1; t++)
+        for (int f = 0; f < KWS_F1; f++)
+            for (uint8_t o = 0; o < C; o++)
+            {
+                const int8_t *w = m->conv1.w + o * KWS_CONV_KT * KWS_CONV_KF;
+                int32_t acc = kws_rd32(m->conv1.bias, o);
+                for (int kt = 0; kt < KWS_CONV_KT; kt++)
+                {
+                    int it = t * 2 - pad_t + kt;
+                    if (it < 0 || it >= KWS_FRAMES)
+                        continue;
+                    for (int kf = 0; kf < KWS_CONV_KF; kf++)
+                    {
+                        int jf = f * 2 - pad_f + kf;
+                        if (jf >= 0 && jf < KWS_MFCC)
+                            acc += in[it * KWS_MFCC + jf] * w[kt * KWS_CONV_KF + kf];
+                    }
+                }
+                a[(t * KWS_F1 + f) * C + o] = kws_sat8(kws_requant(acc, kws_rd32(m->conv1.mult, o), m->conv1.shift[o]), 0);
+            }
+
+    for (uint8_t blk = 0; blk < m->blocks; blk++)
+    {
+        // depthwise 3x3, same padding: a -> b
+        const kws_layer_t *dw = &m->dw[blk];
+        for (int t = 0; t < KWS_T1; t++)
+            for (int f = 0; f < KWS_F1; f++)
+                for (uint8_t ch = 0; ch < C; ch++)
+                {
+                    int32_t acc = kws_rd32(dw->bias, ch);
+                    for (int dt = -1; dt <= 1; dt++)
+                        for (int df = -1; df <= 1; df++)
+                        {
+                            int it = t + dt, jf = f + df;
+                            if (it >= 0 && it < KWS_T1 && jf >= 0 && jf < KWS_F1)
+                                acc += a[(it * KWS_F1 + jf) * C + ch] * dw->w[ch * 9 + (dt + 1) * 3 + df + 1];
+                        }
+                    b[(t * KWS_F1 + f) * C + ch] = kws_sat8(kws_requant(acc, kws_rd32(dw->mult, ch), dw->shift[ch]), 0);
+                }
+        // pointwise 1x1: b -> a
+        const kws_layer_t *pw = &m->pw[blk];
+        for (int p = 0; p < KWS_T1 * KWS_F1; p++)
+        {
+            const int8_t *x = b + p * C;
+            for (uint8_t o = 0; o < C; o++)
+            {
+                const int8_t *w = pw->w + o * C;
+                int32_t acc = kws_rd32(pw->bias, o);
+                for (uint8_t ch = 0; ch < C; ch++)
+                    acc += x[ch] * w[ch];
+                a[p * C + o] = kws_sat8(kws_requant(acc, kws_rd32(pw->mult, o), pw->shift[o]), 0);
+            }
+        }
+    }
+
+    // average pool -> b[C], fully connected -> logits
+    for (uint8_t ch = 0; ch < C; ch++)
+    {
+        int32_t acc = 0;
+        for (int p = 0; p < KWS_T1 * KWS_F1; p++)
+            acc += a[p * C + ch];
+        b[ch] = kws_sat8(kws_requant(acc, kws_rd32(m->pool.mult, 0), m->pool.shift[0]), 0);
+    }
+    for (uint8_t k = 0; k < m->classes; k++)
+    {
+        const int8_t *w = m->fc.w + k * C;
+        int32_t acc = kws_rd32(m->fc.bias, k);
+        for (uint8_t ch = 0; ch < C; ch++)
+            acc += b[ch] * w[ch];
+        logits[k] = kws_sat8(kws_requant(acc, kws_rd32(m->fc.mult, k), m->fc.shift[k]), -128);
+    }
+}
+
+static inline const char *kws_label(const kws_model_t *m, uint8_t k) { return m->labels + k * KWS_LABEL_LEN; }
+
+/* Labels starting with '_' (_unknown_, _silence_) are not commands */
+static inline bool kws_is_keyword(const kws_model_t *m, uint8_t k) { return kws_label(m, k)[0] != '_'; }
+
+/*******************************************************************************
+ * Streaming detector
+ ******************************************************************************/
+static kws_model_t kws_model_info;
+static bool kws_model_ok = false;
+static kws_keyword_cb_t kws_on_keyword = NULL;
+static kws_cloud_cb_t kws_on_cloud = NULL;
+static kws_stats_t kws_stats;
+
+static int16_t kws_window[KWS_FFT_LEN];
+static uint16_t kws_fill = 0;                           // new samples since the last frame
+static int8_t kws_feat[KWS_FRAMES][KWS_MFCC];           // ring of quantized frames
+static uint8_t kws_feat_head = 0;                       // oldest frame
+static int16_t kws_audio[KWS_AUDIO_SAMPLES];
+static uint32_t kws_samples = 0;                        // samples seen so far
+
+static int32_t kws_noise_floor = -1;
+static uint8_t kws_speech_run = 0, kws_quiet_run = 0;
+static bool kws_in_utterance = false, kws_matched = false;
+static uint32_t kws_utt_start = 0;                      // sample index
+static uint32_t kws_suppress_until = 0;
+static uint32_t kws_hops = 0;
+static int8_t kws_hist[KWS_SMOOTH][KWS_MAX_CLASSES];
+static uint8_t kws_hist_count = 0;
+
+/* Features of a silent window, so the first inferences see a full second */
+static void kws_reset_features()
+{
+    int16_t zero[KWS_FFT_LEN] = {0};
+    int32_t mfcc[KWS_MFCC], e;
+    kws_mfcc(zero, mfcc, &e);
+    for (uint8_t t = 0; t < KWS_FRAMES; t++)
+        for (uint8_t j = 0; j < KWS_MFCC; j++)
+            kws_feat[t][j] = kws_quantize_input(&kws_model_info, j, mfcc[j]);
+    kws_feat_head = 0;
+}
+
+bool kws_load_model(const uint8_t *blob, size_t len)
+{
+    kws_frontend_init();
+    kws_model_ok = kws_model_parse(blob, len, &kws_model_info);
+    if (kws_model_ok)
+        kws_reset_features();
+    return kws_model_ok;
+}
+
+static void kws_end_utterance()
+{
+    kws_in_utterance = false;
+    uint32_t start = kws_utt_start;
+    if (kws_samples - start > KWS_AUDIO_SAMPLES)
+        start = kws_samples - KWS_AUDIO_SAMPLES;
+    uint32_t len = kws_samples - start;
+    if (kws_matched || len < KWS_SAMPLE_RATE / 1000 * KWS_MIN_UTTERANCE_MS)
+        return;
+    kws_stats.cloud++;
+    if (kws_on_cloud)
+    {
+        uint32_t a = start % KWS_AUDIO_SAMPLES, a_len = KWS_AUDIO_SAMPLES - a < len ? KWS_AUDIO_SAMPLES - a : len;
+        kws_on_cloud(&kws_audio[a], a_len, kws_audio, len - a_len);
+    }
+}
+
+static void kws_classify_stream()
+{
+    const kws_model_t *m = &kws_model_info;
+    int8_t *in = kws_arena;
+    for (uint8_t t = 0; t < KWS_FRAMES; t++)
+        memcpy(in + t * KWS_MFCC, kws_feat[(kws_feat_head + t) % KWS_FRAMES], KWS_MFCC);
+    uint32_t t0 = kws_us();
+    kws_infer(m, in, kws_hist[kws_hist_count % KWS_SMOOTH]);
+    kws_stats.nn_us += kws_us() - t0;
+    kws_stats.inferences++;
+    if (++kws_hist_count < KWS_SMOOTH || (int32_t)(kws_samples - kws_suppress_until) < 0)
+        return;
+
+    int16_t sum[KWS_MAX_CLASSES] = {0};
+    for (uint8_t k = 0; k < m->classes; k++)
+        for (uint8_t i = 0; i < KWS_SMOOTH; i++)
+            sum[k] += kws_hist[i][k];
+    uint8_t best = 0;
+    for (uint8_t k = 1; k < m->classes; k++)
+        if (sum[k] > sum[best])
+            best = k;
+    int16_t second = -128 * KWS_SMOOTH;
+    for (uint8_t k = 0; k < m->classes; k++)
+        if (k != best && sum[k] > second)
+            second = sum[k];
+    if (kws_is_keyword(m, best) && sum[best] - second >= m->margin * KWS_SMOOTH)
+    {
+        kws_matched = true;
+        kws_stats.keywords++;
+        kws_suppress_until = kws_samples + KWS_SAMPLE_RATE / 1000 * KWS_SUPPRESS_MS;
+        if (kws_on_keyword)
+            kws_on_keyword(best, kws_label(m, best));
+    }
+}
+
+static void kws_frame()
+{
+    int32_t mfcc[KWS_MFCC], e;
+    uint32_t t0 = kws_us();
+    kws_mfcc(kws_window, mfcc, &e);
+    for (uint8_t j = 0; j < KWS_MFCC; j++)
+        kws_feat[kws_feat_head][j] = kws_quantize_input(&kws_model_info, j, mfcc[j]);
+    kws_feat_head = (kws_feat_head + 1) % KWS_FRAMES;
+    kws_stats.frontend_us += kws_us() - t0;
+    kws_stats.frames++;
+    kws_hops++;
+
+    // noise floor: follows dips quickly, rises slowly (~2.5 s)
+    if (kws_noise_floor < 0)
+        kws_noise_floor = e;
+    else if (e < kws_noise_floor)
+        kws_noise_floor += (e - kws_noise_floor) / 4;
+    else
+        kws_noise_floor += (e - kws_noise_floor) / 128;
+    bool speech = e > kws_noise_floor + KWS_VAD_MARGIN_Q8;
+
+    if (!kws_in_utterance)
+    {
+        kws_speech_run = speech ? kws_speech_run + 1 : 0;
+        if (kws_speech_run >= KWS_VAD_START_FRAMES)
+        {
+            uint32_t back = kws_speech_run * KWS_HOP + KWS_FFT_LEN + KWS_SAMPLE_RATE / 1000 * KWS_PREROLL_MS;
+            kws_utt_start = kws_samples > back ? kws_samples - back : 0;
+            kws_in_utterance = true;
+            kws_matched = false;
+            kws_quiet_run = 0;
+            kws_hist_count = 0;
+            kws_stats.utterances++;
+        }
+    }
+    else
+    {
+        kws_quiet_run = speech ? 0 : kws_quiet_run + 1;
+        if (kws_hops % KWS_INFER_HOPS == 0)
+            kws_classify_stream();
+        if (kws_quiet_run >= KWS_VAD_HANG_FRAMES || kws_samples - kws_utt_start >= KWS_AUDIO_SAMPLES)
+            kws_end_utterance();
+    }
+}
+
+/* Feed 16 kHz mono PCM; callbacks fire from inside this call */
+void kws_process(const int16_t *samples, size_t n)
+{
+    if (!kws_model_ok)
+        return;
+    for (size_t i = 0; i < n; i++)
+    {
+        kws_audio[kws_samples % KWS_AUDIO_SAMPLES] = samples[i];
+        kws_samples++;
+        kws_window[KWS_FFT_LEN - KWS_HOP + kws_fill] = samples[i];
+        if (++kws_fill == KWS_HOP)
+        {
+            kws_frame();
+            memmove(kws_window, kws_window + KWS_HOP, (KWS_FFT_LEN - KWS_HOP) * sizeof(int16_t));
+            kws_fill = 0;
+        }
+    }
+}
+
+/* Flushes an utterance still open at the end of the input */
+void kws_flush()
+{
+    if (kws_in_utterance)
+        kws_end_utterance();
+}
+
+void kws_print_stats()
+{
+    uint32_t audio_s = kws_stats.frames / (KWS_SAMPLE_RATE / KWS_HOP);
+    KWS_PRINTF("KWS,%u,%u,%u,%u,%u,%u,%u\n", (unsigned)kws_stats.frames, (unsigned)kws_stats.inferences,
+               (unsigned)kws_stats.utterances, (unsigned)kws_stats.keywords, (unsigned)kws_stats.cloud,
+               (unsigned)(audio_s ? kws_stats.frontend_us / audio_s : 0), (unsigned)(audio_s ? kws_stats.nn_us / audio_s : 0));
+}
+
+/*******************************************************************************
+ * INMP441 capture (device only)
+ ******************************************************************************/
+#ifdef ARDUINO
+#define KWS_I2S_SHIFT 14         // 24-bit left-justified samples -> int16 with some gain
+#define KWS_TASK_STACK 4096
+
+static void kws_capture_task(void *)
+{
+    static int32_t raw[KWS_HOP];
+    static int16_t pcm[KWS_HOP];
+    for (;;)
+    {
+        size_t got = 0;
+        if (i2s_read(I2S_PORT, raw, sizeof(raw), &got, portMAX_DELAY) != ESP_OK)
+            continue;
+        size_t n = got / sizeof(int32_t);
+        for (size_t i = 0; i < n; i++)
+        {
+            int32_t v = raw[i] >> KWS_I2S_SHIFT;
+            pcm[i] = (int16_t)(v < -32768 ? -32768 : v > 32767 ? 32767 : v);
+        }
+        kws_process(pcm, n);
+    }
+}
+
+bool kws_begin(const uint8_t *model, size_t len, kws_keyword_cb_t on_keyword, kws_cloud_cb_t on_cloud)
+{
+    kws_on_keyword = on_keyword;
+    kws_on_cloud = on_cloud;
+    if (!kws_load_model(model, len))
+        return false;
+
+    i2s_config_t cfg = {};
+    cfg.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX);
+    cfg.sample_rate = KWS_SAMPLE_RATE;
+    cfg.bits_per_sample = I2S_BITS_PER_SAMPLE_32BIT;
+    cfg.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;  // INMP441 L/R pin tied low
+    cfg.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+    cfg.dma_buf_count = 4;
+    cfg.dma_buf_len = KWS_HOP;
+    i2s_pin_config_t pins = {};
+#ifdef ESP_IDF_VERSION_VAL
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 4, 0)
+    pins.mck_io_num = I2S_PIN_NO_CHANGE; // zero would route MCLK to GPIO0
+#endif
+#endif
+    pins.bck_io_num = I2S_SCK;
+    pins.ws_io_num = I2S_WS;
+    pins.data_out_num = I2S_PIN_NO_CHANGE;
+    pins.data_in_num = I2S_SD;
+    if (i2s_driver_install(I2S_PORT, &cfg, 0, NULL) != ESP_OK || i2s_set_pin(I2S_PORT, &pins) != ESP_OK)
+        return false;
+    return xTaskCreatePinnedToCore(kws_capture_task, "kws", KWS_TASK_STACK, NULL, 2, NULL, 0) == pdPASS;
+}
+#else
+bool kws_begin(const uint8_t *model, size_t len, kws_keyword_cb_t on_keyword, kws_cloud_cb_t on_cloud)
+{
+    kws_on_keyword = on_keyword;
+    kws_on_cloud = on_cloud;
+    return kws_load_model(model, len);
+}
+#endif
+
+#endif // _KWS_H
@@ -0,0 +1,385 @@
+/*******************************************************************************
+ * Host tool for delta OTA patches (see ../delta_ota.h)
+ *
+ * Build:  g++ -O2 -I.. delta_ota_tool.cpp -o delta_ota_tool
+ *
+ *   delta_ota_tool diff  old.bin new.bin patch.dota
+ *   delta_ota_tool apply old.bin patch.dota out.bin
+ *   delta_ota_tool check [old.bin new.bin]
+ *
+ * old.bin / new.bin are the app images from the Arduino build folder
+ * (Sketch > Export Compiled Binary). "diff" prints the patch size next to the
+ * full image; "apply" runs the same streaming decoder as the device, feeding
+ * it in 1 KB network-sized chunks, and prints the apply time and the decoder
+ * memory so releases can be compared (delta_ota_eval.txt).
+ * "check" is the regression test: make -> apply -> byte compare on built-in
+ * images (small edits, insertions, empty old, empty new) and on old/new if
+ * given, plus malformed patches the decoder must reject. One line per case,
+ *   CHECK,<case>,<old bytes>,<new bytes>,<patch bytes>,PASS|FAIL
+ * and a non-zero exit if any case fails.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "delta_ota.h"
+
+#define MIN_MATCH 16        // shorter matches cost more in control bytes than they save
+#define HASH_WINDOW 8
+#define MAX_GAP_SCORE 32    // stop extending once the score fell this far below its best
+#define FEED_CHUNK 1024
+
+typedef std::vector<uint8_t> bytes_t;
+
+static bool read_file(const char *path, bytes_t &out)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        perror(path);
+        return false;
+    }
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        out.insert(out.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+static bool write_file(const char *path, const bytes_t &data)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f)
+    {
+        perror(path);
+        return false;
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    fclose(f);
+    return ok;
+}
+
+static void put_varint(bytes_t &out, uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+static uint32_t hash_window(const uint8_t *p, uint32_t bits)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return (uint32_t)((v * 0x9E3779B97F4A7C15ULL) >> (64 - bits));
+}
+
+/* Approximate forward match of new[pos..] against old[opos..]: the length
+ * with the best score, where a matching byte scores 1 and a mismatch -2 */
+static uint32_t extend_match(const bytes_t &o, uint32_t opos, const bytes_t &n, uint32_t pos, uint32_t *matches)
+{
+    int32_t score = 0, best = 0;
+    uint32_t best_len = 0, best_matches = 0, m = 0;
+    for (uint32_t i = 0; opos + i < o.size() && pos + i < n.size(); i++)
+    {
+        if (o[opos + i] == n[pos + i])
+        {
+            score++;
+            m++;
+        }
+        else
+        {
+            score -= 2;
+        }
+        if (score > best)
+        {
+            best = score;
+            best_len = i + 1;
+            best_matches = m;
+        }
+        else if (score < best - MAX_GAP_SCORE)
+        {
+            break;
+        }
+    }
+    *matches = best_matches;
+    return best_len;
+}
+
+struct record_t
+{
+    uint32_t new_start, old_start, diff_len, extra_len;
+};
+
+static void encode_diff(bytes_t &out, const bytes_t &o, uint32_t opos, const bytes_t &n, uint32_t pos, uint32_t len)
+{
+    uint32_t i = 0;
+    while (i < len)
+    {
+        uint32_t z = 0;
+        while (i + z < len && (uint8_t)(n[pos + i + z] - o[opos + i + z]) == 0)
+            z++;
+        put_varint(out, z);
+        i += z;
+        if (i == len)
+            break;
+        // literal run ends at the first run of 3+ unchanged bytes
+        uint32_t l = 0;
+        while (i + l < len)
+        {
+            uint32_t zeros = 0;
+            while (zeros < 3 && i + l + zeros < len && n[pos + i + l + zeros] == o[opos + i + l + zeros])
+                zeros++;
+            if (zeros == 3 || i + l + zeros == len)
+                break;
+            l += zeros + 1;
+        }
+        put_varint(out, l);
+        for (uint32_t k = 0; k < l; k++)
+            out.push_back((uint8_t)(n[pos + i + k] - o[opos + i + k]));
+        i += l;
+    }
+}
+
+static bytes_t make_patch(const bytes_t &o, const bytes_t &n)
+{
+    // index every 8-byte window of the old image (latest position wins)
+    uint32_t bits = 16;
+    while ((1u << bits) < o.size() && bits < 26)
+        bits++;
+    std::vector<uint32_t> table(1u << bits, UINT32_MAX);
+    for (uint32_t i = 0; i + HASH_WINDOW <= o.size(); i++)
+        table[hash_window(&o[i], bits)] = i;
+
+    std::vector<record_t> recs;
+    record_t cur = {0, 0, 0, 0};
+    int64_t last_offset = 0;
+    uint32_t pos = 0;
+    while (pos < n.size())
+    {
+        // candidate 1 keeps the previous alignment (code after an insertion)
+        // candidate 2 is whatever the hash index knows about this window
+        uint32_t best_len = 0, best_old = 0, best_matches = 0;
+        int64_t c1 = (int64_t)pos + last_offset;
+        if (c1 >= 0 && c1 < (int64_t)o.size())
+        {
+            uint32_t m, len = extend_match(o, (uint32_t)c1, n, pos, &m);
+            if (m >= MIN_MATCH)
+            {
+                best_len = len;
+                best_old = (uint32_t)c1;
+                best_matches = m;
+            }
+        }
+        if (pos + HASH_WINDOW <= n.size())
+        {
+            uint32_t c2 = table[hash_window(&n[pos], bits)];
+            if (c2 != UINT32_MAX && c2 != c1 && memcmp(&o[c2], &n[pos], HASH_WINDOW) == 0)
+            {
+                uint32_t m, len = extend_match(o, c2, n, pos, &m);
+                if (m >= MIN_MATCH && m > best_matches)
+                {
+                    best_len = len;
+                    best_old = c2;
+                    best_matches = m;
+                }
+            }
+        }
+        if (!best_len)
+        {
+            pos++; // literal: becomes part of the current record's extra bytes
+            continue;
+        }
+        cur.extra_len = pos - (cur.new_start + cur.diff_len);
+        recs.push_back(cur);
+        cur = {pos, best_old, best_len, 0};
+        last_offset = (int64_t)best_old - pos;
+        pos += best_len;
+    }
+    cur.extra_len = (uint32_t)n.size() - (cur.new_start + cur.diff_len);
+    recs.push_back(cur);
+
+    bytes_t out(DELTA_OTA_MAGIC, DELTA_OTA_MAGIC + 4);
+    put_varint(out, DELTA_OTA_VERSION);
+    put_varint(out, (uint32_t)n.size());
+    put_varint(out, delta_ota_crc32(0, n.data(), n.size()));
+    put_varint(out, (uint32_t)o.size());
+    put_varint(out, delta_ota_crc32(0, o.data(), o.size()));
+
+    uint32_t old_ptr = 0;
+    for (const record_t &r : recs)
+    {
+        if (!r.diff_len && !r.extra_len)
+            continue;
+        int32_t seek = r.diff_len ? (int32_t)(r.old_start - old_ptr) : 0;
+        put_varint(out, r.diff_len);
+        put_varint(out, r.extra_len);
+        put_varint(out, ((uint32_t)seek << 1) ^ (uint32_t)(seek >> 31));
+        old_ptr += seek;
+        encode_diff(out, o, old_ptr, n, r.new_start, r.diff_len);
+        old_ptr += r.diff_len;
+        out.insert(out.end(), n.begin() + r.new_start + r.diff_len, n.begin() + r.new_start + r.diff_len + r.extra_len);
+    }
+    return out;
+}
+
+/* Host I/O for the device decoder */
+struct apply_ctx_t
+{
+    const bytes_t *old_image;
+    bytes_t *out;
+    uint32_t reads;
+};
+
+static bool host_read(void *ctx, uint32_t offset, uint8_t *buf, size_t len)
+{
+    apply_ctx_t *c = (apply_ctx_t *)ctx;
+    if (offset + len > c->old_image->size())
+        return false;
+    memcpy(buf, c->old_image->data() + offset, len);
+    c->reads++;
+    return true;
+}
+
+static bool host_write(void *ctx, const uint8_t *buf, size_t len)
+{
+    apply_ctx_t *c = (apply_ctx_t *)ctx;
+    c->out->insert(c->out->end(), buf, buf + len);
+    return true;
+}
+
+static double now_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* Streams patch into the device decoder in FEED_CHUNK pieces */
+static bool apply_patch(const bytes_t &old_image, const bytes_t &patch, bytes_t &out, uint32_t *reads,
+                        delta_ota_t *d)
+{
+    apply_ctx_t ctx = {&old_image, &out, 0};
+    delta_ota_init(d, host_read, host_write, &ctx);
+    bool ok = true;
+    for (size_t i = 0; ok && i < patch.size(); i += FEED_CHUNK)
+        ok = delta_ota_feed(d, &patch[i], patch.size() - i < FEED_CHUNK ? patch.size() - i : FEED_CHUNK);
+    ok = ok && delta_ota_finish(d);
+    *reads = ctx.reads;
+    return ok;
+}
+
+static int failures = 0;
+
+static void check_case(const char *name, const bytes_t &o, const bytes_t &n)
+{
+    static delta_ota_t d;
+    bytes_t patch = make_patch(o, n), out;
+    uint32_t reads;
+    bool ok = apply_patch(o, patch, out, &reads, &d) && out == n;
+    printf("CHECK,%s,%zu,%zu,%zu,%s\n", name, o.size(), n.size(), patch.size(), ok ? "PASS" : "FAIL");
+    failures += !ok;
+}
+
+/* A patch the decoder must refuse */
+static void check_reject(const char *name, const bytes_t &o, const bytes_t &patch)
+{
+    static delta_ota_t d;
+    bytes_t out;
+    uint32_t reads;
+    bool ok = !apply_patch(o, patch, out, &reads, &d);
+    printf("CHECK,%s,%zu,-,%zu,%s\n", name, o.size(), patch.size(), ok ? "PASS" : "FAIL");
+    failures += !ok;
+}
+
+static int cmd_check(const bytes_t *old_file, const bytes_t *new_file)
+{
+    // code-like image: a few hundred distinct 64-byte "functions" repeated with variations
+    srand(1);
+    bytes_t base(200000);
+    for (size_t i = 0; i < base.size(); i++)
+        base[i] = (uint8_t)(i % 64 < 48 ? (i / 64 % 300) * 7 + i % 64 : rand());
+
+    bytes_t edited = base;
+    memcpy(&edited[100000], "Tab 1 renamed   ", 16);
+    bytes_t inserted(base.begin(), base.begin() + 50000);
+    for (int i = 0; i < 1000; i++)
+        inserted.push_back((uint8_t)rand());
+    inserted.insert(inserted.end(), base.begin() + 50000, base.end());
+    bytes_t empty;
+
+    check_case("identical", base, base);
+    check_case("label_edit", base, edited);
+    check_case("insert_1k", base, inserted);
+    check_case("truncate", base, bytes_t(base.begin(), base.begin() + 150000));
+    check_case("empty_old", empty, base);
+    check_case("empty_new", base, empty);
+    check_case("both_empty", empty, empty);
+    if (old_file && new_file)
+        check_case("files", *old_file, *new_file);
+
+    bytes_t patch = make_patch(base, edited);
+    check_reject("truncated_patch", base, bytes_t(patch.begin(), patch.end() - 1));
+    bytes_t bad_crc = patch;
+    bad_crc[bad_crc.size() - 1] ^= 1; // last byte of the image is an extra byte: CRC mismatch
+    check_reject("corrupt_patch", base, bad_crc);
+    check_reject("trailing_bytes", base, [&] { bytes_t p = patch; p.push_back(0); return p; }());
+    // new size 2^32 + 1 as a 5-byte varint: must not wrap to 1
+    const uint8_t overflow[] = {'D', 'O', 'T', 'A', 1, 0x81, 0x80, 0x80, 0x80, 0x10, 0, 0, 0};
+    check_reject("varint_overflow", base, bytes_t(overflow, overflow + sizeof(overflow)));
+
+    printf("%s: %d failed checks\n", failures ? "FAIL" : "PASS", failures);
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    bool check = argc >= 2 && !strcmp(argv[1], "check") && (argc == 2 || argc == 4);
+    if (!check && (argc != 5 || (strcmp(argv[1], "diff") && strcmp(argv[1], "apply"))))
+    {
+        fprintf(stderr, "usage: %s diff old.bin new.bin patch.dota\n"
+                        "       %s apply old.bin patch.dota out.bin\n"
+                        "       %s check [old.bin new.bin]\n", argv[0], argv[0], argv[0]);
+        return 2;
+    }
+
+    bytes_t a, b;
+    if (argc >= 4 && (!read_file(argv[2], a) || !read_file(argv[3], b)))
+        return 1;
+    if (check)
+        return argc == 4 ? cmd_check(&a, &b) : cmd_check(NULL, NULL);
+
+    if (!strcmp(argv[1], "diff"))
+    {
+        double t0 = now_ms();
+        bytes_t patch = make_patch(a, b);
+        double t1 = now_ms();
+        if (!write_file(argv[4], patch))
+            return 1;
+        printf("old %zu bytes, new %zu bytes, patch %zu bytes (%.1f%% of new), %.0f ms\n",
+               a.size(), b.size(), patch.size(), 100.0 * patch.size() / (b.size() ? b.size() : 1), t1 - t0);
+        return 0;
+    }
+
+    bytes_t out;
+    uint32_t reads;
+    static delta_ota_t d;
+    double t0 = now_ms();
+    bool ok = apply_patch(a, b, out, &reads, &d);
+    double t1 = now_ms();
+
+    if (!ok)
+    {
+        fprintf(stderr, "patch failed to apply (state %u at output byte %u)\n", d.state, (unsigned)d.new_pos);
+        return 1;
+    }
+    if (!write_file(argv[4], out))
+        return 1;
+    printf("applied %zu byte patch -> %zu bytes in %.1f ms, %u flash reads, decoder state %zu bytes + %d byte feed buffer\n",
+           b.size(), out.size(), t1 - t0, reads, sizeof(delta_ota_t), FEED_CHUNK);
+    return 0;
+}
@@ -0,0 +1,176 @@
+/*******************************************************************************
+ * Host test for the keypad scanner (see ../keypad.h)
+ *
+ * Build:  g++ -O2 -I.. keypad_test.cpp -o keypad_test
+ *
+ *   keypad_test
+ *
+ * Runs the scanner against the simulated matrix on a virtual 1 ms clock:
+ * single presses (only the pressed key may integrate), contact bounce,
+ * auto-repeat, two keys held together and the three-key ghost of a matrix
+ * without diodes. Prints the press-to-event latency and the scan cost, and
+ * exits non-zero if any check fails.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "keypad.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                     \
+    do                                       \
+    {                                        \
+        if (!(cond))                         \
+        {                                    \
+            printf("FAIL %s: ", #cond);      \
+            printf(__VA_ARGS__);             \
+            printf("\n");                    \
+            failures++;                      \
+        }                                    \
+    } while (0)
+
+static uint16_t key_bit(uint8_t row, uint8_t col) { return 1 << (row * KEYPAD_COLS + col); }
+
+/* Drains the queue; returns the number of events of the given type */
+static int drain(uint8_t type, char *keys = NULL)
+{
+    keypad_event_t ev;
+    int n = 0;
+    while (keypad_get_event(&ev))
+    {
+        if (ev.type != type)
+            continue;
+        if (keys)
+            keys[n] = ev.key;
+        n++;
+    }
+    if (keys)
+        keys[n] = 0;
+    return n;
+}
+
+static void release_all()
+{
+    for (uint8_t r = 0; r < KEYPAD_ROWS; r++)
+        for (uint8_t c = 0; c < KEYPAD_COLS; c++)
+            keypad_sim_set_key(r, c, false);
+    keypad_sim_advance(20);
+    drain(KEYPAD_RELEASE);
+}
+
+/* Every key on its own: the first scan must only see that key, and the press
+   must arrive after the integrator count */
+static void test_single_presses()
+{
+    for (uint8_t r = 0; r < KEYPAD_ROWS; r++)
+    {
+        for (uint8_t c = 0; c < KEYPAD_COLS; c++)
+        {
+            uint32_t t0 = keypad_now_ms();
+            keypad_sim_set_key(r, c, true);
+            CHECK(keypad_sim_timer_running, "key %c did not wake the scanner", keypad_keymap[r][c]);
+            keypad_sim_advance(KEYPAD_SCAN_PERIOD_MS);
+            CHECK(keypad_raw_seen == key_bit(r, c), "key %c: raw_seen 0x%03x after the first scan",
+                  keypad_keymap[r][c], keypad_raw_seen);
+
+            char keys[KEYPAD_QUEUE_SIZE + 1];
+            uint32_t t = 0;
+            while (!drain(KEYPAD_PRESS, keys) && t++ < 50)
+                keypad_sim_advance(1);
+            uint32_t latency = keypad_now_ms() - t0;
+            CHECK(keys[0] == keypad_keymap[r][c] && !keys[1], "key %c: pressed \"%s\"", keypad_keymap[r][c], keys);
+            CHECK(latency <= KEYPAD_INTEGRATOR_MAX * KEYPAD_SCAN_PERIOD_MS, "key %c: %u ms to the press event",
+                  keypad_keymap[r][c], (unsigned)latency);
+
+            keypad_sim_set_key(r, c, false);
+            keypad_sim_advance(20);
+            CHECK(drain(KEYPAD_RELEASE) == 1, "key %c: no release event", keypad_keymap[r][c]);
+            CHECK(!keypad_sim_timer_running && keypad_sim_irq_enabled, "key %c: scanner did not go idle",
+                  keypad_keymap[r][c]);
+        }
+    }
+}
+
+/* Contact chatter shorter than the integrator: one press, no release in between */
+static void test_bounce()
+{
+    for (int i = 0; i < 6; i++)
+    {
+        keypad_sim_set_key(1, 1, (i & 1) == 0);
+        keypad_sim_advance(1);
+    }
+    keypad_sim_set_key(1, 1, true);
+    keypad_sim_advance(20);
+    CHECK(drain(KEYPAD_PRESS) == 1, "bounce: press count");
+    keypad_sim_set_key(1, 1, false);
+    keypad_sim_advance(20);
+    CHECK(drain(KEYPAD_RELEASE) == 1, "bounce: release count");
+
+    // a glitch that never reaches the threshold produces nothing
+    keypad_sim_set_key(2, 2, true);
+    keypad_sim_advance(1);
+    keypad_sim_set_key(2, 2, false);
+    keypad_sim_advance(20);
+    CHECK(drain(KEYPAD_PRESS) == 0, "glitch: press reported");
+    CHECK(!keypad_sim_timer_running, "glitch: scanner still running");
+}
+
+static void test_repeat()
+{
+    keypad_sim_set_key(0, 1, true);
+    keypad_sim_advance(KEYPAD_REPEAT_DELAY_MS + 3 * KEYPAD_REPEAT_RATE_MS + 10);
+    keypad_event_t ev;
+    int presses = 0, repeats = 0;
+    while (keypad_get_event(&ev))
+    {
+        presses += ev.type == KEYPAD_PRESS;
+        repeats += ev.type == KEYPAD_REPEAT;
+    }
+    CHECK(presses == 1 && repeats == 4, "repeat: %d presses, %d repeats", presses, repeats);
+    release_all();
+}
+
+/* Any two keys are resolved; three rectangle corners ghost the fourth */
+static void test_two_keys_and_ghost()
+{
+    for (uint8_t a = 0; a < KEYPAD_KEYS; a++)
+    {
+        for (uint8_t b = a + 1; b < KEYPAD_KEYS; b++)
+        {
+            keypad_sim_set_key(a / KEYPAD_COLS, a % KEYPAD_COLS, true);
+            keypad_sim_set_key(b / KEYPAD_COLS, b % KEYPAD_COLS, true);
+            keypad_sim_advance(20);
+            CHECK(keypad_state == ((1 << a) | (1 << b)), "keys %c+%c: state 0x%03x",
+                  keypad_keymap[a / KEYPAD_COLS][a % KEYPAD_COLS], keypad_keymap[b / KEYPAD_COLS][b % KEYPAD_COLS],
+                  keypad_state);
+            drain(KEYPAD_PRESS);
+            release_all();
+        }
+    }
+
+    keypad_sim_set_key(0, 0, true); // 1
+    keypad_sim_set_key(0, 1, true); // 2
+    keypad_sim_set_key(1, 0, true); // 4
+    keypad_sim_advance(20);
+    char keys[KEYPAD_QUEUE_SIZE + 1];
+    drain(KEYPAD_PRESS, keys);
+    CHECK(keypad_is_pressed('5'), "ghost: documented ghost key 5 not seen (pressed \"%s\")", keys);
+    printf("keys 1+2+4 held: pressed \"%s\" (5 is the documented ghost)\n", keys);
+    release_all();
+}
+
+int main()
+{
+    keypad_init();
+    CHECK(keypad_sim_rows_driven == (1 << KEYPAD_ROWS) - 1 && keypad_sim_irq_enabled, "idle state after init");
+
+    test_single_presses();
+    test_bounce();
+    test_repeat();
+    test_two_keys_and_ghost();
+
+    keypad_print_stats();
+    CHECK(!keypad_get_stats()->dropped, "events dropped");
+    printf("%s: %d failed checks\n", failures ? "FAIL" : "PASS", failures);
+    return failures ? 1 : 0;
+}
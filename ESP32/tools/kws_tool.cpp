@@ -0,0 +1,1010 @@
+/*******************************************************************************
+ * Host tool for the keyword spotter (see ../kws.h)
+ *
+ * Build:  g++ -O2 -I.. -I../../libraries/q15_dsp/src kws_tool.cpp -o kws_tool
+ *
+ *   kws_tool train  train.csv model.kws [epochs] [channels]
+ *   kws_tool eval   model.kws test.csv
+ *   kws_tool header model.kws ../kws_model.h
+ *   kws_tool synth  dir [clips per class]
+ *
+ * A .csv lists one labelled clip per line: "path/to/clip.wav,label", paths
+ * relative to the .csv. Clips are 16 kHz 16-bit mono WAV of about one second
+ * (the Speech Commands layout works as is). Every distinct label becomes a
+ * class; labels starting with '_' (_unknown_, _silence_) are non-commands,
+ * whose utterances go to the cloud.
+ *
+ * train  computes features with the device front-end, trains a float DS-CNN,
+ *        then quantizes it to int8 with per-channel weight scales and
+ *        activation ranges calibrated on the training set.
+ * eval   runs the int8 model through the device code twice: once per clip
+ *        (classifier accuracy), once streaming each clip between a second
+ *        of its own background noise (what the device would do: keyword
+ *        accuracy, false accepts, cloud fallbacks), and reports the CPU
+ *        time per second of audio.
+ * header writes the model as a C array for the firmware.
+ * synth  writes a synthetic train.csv / test.csv set (vowel sequences as
+ *        keywords, see cmd_synth()) for checking the pipeline without a
+ *        dataset; kws_eval.txt has its commands and results.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "kws.h"
+
+#define CLIP_SAMPLES KWS_SAMPLE_RATE
+#define SHIFT_MAX (KWS_SAMPLE_RATE / 4)    // +-250 ms time shift augmentation
+#define INPUT_RANGE 4.0f                   // normalised MFCCs are clipped to +-4 sigma
+#define BATCH 32
+#define LEARNING_RATE 0.002f
+#define MARGIN_LOGITS 3.0f                 // keyword must lead by this much (float logits)
+
+typedef std::vector<int16_t> pcm_t;
+
+struct clip_t
+{
+    std::string path;
+    int label;
+    pcm_t pcm;
+};
+
+/*******************************************************************************
+ * Data
+ ******************************************************************************/
+static bool read_wav(const std::string &path, pcm_t &out)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f)
+    {
+        perror(path.c_str());
+        return false;
+    }
+    uint8_t hdr[12];
+    bool ok = fread(hdr, 1, 12, f) == 12 && !memcmp(hdr, "RIFF", 4) && !memcmp(hdr + 8, "WAVE", 4);
+    bool fmt_ok = false;
+    while (ok)
+    {
+        uint8_t ch[8];
+        if (fread(ch, 1, 8, f) != 8)
+            break;
+        uint32_t size = ch[4] | ch[5] << 8 | ch[6] << 16 | (uint32_t)ch[7] << 24;
+        if (!memcmp(ch, "fmt ", 4))
+        {
+            uint8_t fmt[16];
+            ok = size >= 16 && fread(fmt, 1, 16, f) == 16;
+            uint16_t format = fmt[0] | fmt[1] << 8, channels = fmt[2] | fmt[3] << 8, bits = fmt[14] | fmt[15] << 8;
+            uint32_t rate = fmt[4] | fmt[5] << 8 | fmt[6] << 16 | (uint32_t)fmt[7] << 24;
+            fmt_ok = ok && format == 1 && channels == 1 && bits == 16 && rate == KWS_SAMPLE_RATE;
+            fseek(f, size - 16 + (size & 1), SEEK_CUR);
+        }
+        else if (!memcmp(ch, "data", 4))
+        {
+            out.resize(size / 2);
+            ok = fread(out.data(), 2, out.size(), f) == out.size();
+            break;
+        }
+        else
+        {
+            fseek(f, size + (size & 1), SEEK_CUR);
+        }
+    }
+    fclose(f);
+    if (!ok || !fmt_ok)
+        fprintf(stderr, "%s: need 16 kHz 16-bit mono PCM\n", path.c_str());
+    return ok && fmt_ok;
+}
+
+static bool read_csv(const char *csv, std::vector<clip_t> &clips, std::vector<std::string> &labels)
+{
+    FILE *f = fopen(csv, "r");
+    if (!f)
+    {
+        perror(csv);
+        return false;
+    }
+    std::string dir(csv);
+    dir = dir.find('/') == std::string::npos ? "" : dir.substr(0, dir.rfind('/') + 1);
+    std::vector<std::pair<std::string, std::string>> rows;
+    char line[1024];
+    while (fgets(line, sizeof(line), f))
+    {
+        char *comma = strrchr(line, ',');
+        if (!comma)
+            continue;
+        *comma = '\0';
+        std::string label(comma + 1);
+        while (!label.empty() && (label.back() == '\n' || label.back() == '\r' || label.back() == ' '))
+            label.pop_back();
+        rows.push_back({line[0] == '/' ? std::string(line) : dir + line, label});
+    }
+    fclose(f);
+
+    // class ids come from the model when there is one, otherwise sorted labels
+    if (labels.empty())
+    {
+        for (auto &r : rows)
+            labels.push_back(r.second);
+        std::sort(labels.begin(), labels.end());
+        labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+    }
+    for (auto &r : rows)
+    {
+        auto it = std::find(labels.begin(), labels.end(), r.second);
+        if (it == labels.end())
+        {
+            fprintf(stderr, "%s: label '%s' is not in the model\n", r.first.c_str(), r.second.c_str());
+            return false;
+        }
+        clip_t c = {r.first, (int)(it - labels.begin()), pcm_t()};
+        if (!read_wav(c.path, c.pcm))
+            return false;
+        clips.push_back(c);
+    }
+    return !clips.empty();
+}
+
+/* One second of the clip's own background: its quietest 100 ms, repeated */
+static pcm_t clip_background(const pcm_t &pcm)
+{
+    const int len = KWS_SAMPLE_RATE / 10;
+    pcm_t bg(KWS_SAMPLE_RATE, 0);
+    if ((int)pcm.size() < len)
+        return bg;
+    double best = -1;
+    int at = 0;
+    for (int s = 0; s + len <= (int)pcm.size(); s += len / 2)
+    {
+        double e = 0;
+        for (int i = 0; i < len; i++)
+            e += (double)pcm[s + i] * pcm[s + i];
+        if (best < 0 || e < best)
+        {
+            best = e;
+            at = s;
+        }
+    }
+    // alternate direction so the copies join without clicks
+    for (int i = 0; i < KWS_SAMPLE_RATE; i++)
+    {
+        int k = i % len;
+        bg[i] = pcm[at + ((i / len) & 1 ? len - 1 - k : k)];
+    }
+    return bg;
+}
+
+/* 49 frames of int32 MFCCs over one second starting at `start`, padded with
+ * the clip's background as the device would hear it */
+static void clip_mfcc(const pcm_t &pcm, int start, int32_t *mfcc)
+{
+    pcm_t bg = clip_background(pcm);
+    int16_t window[KWS_FFT_LEN];
+    int32_t e;
+    for (int t = 0; t < KWS_FRAMES; t++)
+    {
+        for (int i = 0; i < KWS_FFT_LEN; i++)
+        {
+            int s = start + t * KWS_HOP + i;
+            window[i] = s >= 0 && s < (int)pcm.size() ? pcm[s] : bg[(s % (int)bg.size() + bg.size()) % bg.size()];
+        }
+        kws_mfcc(window, mfcc + t * KWS_MFCC, &e);
+    }
+}
+
+/* Clips longer than a second: centre the window on the loudest second */
+static int clip_start(const pcm_t &pcm)
+{
+    if ((int)pcm.size() <= CLIP_SAMPLES)
+        return ((int)pcm.size() - CLIP_SAMPLES) / 2;
+    std::vector<double> acc(pcm.size() + 1, 0);
+    for (size_t i = 0; i < pcm.size(); i++)
+        acc[i + 1] = acc[i] + (double)pcm[i] * pcm[i];
+    int best = 0;
+    for (int s = 0; s + CLIP_SAMPLES <= (int)pcm.size(); s += KWS_HOP)
+        if (acc[s + CLIP_SAMPLES] - acc[s] > acc[best + CLIP_SAMPLES] - acc[best])
+            best = s;
+    return best;
+}
+
+/*******************************************************************************
+ * Float DS-CNN, same shapes and memory layout as kws_infer()
+ ******************************************************************************/
+#define PX (KWS_T1 * KWS_F1)
+
+struct net_t
+{
+    int C, B, N;
+    size_t c1w, c1b, dww[KWS_MAX_BLOCKS], dwb[KWS_MAX_BLOCKS], pww[KWS_MAX_BLOCKS], pwb[KWS_MAX_BLOCKS], fcw, fcb, size;
+    std::vector<float> p;
+};
+
+struct acts_t
+{
+    float x[KWS_FRAMES * KWS_MFCC];
+    std::vector<float> z1, a1, zd[KWS_MAX_BLOCKS], ad[KWS_MAX_BLOCKS], zp[KWS_MAX_BLOCKS], ap[KWS_MAX_BLOCKS];
+    std::vector<float> pool, logits;
+};
+
+static void net_init(net_t &n, int C, int B, int N, std::mt19937 &rng)
+{
+    n.C = C;
+    n.B = B;
+    n.N = N;
+    size_t o = 0;
+    auto take = [&o](size_t count) { size_t at = o; o += count; return at; };
+    n.c1w = take(C * KWS_CONV_KT * KWS_CONV_KF);
+    n.c1b = take(C);
+    for (int b = 0; b < B; b++)
+    {
+        n.dww[b] = take(C * 9);
+        n.dwb[b] = take(C);
+        n.pww[b] = take(C * C);
+        n.pwb[b] = take(C);
+    }
+    n.fcw = take(N * C);
+    n.fcb = take(N);
+    n.size = o;
+    n.p.assign(o, 0.0f);
+
+    // He initialisation, biases zero
+    auto fill = [&](size_t at, size_t count, int fan_in) {
+        std::normal_distribution<float> d(0.0f, sqrtf(2.0f / fan_in));
+        for (size_t i = 0; i < count; i++)
+            n.p[at + i] = d(rng);
+    };
+    fill(n.c1w, C * KWS_CONV_KT * KWS_CONV_KF, KWS_CONV_KT * KWS_CONV_KF);
+    for (int b = 0; b < B; b++)
+    {
+        fill(n.dww[b], C * 9, 9);
+        fill(n.pww[b], C * C, C);
+    }
+    fill(n.fcw, N * C, C);
+}
+
+static void net_forward(const net_t &n, acts_t &a)
+{
+    const int C = n.C;
+    const float *p = n.p.data();
+    const int pad_t = ((KWS_T1 - 1) * 2 + KWS_CONV_KT - KWS_FRAMES) / 2;
+    const int pad_f = ((KWS_F1 - 1) * 2 + KWS_CONV_KF - KWS_MFCC) / 2;
+    a.z1.assign(PX * C, 0);
+    a.a1.assign(PX * C, 0);
+    for (int t = 0; t < KWS_T1; t++)
+        for (int f = 0; f < KWS_F1; f++)
+            for (int o = 0; o < C; o++)
+            {
+                float acc = p[n.c1b + o];
+                for (int kt = 0; kt < KWS_CONV_KT; kt++)
+                {
+                    int it = t * 2 - pad_t + kt;
+                    if (it < 0 || it >= KWS_FRAMES)
+                        continue;
+                    for (int kf = 0; kf < KWS_CONV_KF; kf++)
+                    {
+                        int jf = f * 2 - pad_f + kf;
+                        if (jf >= 0 && jf < KWS_MFCC)
+                            acc += a.x[it * KWS_MFCC + jf] * p[n.c1w + (o * KWS_CONV_KT + kt) * KWS_CONV_KF + kf];
+                    }
+                }
+                a.z1[(t * KWS_F1 + f) * C + o] = acc;
+                a.a1[(t * KWS_F1 + f) * C + o] = acc > 0 ? acc : 0;
+            }
+
+    const std::vector<float> *in = &a.a1;
+    for (int b = 0; b < n.B; b++)
+    {
+        a.zd[b].assign(PX * C, 0);
+        a.ad[b].assign(PX * C, 0);
+        for (int t = 0; t < KWS_T1; t++)
+            for (int f = 0; f < KWS_F1; f++)
+                for (int ch = 0; ch < C; ch++)
+                {
+                    float acc = p[n.dwb[b] + ch];
+                    for (int dt = -1; dt <= 1; dt++)
+                        for (int df = -1; df <= 1; df++)
+                        {
+                            int it = t + dt, jf = f + df;
+                            if (it >= 0 && it < KWS_T1 && jf >= 0 && jf < KWS_F1)
+                                acc += (*in)[(it * KWS_F1 + jf) * C + ch] * p[n.dww[b] + ch * 9 + (dt + 1) * 3 + df + 1];
+                        }
+                    a.zd[b][(t * KWS_F1 + f) * C + ch] = acc;
+                    a.ad[b][(t * KWS_F1 + f) * C + ch] = acc > 0 ? acc : 0;
+                }
+        a.zp[b].assign(PX * C, 0);
+        a.ap[b].assign(PX * C, 0);
+        for (int px = 0; px < PX; px++)
+            for (int o = 0; o < C; o++)
+            {
+                float acc = p[n.pwb[b] + o];
+                for (int ch = 0; ch < C; ch++)
+                    acc += a.ad[b][px * C + ch] * p[n.pww[b] + o * C + ch];
+                a.zp[b][px * C + o] = acc;
+                a.ap[b][px * C + o] = acc > 0 ? acc : 0;
+            }
+        in = &a.ap[b];
+    }
+
+    a.pool.assign(C, 0);
+    for (int px = 0; px < PX; px++)
+        for (int ch = 0; ch < C; ch++)
+            a.pool[ch] += (*in)[px * C + ch] / PX;
+    a.logits.assign(n.N, 0);
+    for (int k = 0; k < n.N; k++)
+    {
+        float acc = p[n.fcb + k];
+        for (int ch = 0; ch < C; ch++)
+            acc += a.pool[ch] * p[n.fcw + k * C + ch];
+        a.logits[k] = acc;
+    }
+}
+
+/* Softmax cross-entropy; accumulates parameter gradients into g, returns the loss */
+static float net_backward(const net_t &n, const acts_t &a, int label, std::vector<float> &g)
+{
+    const int C = n.C;
+    const float *p = n.p.data();
+    float mx = *std::max_element(a.logits.begin(), a.logits.end()), sum = 0;
+    std::vector<float> dl(n.N);
+    for (int k = 0; k < n.N; k++)
+        sum += dl[k] = expf(a.logits[k] - mx);
+    for (int k = 0; k < n.N; k++)
+        dl[k] = dl[k] / sum - (k == label);
+    float loss = -(a.logits[label] - mx - logf(sum));
+
+    std::vector<float> dpool(C, 0);
+    for (int k = 0; k < n.N; k++)
+    {
+        g[n.fcb + k] += dl[k];
+        for (int ch = 0; ch < C; ch++)
+        {
+            g[n.fcw + k * C + ch] += dl[k] * a.pool[ch];
+            dpool[ch] += dl[k] * p[n.fcw + k * C + ch];
+        }
+    }
+
+    std::vector<float> d(PX * C), dz(PX * C), din(PX * C);
+    for (int px = 0; px < PX; px++)
+        for (int ch = 0; ch < C; ch++)
+            d[px * C + ch] = dpool[ch] / PX;
+
+    for (int b = n.B - 1; b >= 0; b--)
+    {
+        for (int i = 0; i < PX * C; i++)
+            dz[i] = a.zp[b][i] > 0 ? d[i] : 0;
+        std::fill(din.begin(), din.end(), 0.0f);
+        for (int px = 0; px < PX; px++)
+            for (int o = 0; o < C; o++)
+            {
+                float v = dz[px * C + o];
+                if (v == 0)
+                    continue;
+                g[n.pwb[b] + o] += v;
+                for (int ch = 0; ch < C; ch++)
+                {
+                    g[n.pww[b] + o * C + ch] += v * a.ad[b][px * C + ch];
+                    din[px * C + ch] += v * p[n.pww[b] + o * C + ch];
+                }
+            }
+        for (int i = 0; i < PX * C; i++)
+            dz[i] = a.zd[b][i] > 0 ? din[i] : 0;
+        const std::vector<float> &in = b ? a.ap[b - 1] : a.a1;
+        std::fill(d.begin(), d.end(), 0.0f);
+        for (int t = 0; t < KWS_T1; t++)
+            for (int f = 0; f < KWS_F1; f++)
+                for (int ch = 0; ch < C; ch++)
+                {
+                    float v = dz[(t * KWS_F1 + f) * C + ch];
+                    if (v == 0)
+                        continue;
+                    g[n.dwb[b] + ch] += v;
+                    for (int dt = -1; dt <= 1; dt++)
+                        for (int df = -1; df <= 1; df++)
+                        {
+                            int it = t + dt, jf = f + df;
+                            if (it < 0 || it >= KWS_T1 || jf < 0 || jf >= KWS_F1)
+                                continue;
+                            int wi = ch * 9 + (dt + 1) * 3 + df + 1;
+                            g[n.dww[b] + wi] += v * in[(it * KWS_F1 + jf) * C + ch];
+                            d[(it * KWS_F1 + jf) * C + ch] += v * p[n.dww[b] + wi];
+                        }
+                }
+    }
+
+    const int pad_t = ((KWS_T1 - 1) * 2 + KWS_CONV_KT - KWS_FRAMES) / 2;
+    const int pad_f = ((KWS_F1 - 1) * 2 + KWS_CONV_KF - KWS_MFCC) / 2;
+    for (int t = 0; t < KWS_T1; t++)
+        for (int f = 0; f < KWS_F1; f++)
+            for (int o = 0; o < C; o++)
+            {
+                float v = a.z1[(t * KWS_F1 + f) * C + o] > 0 ? d[(t * KWS_F1 + f) * C + o] : 0;
+                if (v == 0)
+                    continue;
+                g[n.c1b + o] += v;
+                for (int kt = 0; kt < KWS_CONV_KT; kt++)
+                {
+                    int it = t * 2 - pad_t + kt;
+                    if (it < 0 || it >= KWS_FRAMES)
+                        continue;
+                    for (int kf = 0; kf < KWS_CONV_KF; kf++)
+                    {
+                        int jf = f * 2 - pad_f + kf;
+                        if (jf >= 0 && jf < KWS_MFCC)
+                            g[n.c1w + (o * KWS_CONV_KT + kt) * KWS_CONV_KF + kf] += v * a.x[it * KWS_MFCC + jf];
+                    }
+                }
+            }
+    return loss;
+}
+
+/*******************************************************************************
+ * Quantization and the model blob
+ ******************************************************************************/
+struct input_norm_t
+{
+    int32_t offset[KWS_MFCC], mult[KWS_MFCC];
+    int8_t shift[KWS_MFCC];
+};
+
+/* real multiplier -> mult / 2^(31 + shift) */
+static void quant_mult(double m, int32_t *mult, int8_t *shift)
+{
+    int e;
+    double frac = frexp(m, &e);
+    int64_t q = llround(frac * 2147483648.0);
+    if (q == 2147483648LL)
+    {
+        q /= 2;
+        e++;
+    }
+    if (e > 30)
+    {
+        q = INT32_MAX;
+        e = 30;
+    }
+    if (-e > 31)
+    {
+        q >>= -e - 31;
+        e = -31;
+    }
+    *mult = (int32_t)q;
+    *shift = (int8_t)-e;
+}
+
+/* Network input exactly as the device will see it, as float */
+static void quantize_features(const input_norm_t &in, const int32_t *mfcc, int8_t *q, float *x)
+{
+    for (int i = 0; i < KWS_FRAMES * KWS_MFCC; i++)
+    {
+        int j = i % KWS_MFCC;
+        q[i] = kws_sat8(kws_requant(mfcc[i] - in.offset[j], in.mult[j], in.shift[j]), -127);
+        if (x)
+            x[i] = q[i] * (INPUT_RANGE / 127);
+    }
+}
+
+static void put_u32(std::vector<uint8_t> &out, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        out.push_back((uint8_t)(v >> (8 * i)));
+}
+
+static void pad4(std::vector<uint8_t> &out)
+{
+    while (out.size() & 3)
+        out.push_back(0);
+}
+
+/* One layer: per output channel weight scale, bias and requantization */
+static void put_layer(std::vector<uint8_t> &out, const float *w, const float *b, int outs, int per_out,
+                      double s_in, double s_out)
+{
+    std::vector<double> sw(outs, 1.0);
+    for (int o = 0; o < outs; o++)
+    {
+        float mx = 1e-8f;
+        for (int i = 0; i < per_out; i++)
+            mx = std::max(mx, fabsf(w[o * per_out + i]));
+        sw[o] = mx / 127.0;
+        for (int i = 0; i < per_out; i++)
+            out.push_back((uint8_t)(int8_t)lrint(w[o * per_out + i] / sw[o]));
+    }
+    pad4(out);
+    for (int o = 0; o < outs; o++)
+        put_u32(out, (uint32_t)(int32_t)llround(b[o] / (s_in * sw[o])));
+    std::vector<int8_t> shifts(outs);
+    for (int o = 0; o < outs; o++)
+    {
+        int32_t m;
+        quant_mult(s_in * sw[o] / s_out, &m, &shifts[o]);
+        put_u32(out, (uint32_t)m);
+    }
+    for (int o = 0; o < outs; o++)
+        out.push_back((uint8_t)shifts[o]);
+    pad4(out);
+}
+
+static void put_requant(std::vector<uint8_t> &out, const int32_t *bias, const int32_t *mult, const int8_t *shift, int outs)
+{
+    for (int o = 0; o < outs; o++)
+        put_u32(out, (uint32_t)bias[o]);
+    for (int o = 0; o < outs; o++)
+        put_u32(out, (uint32_t)mult[o]);
+    for (int o = 0; o < outs; o++)
+        out.push_back((uint8_t)shift[o]);
+    pad4(out);
+}
+
+static std::vector<uint8_t> export_model(const net_t &n, const std::vector<std::string> &labels, const input_norm_t &in,
+                                         const std::vector<acts_t> &calib)
+{
+    // activation ranges over the calibration set
+    float r1 = 1e-6f, rd[KWS_MAX_BLOCKS], rp[KWS_MAX_BLOCKS], rpool = 1e-6f, rlog = 1e-6f;
+    std::fill(rd, rd + KWS_MAX_BLOCKS, 1e-6f);
+    std::fill(rp, rp + KWS_MAX_BLOCKS, 1e-6f);
+    for (const acts_t &a : calib)
+    {
+        r1 = std::max(r1, *std::max_element(a.a1.begin(), a.a1.end()));
+        for (int b = 0; b < n.B; b++)
+        {
+            rd[b] = std::max(rd[b], *std::max_element(a.ad[b].begin(), a.ad[b].end()));
+            rp[b] = std::max(rp[b], *std::max_element(a.ap[b].begin(), a.ap[b].end()));
+        }
+        rpool = std::max(rpool, *std::max_element(a.pool.begin(), a.pool.end()));
+        for (float l : a.logits)
+            rlog = std::max(rlog, fabsf(l));
+    }
+
+    std::vector<uint8_t> out(KWS_MODEL_MAGIC, KWS_MODEL_MAGIC + 4);
+    double s_logit = rlog / 127.0;
+    out.push_back((uint8_t)n.N);
+    out.push_back((uint8_t)n.C);
+    out.push_back((uint8_t)n.B);
+    out.push_back((uint8_t)std::min(255L, std::max(1L, lrint(ceil(MARGIN_LOGITS / s_logit)))));
+    for (const std::string &l : labels)
+    {
+        char buf[KWS_LABEL_LEN] = {0};
+        strncpy(buf, l.c_str(), KWS_LABEL_LEN - 1);
+        out.insert(out.end(), buf, buf + KWS_LABEL_LEN);
+    }
+    put_requant(out, in.offset, in.mult, in.shift, KWS_MFCC);
+
+    const float *p = n.p.data();
+    double s = INPUT_RANGE / 127.0;
+    put_layer(out, p + n.c1w, p + n.c1b, n.C, KWS_CONV_KT * KWS_CONV_KF, s, r1 / 127.0);
+    s = r1 / 127.0;
+    for (int b = 0; b < n.B; b++)
+    {
+        put_layer(out, p + n.dww[b], p + n.dwb[b], n.C, 9, s, rd[b] / 127.0);
+        put_layer(out, p + n.pww[b], p + n.pwb[b], n.C, n.C, rd[b] / 127.0, rp[b] / 127.0);
+        s = rp[b] / 127.0;
+    }
+    int32_t zero = 0, pm;
+    int8_t ps;
+    quant_mult(s / (PX * (rpool / 127.0)), &pm, &ps);
+    put_requant(out, &zero, &pm, &ps, 1);
+    put_layer(out, p + n.fcw, p + n.fcb, n.N, n.C, rpool / 127.0, s_logit);
+    return out;
+}
+
+/*******************************************************************************
+ * Commands
+ ******************************************************************************/
+static bool write_file(const char *path, const std::vector<uint8_t> &data)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f)
+    {
+        perror(path);
+        return false;
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    fclose(f);
+    return ok;
+}
+
+static bool read_file(const char *path, std::vector<uint8_t> &out)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        perror(path);
+        return false;
+    }
+    uint8_t buf[4096];
+    size_t got;
+    while ((got = fread(buf, 1, sizeof(buf), f)) > 0)
+        out.insert(out.end(), buf, buf + got);
+    fclose(f);
+    return true;
+}
+
+static int cmd_train(const char *csv, const char *model_path, int epochs, int channels)
+{
+    std::vector<clip_t> clips;
+    std::vector<std::string> labels;
+    kws_frontend_init();
+    if (!read_csv(csv, clips, labels))
+        return 1;
+    if (labels.size() > KWS_MAX_CLASSES || channels > KWS_MAX_CHANNELS)
+    {
+        fprintf(stderr, "at most %d labels and %d channels\n", KWS_MAX_CLASSES, KWS_MAX_CHANNELS);
+        return 1;
+    }
+    std::mt19937 rng(1234);
+    std::shuffle(clips.begin(), clips.end(), rng);
+    size_t n_val = clips.size() / 10, n_train = clips.size() - n_val;
+
+    // per-coefficient normalisation from the training clips
+    std::vector<int32_t> mfcc(KWS_FRAMES * KWS_MFCC);
+    double sum[KWS_MFCC] = {0}, sq[KWS_MFCC] = {0};
+    for (size_t i = 0; i < n_train; i++)
+    {
+        clip_mfcc(clips[i].pcm, clip_start(clips[i].pcm), mfcc.data());
+        for (int k = 0; k < KWS_FRAMES * KWS_MFCC; k++)
+        {
+            sum[k % KWS_MFCC] += mfcc[k];
+            sq[k % KWS_MFCC] += (double)mfcc[k] * mfcc[k];
+        }
+    }
+    input_norm_t in;
+    double count = (double)n_train * KWS_FRAMES;
+    for (int j = 0; j < KWS_MFCC; j++)
+    {
+        double mean = sum[j] / count, sd = sqrt(std::max(sq[j] / count - mean * mean, 1.0));
+        in.offset[j] = (int32_t)lrint(mean);
+        quant_mult(127.0 / (INPUT_RANGE * sd), &in.mult[j], &in.shift[j]);
+    }
+
+    net_t net;
+    net_init(net, channels, 3, (int)labels.size(), rng);
+    std::vector<float> g(net.size), m1(net.size, 0), m2(net.size, 0);
+    std::uniform_int_distribution<int> shift_d(-SHIFT_MAX, SHIFT_MAX);
+    std::uniform_real_distribution<float> noise_d(0.0f, 1.0f);
+    std::normal_distribution<float> gauss(0.0f, 1.0f);
+    acts_t a;
+    int8_t q[KWS_FRAMES * KWS_MFCC];
+    int step = 0;
+    for (int ep = 0; ep < epochs; ep++)
+    {
+        std::vector<size_t> order(n_train);
+        for (size_t i = 0; i < n_train; i++)
+            order[i] = i;
+        std::shuffle(order.begin(), order.end(), rng);
+        float lr = LEARNING_RATE * (ep < epochs * 3 / 4 ? 1.0f : 0.1f);
+        double loss = 0;
+        int correct = 0;
+        for (size_t bi = 0; bi < n_train; bi += BATCH)
+        {
+            std::fill(g.begin(), g.end(), 0.0f);
+            size_t be = std::min(n_train, bi + BATCH);
+            for (size_t i = bi; i < be; i++)
+            {
+                // augmentation: time shift and low-level noise
+                const clip_t &c = clips[order[i]];
+                pcm_t pcm = c.pcm;
+                float level = noise_d(rng) * 30.0f;
+                for (int16_t &s : pcm)
+                    s = (int16_t)std::max(-32768.0f, std::min(32767.0f, s + level * gauss(rng)));
+                clip_mfcc(pcm, clip_start(pcm) + shift_d(rng), mfcc.data());
+                quantize_features(in, mfcc.data(), q, a.x);
+                net_forward(net, a);
+                loss += net_backward(net, a, c.label, g);
+                correct += std::max_element(a.logits.begin(), a.logits.end()) - a.logits.begin() == c.label;
+            }
+            // Adam
+            step++;
+            float b1 = 0.9f, b2 = 0.999f, scale = 1.0f / (be - bi);
+            float c1 = 1 - powf(b1, step), c2 = 1 - powf(b2, step);
+            for (size_t i = 0; i < net.size; i++)
+            {
+                float gi = g[i] * scale;
+                m1[i] = b1 * m1[i] + (1 - b1) * gi;
+                m2[i] = b2 * m2[i] + (1 - b2) * gi * gi;
+                net.p[i] -= lr * (m1[i] / c1) / (sqrtf(m2[i] / c2) + 1e-7f);
+            }
+        }
+        int val_ok = 0;
+        for (size_t i = n_train; i < clips.size(); i++)
+        {
+            clip_mfcc(clips[i].pcm, clip_start(clips[i].pcm), mfcc.data());
+            quantize_features(in, mfcc.data(), q, a.x);
+            net_forward(net, a);
+            val_ok += std::max_element(a.logits.begin(), a.logits.end()) - a.logits.begin() == clips[i].label;
+        }
+        printf("epoch %d: loss %.3f, train %.1f%%, val %.1f%% (float)\n", ep + 1, loss / n_train, 100.0 * correct / n_train,
+               n_val ? 100.0 * val_ok / n_val : 0.0);
+    }
+
+    std::vector<acts_t> calib(n_train);
+    for (size_t i = 0; i < n_train; i++)
+    {
+        clip_mfcc(clips[i].pcm, clip_start(clips[i].pcm), mfcc.data());
+        quantize_features(in, mfcc.data(), q, calib[i].x);
+        net_forward(net, calib[i]);
+    }
+    std::vector<uint8_t> blob = export_model(net, labels, in, calib);
+
+    kws_model_t m;
+    if (!kws_model_parse(blob.data(), blob.size(), &m))
+    {
+        fprintf(stderr, "exported model does not parse\n");
+        return 1;
+    }
+    int val_ok = 0;
+    int8_t logits[KWS_MAX_CLASSES];
+    for (size_t i = n_train; i < clips.size(); i++)
+    {
+        clip_mfcc(clips[i].pcm, clip_start(clips[i].pcm), mfcc.data());
+        quantize_features(in, mfcc.data(), q, NULL);
+        kws_infer(&m, q, logits);
+        val_ok += std::max_element(logits, logits + m.classes) - logits == clips[i].label;
+    }
+    printf("int8 model: %zu bytes, %u MACs/inference, val %.1f%%, margin %u\n", blob.size(), kws_model_macs(&m),
+           n_val ? 100.0 * val_ok / n_val : 0.0, m.margin);
+    return write_file(model_path, blob) ? 0 : 1;
+}
+
+/* Streaming evaluation state */
+static int eval_keyword = -1;
+static int eval_cloud = 0;
+
+static void eval_on_keyword(uint8_t id, const char *)
+{
+    if (eval_keyword < 0)
+        eval_keyword = id;
+}
+
+/* The segments are only valid during the call: a real consumer copies them
+ * here before handing the utterance to its upload task */
+static void eval_on_cloud(const int16_t *, size_t, const int16_t *, size_t) { eval_cloud++; }
+
+static int cmd_eval(const char *model_path, const char *csv)
+{
+    std::vector<uint8_t> blob;
+    if (!read_file(model_path, blob) || !kws_begin(blob.data(), blob.size(), eval_on_keyword, eval_on_cloud))
+    {
+        fprintf(stderr, "%s: not a valid model\n", model_path);
+        return 1;
+    }
+    const kws_model_t *m = &kws_model_info;
+    std::vector<std::string> labels;
+    for (uint8_t k = 0; k < m->classes; k++)
+        labels.push_back(kws_label(m, k));
+    std::vector<clip_t> clips;
+    if (!read_csv(csv, clips, labels))
+        return 1;
+
+    // per clip: classifier accuracy with the clip centred in the window
+    std::vector<int32_t> mfcc(KWS_FRAMES * KWS_MFCC);
+    int8_t q[KWS_FRAMES * KWS_MFCC], logits[KWS_MAX_CLASSES];
+    int clip_ok = 0;
+    for (const clip_t &c : clips)
+    {
+        clip_mfcc(c.pcm, clip_start(c.pcm), mfcc.data());
+        for (int i = 0; i < KWS_FRAMES * KWS_MFCC; i++)
+            q[i] = kws_quantize_input(m, i % KWS_MFCC, mfcc[i]);
+        kws_infer(m, q, logits);
+        clip_ok += std::max_element(logits, logits + m->classes) - logits == c.label;
+    }
+
+    // streaming: each clip between 1 s of its own background noise, as one continuous input
+    int kw_clips = 0, hits = 0, wrong = 0, missed = 0, other_clips = 0, false_accepts = 0;
+    std::vector<int> per_label(m->classes, 0), fallbacks(m->classes, 0);
+    kws_stats = kws_stats_t();
+    for (const clip_t &c : clips)
+    {
+        eval_keyword = -1;
+        eval_cloud = 0;
+        pcm_t bg = clip_background(c.pcm);
+        kws_process(bg.data(), bg.size());
+        kws_process(c.pcm.data(), c.pcm.size());
+        kws_process(bg.data(), bg.size());
+        kws_flush();
+        if (kws_is_keyword(m, c.label))
+        {
+            kw_clips++;
+            hits += eval_keyword == c.label;
+            wrong += eval_keyword >= 0 && eval_keyword != c.label;
+            missed += eval_keyword < 0;
+        }
+        else
+        {
+            other_clips++;
+            false_accepts += eval_keyword >= 0;
+            per_label[c.label]++;
+            fallbacks[c.label] += eval_cloud > 0;
+        }
+    }
+
+    double audio_s = kws_stats.frames / (double)(KWS_SAMPLE_RATE / KWS_HOP);
+    printf("clips: %zu (%d keyword, %d other), classes:", clips.size(), kw_clips, other_clips);
+    for (const std::string &l : labels)
+        printf(" %s", l.c_str());
+    printf("\n");
+    printf("classifier accuracy     %.1f%%\n", 100.0 * clip_ok / clips.size());
+    printf("keyword accuracy        %.1f%% (%d wrong keyword, %d missed -> cloud)\n",
+           kw_clips ? 100.0 * hits / kw_clips : 0.0, wrong, missed);
+    printf("false accepts           %.1f%% of non-keyword clips\n", other_clips ? 100.0 * false_accepts / other_clips : 0.0);
+    printf("cloud fallbacks        ");
+    for (uint8_t k = 0; k < m->classes; k++)
+        if (per_label[k])
+            printf(" %s %d/%d", labels[k].c_str(), fallbacks[k], per_label[k]);
+    printf("\n");
+    printf("host CPU per audio s    front-end %.0f us, classifier %.0f us (%u inferences, %u MACs each)\n",
+           kws_stats.frontend_us / audio_s, kws_stats.nn_us / audio_s, kws_stats.inferences, kws_model_macs(m));
+    printf("memory                  arena %d bytes, model %zu bytes\n", KWS_ARENA_BYTES, blob.size());
+    return 0;
+}
+
+static int cmd_header(const char *model_path, const char *header_path)
+{
+    std::vector<uint8_t> blob;
+    kws_model_t m;
+    if (!read_file(model_path, blob) || !kws_model_parse(blob.data(), blob.size(), &m))
+    {
+        fprintf(stderr, "%s: not a valid model\n", model_path);
+        return 1;
+    }
+    FILE *f = fopen(header_path, "w");
+    if (!f)
+    {
+        perror(header_path);
+        return 1;
+    }
+    fprintf(f, "// Keyword spotting model generated by kws_tool, classes:");
+    for (uint8_t k = 0; k < m.classes; k++)
+        fprintf(f, " %s", kws_label(&m, k));
+    fprintf(f, "\n#ifndef _KWS_MODEL_H\n#define _KWS_MODEL_H\n\nstatic const uint8_t kws_model[%zu] = {", blob.size());
+    for (size_t i = 0; i < blob.size(); i++)
+        fprintf(f, "%s0x%02x,", i % 16 ? " " : "\n    ", blob[i]);
+    fprintf(f, "\n};\n\n#endif // _KWS_MODEL_H\n");
+    fclose(f);
+    return 0;
+}
+
+/* Synthetic clips: vowel sequences with a pitch, two formants and background
+ * noise. Not speech, but they exercise the whole pipeline (VAD, front-end,
+ * training, int8 inference, cloud fallback) end to end without a dataset. */
+struct vowel_t
+{
+    float f1, f2;
+};
+static const vowel_t synth_vowels[] = {{730, 1090}, {270, 2290}, {300, 870}, {530, 1840}, {570, 840}}; // a i u e o
+static const char *synth_keywords[][2] = {{"stop", "oa"}, {"next", "ei"}, {"back", "au"}};
+#define SYNTH_KEYWORDS (int)(sizeof(synth_keywords) / sizeof(synth_keywords[0]))
+
+static bool write_wav(const std::string &path, const pcm_t &pcm)
+{
+    std::vector<uint8_t> out;
+    uint32_t bytes = pcm.size() * 2;
+    out.insert(out.end(), {'R', 'I', 'F', 'F'});
+    put_u32(out, 36 + bytes);
+    out.insert(out.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+    put_u32(out, 16);
+    put_u32(out, 1 | 1 << 16);                         // PCM, mono
+    put_u32(out, KWS_SAMPLE_RATE);
+    put_u32(out, KWS_SAMPLE_RATE * 2);
+    put_u32(out, 2 | 16 << 16);                        // block align, bits
+    out.insert(out.end(), {'d', 'a', 't', 'a'});
+    put_u32(out, bytes);
+    for (int16_t v : pcm)
+    {
+        out.push_back((uint8_t)v);
+        out.push_back((uint8_t)(v >> 8));
+    }
+    return write_file(path.c_str(), out);
+}
+
+static pcm_t synth_clip(const std::string &vowels, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+    std::normal_distribution<float> gauss(0.0f, 1.0f);
+    const float pi = 3.14159265358979f;
+    pcm_t pcm(CLIP_SAMPLES);
+    float noise = 20.0f + 80.0f * u(rng);
+    std::vector<float> x(CLIP_SAMPLES);
+    for (float &v : x)
+        v = noise * gauss(rng);
+    int at = (int)(KWS_SAMPLE_RATE * (0.1f + 0.25f * u(rng)));
+    float f0 = 100.0f + 120.0f * u(rng), amp = 1500.0f + 6000.0f * u(rng), phase = 0;
+    for (char ch : vowels)
+    {
+        const vowel_t &v = synth_vowels[strchr("aiueo", ch) - "aiueo"];
+        float f1 = v.f1 * (0.9f + 0.2f * u(rng)), f2 = v.f2 * (0.9f + 0.2f * u(rng));
+        int len = (int)(KWS_SAMPLE_RATE * (0.15f + 0.1f * u(rng))), ramp = KWS_SAMPLE_RATE / 50;
+        for (int i = 0; i < len && at + i < CLIP_SAMPLES; i++)
+        {
+            float env = std::min(1.0f, std::min(i, len - 1 - i) / (float)ramp);
+            float f = f0 * (1.0f - 0.1f * i / len); // falling pitch
+            phase += 2 * pi * f / KWS_SAMPLE_RATE;
+            float y = 0;
+            for (int h = 1; h * f < 4000.0f; h++)
+            {
+                float d1 = (h * f - f1) / 90.0f, d2 = (h * f - f2) / 120.0f;
+                y += (1.0f / (1 + d1 * d1) + 0.5f / (1 + d2 * d2)) * sinf(h * phase);
+            }
+            x[at + i] += amp * env * y;
+        }
+        at += len + (int)(KWS_SAMPLE_RATE * 0.05f * u(rng));
+    }
+    for (int i = 0; i < CLIP_SAMPLES; i++)
+        pcm[i] = (int16_t)std::max(-32768.0f, std::min(32767.0f, x[i]));
+    return pcm;
+}
+
+/* Writes dir/{train,test}.csv and their clips: SYNTH_KEYWORDS keywords, other
+ * vowel sequences as _unknown_ and background noise as _silence_ */
+static int cmd_synth(const char *dir, int per_class)
+{
+    std::mt19937 rng(4321);
+    std::uniform_int_distribution<int> vowel_d(0, 4), count_d(1, 3);
+    for (const char *set : {"train", "test"})
+    {
+        int n = !strcmp(set, "train") ? per_class : std::max(1, per_class / 4);
+        std::string csv_path = std::string(dir) + "/" + set + ".csv";
+        FILE *csv = fopen(csv_path.c_str(), "w");
+        if (!csv)
+        {
+            perror(csv_path.c_str());
+            return 1;
+        }
+        for (int c = 0; c < SYNTH_KEYWORDS + 2; c++)
+            for (int i = 0; i < n; i++)
+            {
+                std::string label, vowels;
+                if (c < SYNTH_KEYWORDS)
+                {
+                    label = synth_keywords[c][0];
+                    vowels = synth_keywords[c][1];
+                }
+                else if (c == SYNTH_KEYWORDS)
+                {
+                    label = "_unknown_";
+                    bool keyword;
+                    do
+                    {
+                        vowels.clear();
+                        for (int k = count_d(rng); k > 0; k--)
+                            vowels += "aiueo"[vowel_d(rng)];
+                        keyword = false;
+                        for (int w = 0; w < SYNTH_KEYWORDS; w++)
+                            keyword |= vowels == synth_keywords[w][1];
+                    } while (keyword);
+                }
+                else
+                {
+                    label = "_silence_";
+                }
+                std::string name = std::string(set) + "_" + label + "_" + std::to_string(i) + ".wav";
+                if (!write_wav(std::string(dir) + "/" + name, synth_clip(vowels, rng)))
+                {
+                    fclose(csv);
+                    return 1;
+                }
+                fprintf(csv, "%s,%s\n", name.c_str(), label.c_str());
+            }
+        fclose(csv);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 4 && !strcmp(argv[1], "train"))
+        return cmd_train(argv[2], argv[3], argc > 4 ? atoi(argv[4]) : 30, argc > 5 ? atoi(argv[5]) : 32);
+    if (argc == 4 && !strcmp(argv[1], "eval"))
+        return cmd_eval(argv[2], argv[3]);
+    if (argc == 4 && !strcmp(argv[1], "header"))
+        return cmd_header(argv[2], argv[3]);
+    if (argc >= 3 && !strcmp(argv[1], "synth"))
+        return cmd_synth(argv[2], argc > 3 ? atoi(argv[3]) : 200);
+    fprintf(stderr, "usage: %s train  train.csv model.kws [epochs] [channels]\n"
+                    "       %s eval   model.kws test.csv\n"
+                    "       %s header model.kws kws_model.h\n"
+                    "       %s synth  dir [clips per class]\n", argv[0], argv[0], argv[0], argv[0]);
+    return 2;
+}
@@ -88,7 +88,25 @@
 #define LV_TICK_CUSTOM 1
 #if LV_TICK_CUSTOM
     #define LV_TICK_CUSTOM_INCLUDE "Arduino.h"         /*Header for the system time function*/
-    #define LV_TICK_CUSTOM_SYS_TIME_EXPR (millis())    /*Expression evaluating to current system time in ms*/
+
+    /*1: take the time from `lv_virtual_millis()`, which the application must define.
+     *The touch trace replay uses it to run LVGL on a deterministic clock.
+     *Off by default; a TOUCH_BENCH build passes -DLV_TICK_VIRTUAL=1 (build_opt.h in the sketch folder)*/
+    #ifndef LV_TICK_VIRTUAL
+    #define LV_TICK_VIRTUAL 0
+    #endif
+    #if LV_TICK_VIRTUAL
+        #ifdef __cplusplus
+        extern "C" {
+        #endif
+        uint32_t lv_virtual_millis(void);
+        #ifdef __cplusplus
+        }
+        #endif
+        #define LV_TICK_CUSTOM_SYS_TIME_EXPR (lv_virtual_millis())
+    #else
+        #define LV_TICK_CUSTOM_SYS_TIME_EXPR (millis())    /*Expression evaluating to current system time in ms*/
+    #endif
 #endif   /*LV_TICK_CUSTOM*/
 
 /*Default Dot Per Inch. Used to initialize default sizes such as widgets sized, style paddings.
@@ -242,8 +260,9 @@
  * Others
  *-----------*/
 
-/*1: Show CPU usage and FPS count*/
-#define LV_USE_PERF_MONITOR 1
+/*1: Show CPU usage and FPS count
+ *(its overlay redraws every second and skews the frame-time benchmarks)*/
+#define LV_USE_PERF_MONITOR 0
 #if LV_USE_PERF_MONITOR
     #define LV_USE_PERF_MONITOR_POS LV_ALIGN_BOTTOM_RIGHT
 #endif
@@ -5,16 +5,68 @@
 #include <lvgl.h>
 #include <Arduino_GFX_Library.h>
 
-#define TFT_BL 27
 #define GFX_BL DF_GFX_BL // default backlight pin
 
-/* Display configuration */
-Arduino_DataBus *bus = new Arduino_ESP32SPI(2 /* DC */, 15 /* CS */, 14 /* SCK */, 13 /* MOSI */, GFX_NOT_DEFINED /* MISO */);
-Arduino_GFX *gfx = new Arduino_ST7789(bus, -1 /* RST */, 3 /* rotation */, true /* IPS */);
+/* Display and GT911 configuration (bus, gfx, TFT_BL, TOUCH_GT911_*, TOUCH_MAP_*),
+   shared with Unit Tests/CycleBench: libraries/tabview_board */
+#include <tabview_board.h>
+// #define TFT_TE 35 /* panel TE output, if wired: flushes are aligned to it (te_pacing.h) */
+/* Portrait only: in landscape every half-screen flush crosses all of the
+   panel's scan lines and every frame would tear, so with rotation 1/3 (the
+   board's default) TFT_TE is left unused and the refresh timer paces */
+
+/* Touch-to-photon latency histograms over Serial (latency_trace.h) */
+// #define LATENCY_TRACE
 
 /* Touch include */
 #include "touch.h"
 
+/* Binary state sync to the Flutter app over Serial. Frames are delimited and
+   escaped (sync.h), so the BOOT/GOV/LAT/... lines can share the port.
+   Off by default: with it on, the human-readable button/slider lines are
+   replaced by the binary frames */
+// #define SYNC_SERIAL
+#include "sync.h"
+
+#ifdef SYNC_SERIAL
+#define LOG_PRINTF(...)
+#else
+#define LOG_PRINTF(...) Serial.printf(__VA_ARGS__)
+#endif
+
+/* Touch trace record / replay (touch_trace.h), at most one of these:
+   TOUCH_TRACE_RECORD logs every touch change, TOUCH_BENCH runs the canned
+   replay scenarios once after setup and reports frame times
+   (TOUCH_BENCH also needs -DLV_TICK_VIRTUAL=1 in build_opt.h, see touch_trace.h) */
+// #define TOUCH_TRACE_RECORD
+// #define TOUCH_BENCH
+#include "touch_trace.h"
+
+/* Boot phase timestamps and async init steps */
+#include "boot_timeline.h"
+
+/* Idle dimming, slower refresh and light sleep between LVGL deadlines */
+#include "power_governor.h"
+
+/* Slider value labels drawn from pre-rasterised glyphs */
+#include "num_label.h"
+
+/* Flush on the panel's tearing-effect pulse, timer pacing without it */
+#include "te_pacing.h"
+
+/* Microphone level and spectrum meter on a third tab
+   Feed audio_meter_push(), or define AUDIO_METER_I2S and the AUDIO_I2S_* pins */
+// #define AUDIO_METER
+#ifdef AUDIO_METER
+#include "audio_meter.h"
+#endif
+
+/* 128x64 SSD1306 on the touch I2C bus showing the last slider value (oled.h) */
+// #define OLED_STATUS
+#ifdef OLED_STATUS
+#include "oled.h"
+#endif
+
 /* Change to your screen resolution */
 static uint32_t screenWidth;
 static uint32_t screenHeight;
@@ -27,12 +79,18 @@ void my_disp_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color
 {
     uint32_t w = (area->x2 - area->x1 + 1);
     uint32_t h = (area->y2 - area->y1 + 1);
+    latency_trace_mark(LAT_RENDER_DONE);
+    te_pacing_flush_gate(area);
+    latency_trace_mark(LAT_FLUSH_START);
 
 #if (LV_COLOR_16_SWAP != 0)
     gfx->draw16bitBeRGBBitmap(area->x1, area->y1, (uint16_t *)&color_p->full, w, h);
 #else
     gfx->draw16bitRGBBitmap(area->x1, area->y1, (uint16_t *)&color_p->full, w, h);
 #endif
+    touch_trace_on_flush(w * h);
+    latency_trace_flush_end(lv_disp_flush_is_last(disp));
+    te_pacing_flush_done(lv_disp_flush_is_last(disp));
 
     lv_disp_flush_ready(disp);
 }
@@ -40,6 +98,10 @@ void my_disp_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color
 /* Read touch points */
 void my_touchpad_read(lv_indev_drv_t *indev_driver, lv_indev_data_t *data)
 {
+    if (touch_trace_replay_read(data))
+    {
+        return;
+    }
     if (touch_has_signal())
     {
         if (touch_touched())
@@ -48,6 +110,8 @@ void my_touchpad_read(lv_indev_drv_t *indev_driver, lv_indev_data_t *data)
             /*Set the coordinates*/
             data->point.x = touch_last_x;
             data->point.y = touch_last_y;
+            latency_trace_mark(LAT_INDEV_READ);
+            governor_activity(GOV_SRC_TOUCH, touch_event_ms());
         }
         else if (touch_released())
         {
@@ -58,6 +122,7 @@ void my_touchpad_read(lv_indev_drv_t *indev_driver, lv_indev_data_t *data)
     {
         data->state = LV_INDEV_STATE_REL;
     }
+    touch_trace_record(data->state == LV_INDEV_STATE_PR, data->point.x, data->point.y);
 }
 
 void create_controls_for_tab(lv_obj_t* parent, const char* btn1_text, const char* btn2_text) {
@@ -88,39 +153,51 @@ void create_controls_for_tab(lv_obj_t* parent, const char* btn1_text, const char
     lv_obj_t* slider1 = lv_slider_create(parent);
     lv_obj_set_size(slider1, 200, 10);
     lv_obj_align(slider1, LV_ALIGN_TOP_MID, 0, 90);  // Adjusted Y position after buttons
-    lv_obj_t* slider1_label = lv_label_create(parent);
-    lv_label_set_text(slider1_label, "0");
+    lv_obj_t* slider1_label = num_label_create(parent, 3);  // 0..100
+    num_label_set_int(slider1_label, 0);
     lv_obj_align_to(slider1_label, slider1, LV_ALIGN_OUT_TOP_MID, 0, -5);
 
     // Create second slider and its label
     lv_obj_t* slider2 = lv_slider_create(parent);
     lv_obj_set_size(slider2, 200, 10);
     lv_obj_align(slider2, LV_ALIGN_TOP_MID, 0, 140);  // Adjusted Y position
-    lv_obj_t* slider2_label = lv_label_create(parent);
-    lv_label_set_text(slider2_label, "0");
+    lv_obj_t* slider2_label = num_label_create(parent, 3);  // 0..100
+    num_label_set_int(slider2_label, 0);
     lv_obj_align_to(slider2_label, slider2, LV_ALIGN_OUT_TOP_MID, 0, -5);
 
     // Event handlers remain the same
     //  lv_obj_add_event_cb(object, callback_function, event_type, user_data)
     lv_obj_add_event_cb(btn1, [](lv_event_t* e) {
+        latency_trace_mark(LAT_EVENT_CB);
         uint32_t tab_num = (uint32_t)lv_obj_get_index(lv_obj_get_parent(lv_event_get_target(e))) + 1;
-        Serial.printf("Button 1 pressed in tab %d\n", tab_num);
+        sync_event(SYNC_EVENT_BUTTON(tab_num - 1, 0));
+        LOG_PRINTF("Button 1 pressed in tab %d\n", tab_num);
     }, LV_EVENT_CLICKED, NULL);
 
     lv_obj_add_event_cb(btn2, [](lv_event_t* e) {
+        latency_trace_mark(LAT_EVENT_CB);
         uint32_t tab_num = (uint32_t)lv_obj_get_index(lv_obj_get_parent(lv_event_get_target(e))) + 1;
-        Serial.printf("Button 2 pressed in tab %d\n", tab_num);
+        sync_event(SYNC_EVENT_BUTTON(tab_num - 1, 1));
+        LOG_PRINTF("Button 2 pressed in tab %d\n", tab_num);
     }, LV_EVENT_CLICKED, NULL);
 
     // Slider event handler
     auto slider_event_cb = [](lv_event_t* e) {
+        latency_trace_mark(LAT_EVENT_CB);
         lv_obj_t* slider = lv_event_get_target(e);
         lv_obj_t* label = (lv_obj_t*)lv_event_get_user_data(e);
         uint32_t tab_num = (uint32_t)lv_obj_get_index(lv_obj_get_parent(slider)) + 1;
-        char buf[8];
-        snprintf(buf, sizeof(buf), "%d", (int)lv_slider_get_value(slider));
-        lv_label_set_text(label, buf);
-        Serial.printf("Slider changed to %d in tab %d\n", 
+        num_label_set_int(label, lv_slider_get_value(slider));
+        latency_trace_mark(LAT_INVALIDATE);
+#ifdef OLED_STATUS
+        char text[8];
+        snprintf(text, sizeof(text), "%3d", (int)lv_slider_get_value(slider));
+        oled_draw_text(0, 0, text); // sent from loop()
+#endif
+        // children are btn1, btn2, slider1, label1, slider2, label2
+        uint32_t slider_num = (lv_obj_get_index(slider) - 2) / 2;
+        sync_set(SYNC_FIELD_SLIDER(tab_num - 1, slider_num), lv_slider_get_value(slider));
+        LOG_PRINTF("Slider changed to %d in tab %d\n", 
             (int)lv_slider_get_value(slider),
             tab_num);
     };
@@ -130,26 +207,60 @@ void create_controls_for_tab(lv_obj_t* parent, const char* btn1_text, const char
 }
 
 
+/* Touch is registered with LVGL once the async touch init has finished */
+static bool touch_indev_registered = false;
+
+static void register_touch_indev()
+{
+    /* Initialize the (dummy) input device driver */
+    static lv_indev_drv_t indev_drv;
+    lv_indev_drv_init(&indev_drv);
+    indev_drv.type = LV_INDEV_TYPE_POINTER;
+    indev_drv.read_cb = my_touchpad_read;
+    lv_indev_t* indev = lv_indev_drv_register(&indev_drv);
+    touch_indev_registered = true;
+    boot_mark_interactive();
+#ifdef OLED_STATUS
+    oled_init(); // its writes go through the bus manager started by touch_init()
+#endif
+
+    governor_begin(indev, [](uint8_t level) {
+#ifdef TFT_BL
+        ledcWrite(0, level);
+#endif
+    });
+}
+
 void setup()
 {
     Serial.begin(115200);
     Serial.println("LVGL Tabview Demo");
+    boot_mark("serial");
+
+    // The GT911 reset sequence sleeps for ~100 ms: run it on core 0 while
+    // this core brings up the display and builds the UI.
+    // Wi-Fi association / TLS setup should be started the same way:
+    //   boot_run_async("wifi", wifi_init, 0, BOOT_NET_READY);
+    boot_run_async("touch init", touch_init, 0, BOOT_TOUCH_READY);
 
     // Init Display
-    gfx->begin(80000000);
+    gfx->begin(TFT_SPI_HZ);
 #ifdef TFT_BL
+    // Backlight stays off until the first LVGL frame is on the panel, so the
+    // fillScreen(BLACK) pass over the whole panel is not needed
     pinMode(TFT_BL, OUTPUT);
-    digitalWrite(TFT_BL, HIGH);
+    digitalWrite(TFT_BL, LOW);
     ledcSetup(0, 2000, 8);
     ledcAttachPin(TFT_BL, 0);
-    ledcWrite(0, 255); /* Screen brightness can be modified by adjusting this parameter. (0-255) */
-#endif
+    ledcWrite(0, 0);
+#else
     gfx->fillScreen(BLACK);
+#endif
+    boot_mark("display init");
 
     lv_init();
-    
-    touch_init();
-    
+    boot_mark("lv_init");
+
     screenWidth = gfx->width();
     screenHeight = gfx->height();
 
@@ -172,16 +283,10 @@ void setup()
         disp_drv.hor_res = screenWidth;
         disp_drv.ver_res = screenHeight;
         disp_drv.flush_cb = my_disp_flush;
+        disp_drv.render_start_cb = [](lv_disp_drv_t *) { latency_trace_mark(LAT_RENDER_START); };
         disp_drv.draw_buf = &draw_buf;
         lv_disp_drv_register(&disp_drv);
 
-        /* Initialize the (dummy) input device driver */
-        static lv_indev_drv_t indev_drv;
-        lv_indev_drv_init(&indev_drv);
-        indev_drv.type = LV_INDEV_TYPE_POINTER;
-        indev_drv.read_cb = my_touchpad_read;
-        lv_indev_drv_register(&indev_drv);
-
         // Create a tab view object
         /* tabview is the first object to be created
         - lv_scr_act() returns a pointer to the current active screen object
@@ -198,13 +303,90 @@ void setup()
         // Create controls for both tabs
         create_controls_for_tab(tab1, "Tab1 Btn1", "Tab1 Btn2");
         create_controls_for_tab(tab2, "Tab2 Btn1", "Tab2 Btn2");
+#ifdef AUDIO_METER
+        lv_obj_t* tab3 = lv_tabview_add_tab(tabview, "Mic");
+        lv_obj_center(audio_meter_create(tab3, 280, 150));
+        audio_meter_begin([](uint32_t event_ms) { governor_activity(GOV_SRC_AUDIO, event_ms); });
+#endif
+
+        // Mirror the active tab to the app
+        lv_obj_add_event_cb(tabview, [](lv_event_t* e) {
+            sync_set(SYNC_FIELD_TAB, lv_tabview_get_tab_act(lv_event_get_target(e)));
+        }, LV_EVENT_VALUE_CHANGED, NULL);
+#ifdef SYNC_SERIAL
+        sync_begin([](const uint8_t* buf, size_t len) { return Serial.write(buf, len); });
+#endif
+        boot_mark("ui built");
+
+        // Render and flush the first frame now instead of on the next timer tick
+        lv_refr_now(NULL);
+        boot_mark_first_frame();
+#ifdef TFT_BL
+        ledcWrite(0, 255); /* Screen brightness can be modified by adjusting this parameter. (0-255) */
+#endif
+
+#ifdef TFT_TE
+        // the ST7789 scans its native portrait lines, which are LVGL columns in
+        // landscape: only portrait flushes can follow the scan
+        if (gfx->getRotation() & 1)
+        {
+            Serial.println("TE,landscape rotation, timer pacing");
+        }
+        else
+        {
+            // TEON, V-blank pulses only
+            bus->beginWrite();
+            bus->writeCommand(0x35);
+            bus->write(0x00);
+            bus->endWrite();
+            te_pacing_begin(TFT_TE, screenHeight, false);
+            boot_mark("te pacing");
+        }
+#endif
+
+        // Join the touch init; if it is late, loop() registers touch when it is done
+        if (boot_wait(BOOT_TOUCH_READY, 1000))
+        {
+            register_touch_indev();
+        }
+        else
+        {
+            Serial.println("Touch init still running, continuing without input");
+        }
 
         Serial.println("Setup done");
+        boot_timeline_poll(); /* now, or from loop() once touch is registered */
+
+#if defined(TOUCH_TRACE_RECORD)
+        touch_trace_record_start();
+#elif defined(TOUCH_BENCH)
+        touch_bench_run_all();
+        latency_trace_bench();
+        num_label_bench();
+#ifdef AUDIO_METER
+        audio_meter_bench();
+#endif
+#endif
     }
 }
 
 void loop()
 {
-    lv_timer_handler(); /* let the GUI do its work */
-    delay(5);
+    if (!touch_indev_registered && boot_is_done(BOOT_TOUCH_READY))
+    {
+        register_touch_indev();
+    }
+    boot_timeline_poll();
+    uint32_t next_ms = lv_timer_handler(); /* let the GUI do its work */
+    next_ms = te_pacing_poll(next_ms);     /* TE mode: renders so the flush meets the next pulse */
+    sync_poll(millis());
+    latency_trace_poll(millis());
+#ifdef OLED_STATUS
+    if (touch_indev_registered)
+        oled_update_async(); /* no-op while clean or while the last update is on the bus */
+#endif
+    /* A keypad wakes the governor like touch and audio do; with ESP32/keypad.h:
+         keypad_event_t ev;
+         while (keypad_get_event(&ev)) governor_activity(GOV_SRC_KEY, ev.time_ms); */
+    governor_wait(next_ms); /* sleeps until the next LVGL deadline, at most 5 ms while active */
 }
\ No newline at end of file
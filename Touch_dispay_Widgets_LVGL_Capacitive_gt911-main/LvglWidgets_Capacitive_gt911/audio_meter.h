@@ -0,0 +1,610 @@
+/*******************************************************************************
+ * Live microphone level and spectrum meter
+ * Three stages, each on its own thread of control:
+ *
+ *   capture   I2S samples -> audio_meter_push(): fills 256-sample blocks in a
+ *             lock-free single-producer / single-consumer queue, never blocks
+ *             (a full queue drops audio, the meter just misses a block)
+ *   analysis  audio_meter_analyze(), a task on core 0: Hann window, 256-point
+ *             fixed-point FFT, log2 energy of 16 log-spaced bands plus the
+ *             block RMS (libraries/q15_dsp, shared with ESP32/kws.h);
+ *             published through a sequence lock
+ *   widget    an LVGL timer at AUDIO_METER_FPS turns the levels into LED-style
+ *             bar segments and invalidates only the segments that changed
+ *
+ * A chart redrawing the whole spectrum every frame would flush the full widget
+ * area (~67 KB at 280x120). Here the invalidated area per frame is capped at
+ * AUDIO_METER_MAX_PX: bars that have waited longest go first, then those
+ * with the biggest change; the rest keep their old height until the next
+ * frame. A full bar fits the budget several times over, so every frame draws
+ * at least that many of the oldest pending bars and a changed bar is on
+ * screen within audio_meter_max_wait() frames. Bars fall at most one segment
+ * per frame, which looks like a meter and bounds the work as well.
+ *
+ *   audio_meter_begin(on_activity);                // starts the analysis task
+ *   lv_obj_t *m = audio_meter_create(tab, 280, 120);
+ *
+ * on_activity(event_ms), if given, runs on the GUI thread whenever a block at
+ * or above AUDIO_METER_WAKE_Q8 has been analysed, with the time that block was
+ * captured; the sketch hands it to governor_activity(GOV_SRC_AUDIO, ...).
+ *
+ * Define AUDIO_METER_I2S plus AUDIO_I2S_SCK / AUDIO_I2S_WS / AUDIO_I2S_SD to
+ * capture from an INMP441 directly; otherwise feed audio_meter_push() from
+ * wherever the samples come from. audio_meter_bench() drives the meter with a
+ * synthetic speech-like signal (live audio with AUDIO_METER_I2S) and prints
+ *   BENCH,audio_meter,<frames>,<p50_us>,<p99_us>,<px_p50>,<px_max>,<full_px>,<deferred>,<max_wait>,<stalled>,PASS|FAIL
+ * Each frame is timed only once the analysis task has published the levels
+ * of that frame's audio; <stalled> counts frames where it did not within
+ * 100 ms. host/audio_meter_bench.cpp runs it on the host.
+ ******************************************************************************/
+#ifndef _AUDIO_METER_H
+#define _AUDIO_METER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <atomic>
+#include <lvgl.h>
+#include <q15_dsp.h>
+
+#define AUDIO_METER_RATE 16000
+#define AUDIO_METER_FFT_BITS 8
+#define AUDIO_METER_BLOCK (1 << AUDIO_METER_FFT_BITS) // samples per queue block, 16 ms
+#define AUDIO_METER_QUEUE 8                           // blocks, power of two
+#define AUDIO_METER_BANDS 16
+#define AUDIO_METER_COLS (AUDIO_METER_BANDS + 1)      // column 0 is the overall level
+#define AUDIO_METER_SEGMENTS 12
+#define AUDIO_METER_SEG_GAP 2
+#define AUDIO_METER_BAR_GAP 3
+#define AUDIO_METER_LEVEL_GAP 8                       // extra space after the level bar
+#define AUDIO_METER_FPS 30
+#define AUDIO_METER_MAX_PX 6000                       // invalidated pixels per frame
+#define AUDIO_METER_BENCH_FRAMES 150
+
+/* Level mapping, log2 energy in Q8 (256 = 3 dB): 4 dB per segment below the top */
+#define AUDIO_METER_SEG_Q8 340
+#define AUDIO_METER_TOP_Q8 (26 * 256)                 // full-scale sine in one band
+#define AUDIO_METER_LEVEL_TOP_Q8 (30 * 256)           // full-scale RMS^2
+#define AUDIO_METER_WAKE_Q8 (AUDIO_METER_LEVEL_TOP_Q8 - 12 * 256) // -36 dBFS RMS counts as activity
+
+typedef struct
+{
+    int16_t s[AUDIO_METER_BLOCK];
+    uint32_t ms;           // when the last sample arrived
+} audio_block_t;
+
+typedef struct
+{
+    uint32_t blocks;       // analysed
+    uint32_t dropped;      // samples lost to a full queue
+    uint32_t frames;       // widget updates
+    uint32_t inv_px;       // pixels invalidated
+    uint32_t deferred;     // bar updates pushed to a later frame by the budget
+    uint32_t max_wait;     // most frames in a row a changed bar was deferred
+} audio_meter_stats_t;
+
+typedef struct
+{
+    uint8_t shown[AUDIO_METER_COLS]; // segments lit on screen
+    uint8_t wait[AUDIO_METER_COLS];  // frames the bar has differed from its target
+    uint32_t loud_ms;                // last loud block passed to on_activity
+    lv_coord_t bar_w, seg_h;
+    lv_timer_t *timer;
+} audio_meter_t;
+
+#ifdef ARDUINO
+#include <Arduino.h>
+static inline uint32_t audio_meter_us() { return micros(); }
+#define AUDIO_METER_PRINTF Serial.printf
+#else
+#include <stdio.h>
+#include <time.h>
+static inline uint32_t audio_meter_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+#define AUDIO_METER_PRINTF printf
+#endif
+
+static audio_meter_stats_t audio_meter_stats;
+
+/*******************************************************************************
+ * Capture side: SPSC block queue
+ ******************************************************************************/
+static audio_block_t audio_meter_queue[AUDIO_METER_QUEUE];
+static std::atomic<uint32_t> audio_meter_head(0);
+static std::atomic<uint32_t> audio_meter_tail(0);
+static uint16_t audio_meter_fill = 0;        // samples in the block being filled
+static void (*audio_meter_on_activity)(uint32_t event_ms) = NULL;
+#ifdef ARDUINO
+static TaskHandle_t audio_meter_task_handle = NULL;
+#endif
+
+void audio_meter_push(const int16_t *samples, size_t n)
+{
+    size_t i = 0;
+    while (i < n)
+    {
+        uint32_t head = audio_meter_head.load(std::memory_order_relaxed);
+        if (head - audio_meter_tail.load(std::memory_order_acquire) >= AUDIO_METER_QUEUE)
+        {
+            audio_meter_stats.dropped += n - i;
+            return;
+        }
+        audio_block_t *b = &audio_meter_queue[head & (AUDIO_METER_QUEUE - 1)];
+        size_t take = n - i < (size_t)(AUDIO_METER_BLOCK - audio_meter_fill) ? n - i : AUDIO_METER_BLOCK - audio_meter_fill;
+        memcpy(b->s + audio_meter_fill, samples + i, take * sizeof(int16_t));
+        audio_meter_fill += take;
+        i += take;
+        if (audio_meter_fill == AUDIO_METER_BLOCK)
+        {
+            b->ms = audio_meter_us() / 1000;
+            audio_meter_fill = 0;
+            audio_meter_head.store(head + 1, std::memory_order_release);
+#ifdef ARDUINO
+            if (audio_meter_task_handle)
+                xTaskNotifyGive(audio_meter_task_handle);
+#endif
+        }
+    }
+}
+
+/*******************************************************************************
+ * Analysis: fixed-point FFT and band energies
+ ******************************************************************************/
+static int16_t audio_meter_hann[AUDIO_METER_BLOCK];
+static int16_t audio_meter_cos[AUDIO_METER_BLOCK / 2], audio_meter_sin[AUDIO_METER_BLOCK / 2];
+static uint8_t audio_meter_band_start[AUDIO_METER_BANDS + 1];   // FFT bin edges
+static int32_t audio_meter_acc[AUDIO_METER_COLS];               // max since the last publish
+static uint32_t audio_meter_acc_loud_ms;                        // newest block over AUDIO_METER_WAKE_Q8
+
+/* Published levels (log2 Q8), guarded by a sequence lock: odd = being written */
+static std::atomic<uint32_t> audio_meter_seq(0);
+static int32_t audio_meter_levels[AUDIO_METER_COLS];
+static uint32_t audio_meter_loud_ms;
+static std::atomic<uint32_t> audio_meter_published(0);          // queue tail the levels cover
+
+/* Built once, before the analysis task starts; later calls return at once */
+static void audio_meter_tables()
+{
+    static bool built = false;
+    if (built)
+        return;
+    built = true;
+    q15_hann(audio_meter_hann, AUDIO_METER_BLOCK);
+    q15_twiddles(audio_meter_cos, audio_meter_sin, AUDIO_METER_BLOCK);
+    // log-spaced bands from 125 Hz to Nyquist, at least one bin each
+    const float lo = 125.0f * AUDIO_METER_BLOCK / AUDIO_METER_RATE, hi = AUDIO_METER_BLOCK / 2;
+    audio_meter_band_start[0] = (uint8_t)lo;
+    for (int b = 1; b <= AUDIO_METER_BANDS; b++)
+    {
+        int edge = (int)lrintf(lo * powf(hi / lo, (float)b / AUDIO_METER_BANDS));
+        if (edge <= audio_meter_band_start[b - 1])
+            edge = audio_meter_band_start[b - 1] + 1;
+        audio_meter_band_start[b] = (uint8_t)edge;
+    }
+}
+
+static void audio_meter_block(const audio_block_t *b)
+{
+    static int16_t re[AUDIO_METER_BLOCK], im[AUDIO_METER_BLOCK];
+    uint64_t sq = 0;
+    for (uint16_t i = 0; i < AUDIO_METER_BLOCK; i++)
+    {
+        sq += (uint64_t)((int32_t)b->s[i] * b->s[i]);
+        re[i] = (int16_t)((b->s[i] * audio_meter_hann[i]) >> 15);
+        im[i] = 0;
+    }
+    int32_t v = q15_log2_q8(sq / AUDIO_METER_BLOCK + 1);
+    if (v > audio_meter_acc[0])
+        audio_meter_acc[0] = v;
+    if (v >= AUDIO_METER_WAKE_Q8)
+        audio_meter_acc_loud_ms = b->ms;
+
+    // scaled by 1/2 per stage: the levels stay on the fixed scale of AUDIO_METER_TOP_Q8
+    q15_fft(re, im, AUDIO_METER_FFT_BITS, audio_meter_cos, audio_meter_sin, Q15_FFT_SCALED);
+    for (uint8_t band = 0; band < AUDIO_METER_BANDS; band++)
+    {
+        uint64_t e = 0;
+        for (uint8_t k = audio_meter_band_start[band]; k < audio_meter_band_start[band + 1]; k++)
+            e += (uint32_t)(re[k] * re[k]) + (uint32_t)(im[k] * im[k]);
+        v = q15_log2_q8(e + 1);
+        if (v > audio_meter_acc[band + 1])
+            audio_meter_acc[band + 1] = v;
+    }
+}
+
+/* Consumer: analyses every queued block and publishes the peak levels */
+void audio_meter_analyze()
+{
+    uint32_t tail = audio_meter_tail.load(std::memory_order_relaxed);
+    if (tail == audio_meter_head.load(std::memory_order_acquire))
+        return;
+    memset(audio_meter_acc, 0, sizeof(audio_meter_acc));
+    while (tail != audio_meter_head.load(std::memory_order_acquire))
+    {
+        audio_meter_block(&audio_meter_queue[tail & (AUDIO_METER_QUEUE - 1)]);
+        audio_meter_tail.store(++tail, std::memory_order_release);
+        audio_meter_stats.blocks++;
+    }
+    uint32_t seq = audio_meter_seq.load(std::memory_order_relaxed);
+    audio_meter_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(audio_meter_levels, audio_meter_acc, sizeof(audio_meter_levels));
+    audio_meter_loud_ms = audio_meter_acc_loud_ms;
+    audio_meter_seq.store(seq + 2, std::memory_order_release);
+    audio_meter_published.store(tail, std::memory_order_release);
+}
+
+/* Waits until the published levels cover every block queued before `head` */
+static bool audio_meter_wait_published(uint32_t head, uint32_t timeout_ms)
+{
+    uint32_t t0 = audio_meter_us();
+    while ((int32_t)(audio_meter_published.load(std::memory_order_acquire) - head) < 0)
+    {
+        if (audio_meter_us() - t0 > timeout_ms * 1000)
+            return false;
+#ifdef ARDUINO
+        delay(1);
+#endif
+    }
+    return true;
+}
+
+/* GUI side: consistent copy of the latest levels */
+static void audio_meter_read(int32_t *levels, uint32_t *loud_ms)
+{
+    uint32_t s1, s2;
+    do
+    {
+        s1 = audio_meter_seq.load(std::memory_order_acquire);
+        memcpy(levels, audio_meter_levels, sizeof(audio_meter_levels));
+        *loud_ms = audio_meter_loud_ms;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        s2 = audio_meter_seq.load(std::memory_order_relaxed);
+    } while ((s1 & 1) || s1 != s2);
+}
+
+/*******************************************************************************
+ * Widget
+ ******************************************************************************/
+static inline lv_coord_t audio_meter_col_x(const lv_obj_t *obj, const audio_meter_t *m, uint8_t c)
+{
+    return obj->coords.x1 + c * (m->bar_w + AUDIO_METER_BAR_GAP) + (c ? AUDIO_METER_LEVEL_GAP : 0);
+}
+
+/* Screen rows of segments [lo, hi) of a bar, segment 0 at the bottom */
+static inline void audio_meter_seg_area(const lv_obj_t *obj, const audio_meter_t *m, uint8_t c, uint8_t lo, uint8_t hi,
+                                        lv_area_t *a)
+{
+    lv_coord_t pitch = m->seg_h + AUDIO_METER_SEG_GAP;
+    a->x1 = audio_meter_col_x(obj, m, c);
+    a->x2 = a->x1 + m->bar_w - 1;
+    a->y2 = obj->coords.y2 - lo * pitch;
+    a->y1 = obj->coords.y2 - (hi - 1) * pitch - m->seg_h + 1;
+}
+
+static lv_color_t audio_meter_seg_color(uint8_t c, uint8_t seg, bool lit)
+{
+    if (!lit)
+        return lv_color_hex(0x202830);
+    if (c == 0)
+        return lv_color_hex(0x30C0F0);
+    if (seg >= AUDIO_METER_SEGMENTS * 5 / 6)
+        return lv_color_hex(0xF04030);
+    if (seg >= AUDIO_METER_SEGMENTS * 3 / 5)
+        return lv_color_hex(0xF0C020);
+    return lv_color_hex(0x40D060);
+}
+
+static void audio_meter_event_cb(lv_event_t *e)
+{
+    lv_obj_t *obj = lv_event_get_target(e);
+    audio_meter_t *m = (audio_meter_t *)lv_obj_get_user_data(obj);
+    if (lv_event_get_code(e) == LV_EVENT_DELETE)
+    {
+        lv_timer_del(m->timer);
+        free(m);
+        return;
+    }
+
+    lv_draw_ctx_t *draw_ctx = lv_event_get_draw_ctx(e);
+    lv_draw_rect_dsc_t dsc;
+    lv_draw_rect_dsc_init(&dsc);
+    lv_area_t a, clip;
+    for (uint8_t c = 0; c < AUDIO_METER_COLS; c++)
+    {
+        audio_meter_seg_area(obj, m, c, 0, AUDIO_METER_SEGMENTS, &a);
+        if (!_lv_area_intersect(&clip, &a, draw_ctx->clip_area))
+            continue;
+        for (uint8_t seg = 0; seg < AUDIO_METER_SEGMENTS; seg++)
+        {
+            audio_meter_seg_area(obj, m, c, seg, seg + 1, &a);
+            if (!_lv_area_intersect(&clip, &a, draw_ctx->clip_area))
+                continue;
+            dsc.bg_color = audio_meter_seg_color(c, seg, seg < m->shown[c]);
+            lv_draw_rect(draw_ctx, &dsc, &a);
+        }
+    }
+}
+
+/* One frame: levels -> segments, invalidating changed segments within the pixel budget */
+void audio_meter_update(lv_obj_t *obj)
+{
+    audio_meter_t *m = (audio_meter_t *)lv_obj_get_user_data(obj);
+    int32_t levels[AUDIO_METER_COLS];
+    uint32_t loud_ms;
+    audio_meter_read(levels, &loud_ms);
+    if (loud_ms != m->loud_ms)
+    {
+        m->loud_ms = loud_ms;
+        if (audio_meter_on_activity)
+            audio_meter_on_activity(loud_ms);
+    }
+
+    uint8_t target[AUDIO_METER_COLS], order[AUDIO_METER_COLS], changed = 0;
+    for (uint8_t c = 0; c < AUDIO_METER_COLS; c++)
+    {
+        int32_t top = c ? AUDIO_METER_TOP_Q8 : AUDIO_METER_LEVEL_TOP_Q8;
+        int32_t seg = (levels[c] - (top - AUDIO_METER_SEGMENTS * AUDIO_METER_SEG_Q8)) / AUDIO_METER_SEG_Q8;
+        seg = seg < 0 ? 0 : seg > AUDIO_METER_SEGMENTS ? AUDIO_METER_SEGMENTS : seg;
+        if (seg < m->shown[c] - 1)
+            seg = m->shown[c] - 1; // fall one segment per frame
+        target[c] = (uint8_t)seg;
+        if (target[c] != m->shown[c])
+            order[changed++] = c;
+        else
+            m->wait[c] = 0;
+    }
+    // longest deferred first, then biggest changes: a change is at most
+    // AUDIO_METER_SEGMENTS, so one frame of waiting outranks any change
+    for (uint8_t i = 1; i < changed; i++)
+    {
+        uint8_t c = order[i], j = i;
+        int key = m->wait[c] * (AUDIO_METER_SEGMENTS + 1) + abs(target[c] - m->shown[c]);
+        for (; j > 0 && m->wait[order[j - 1]] * (AUDIO_METER_SEGMENTS + 1) +
+                                abs(target[order[j - 1]] - m->shown[order[j - 1]]) <
+                            key;
+             j--)
+            order[j] = order[j - 1];
+        order[j] = c;
+    }
+
+    uint32_t spent = 0;
+    for (uint8_t i = 0; i < changed; i++)
+    {
+        uint8_t c = order[i];
+        uint8_t lo = target[c] < m->shown[c] ? target[c] : m->shown[c];
+        uint8_t hi = target[c] < m->shown[c] ? m->shown[c] : target[c];
+        lv_area_t a;
+        audio_meter_seg_area(obj, m, c, lo, hi, &a);
+        uint32_t px = lv_area_get_size(&a);
+        if (spent + px > AUDIO_METER_MAX_PX)
+        {
+            audio_meter_stats.deferred++;
+            if (++m->wait[c] > audio_meter_stats.max_wait)
+                audio_meter_stats.max_wait = m->wait[c];
+            continue;
+        }
+        spent += px;
+        m->shown[c] = target[c];
+        m->wait[c] = 0;
+        lv_obj_invalidate_area(obj, &a);
+    }
+    audio_meter_stats.frames++;
+    audio_meter_stats.inv_px += spent;
+}
+
+/* Bound on audio_meter_stats.max_wait. The first `per_frame` bars in the
+ * order always fit the budget, and only bars deferred since at least as long
+ * can be ahead of a deferred one: each frame it waits, `per_frame` of the
+ * other COLS - 1 bars ahead of it are drawn. */
+static uint32_t audio_meter_max_wait(lv_obj_t *obj)
+{
+    const audio_meter_t *m = (const audio_meter_t *)lv_obj_get_user_data(obj);
+    lv_area_t bar;
+    audio_meter_seg_area(obj, m, 0, 0, AUDIO_METER_SEGMENTS, &bar);
+    uint32_t per_frame = AUDIO_METER_MAX_PX / lv_area_get_size(&bar);
+    return (AUDIO_METER_COLS - 1) / per_frame;
+}
+
+static void audio_meter_timer_cb(lv_timer_t *t) { audio_meter_update((lv_obj_t *)t->user_data); }
+
+lv_obj_t *audio_meter_create(lv_obj_t *parent, lv_coord_t w, lv_coord_t h)
+{
+    lv_obj_t *obj = lv_obj_create(parent);
+    lv_obj_remove_style_all(obj);
+    lv_obj_clear_flag(obj, (lv_obj_flag_t)(LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_SCROLLABLE));
+
+    audio_meter_t *m = (audio_meter_t *)calloc(1, sizeof(audio_meter_t));
+    m->bar_w = (w - AUDIO_METER_LEVEL_GAP - (AUDIO_METER_COLS - 1) * AUDIO_METER_BAR_GAP) / AUDIO_METER_COLS;
+    m->seg_h = (h - (AUDIO_METER_SEGMENTS - 1) * AUDIO_METER_SEG_GAP) / AUDIO_METER_SEGMENTS;
+    lv_obj_set_size(obj, AUDIO_METER_COLS * m->bar_w + (AUDIO_METER_COLS - 1) * AUDIO_METER_BAR_GAP + AUDIO_METER_LEVEL_GAP,
+                    AUDIO_METER_SEGMENTS * m->seg_h + (AUDIO_METER_SEGMENTS - 1) * AUDIO_METER_SEG_GAP);
+    lv_obj_set_user_data(obj, m);
+    m->timer = lv_timer_create(audio_meter_timer_cb, 1000 / AUDIO_METER_FPS, obj);
+    lv_obj_add_event_cb(obj, audio_meter_event_cb, LV_EVENT_DRAW_MAIN, NULL);
+    lv_obj_add_event_cb(obj, audio_meter_event_cb, LV_EVENT_DELETE, NULL);
+    return obj;
+}
+
+/*******************************************************************************
+ * Tasks (device) and benchmark
+ ******************************************************************************/
+#ifdef ARDUINO
+static void audio_meter_task(void *)
+{
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+        audio_meter_analyze();
+    }
+}
+
+#ifdef AUDIO_METER_I2S
+#if !defined(AUDIO_I2S_SCK) || !defined(AUDIO_I2S_WS) || !defined(AUDIO_I2S_SD)
+#error "AUDIO_METER_I2S needs AUDIO_I2S_SCK, AUDIO_I2S_WS and AUDIO_I2S_SD"
+#endif
+#include <driver/i2s.h>
+#define AUDIO_I2S_PORT I2S_NUM_0
+#define AUDIO_I2S_SHIFT 14        // 24-bit left-justified INMP441 samples -> int16
+
+static void audio_meter_capture_task(void *)
+{
+    static int32_t raw[AUDIO_METER_BLOCK];
+    static int16_t pcm[AUDIO_METER_BLOCK];
+    for (;;)
+    {
+        size_t got = 0;
+        if (i2s_read(AUDIO_I2S_PORT, raw, sizeof(raw), &got, portMAX_DELAY) != ESP_OK)
+            continue;
+        for (size_t i = 0; i < got / sizeof(int32_t); i++)
+        {
+            int32_t v = raw[i] >> AUDIO_I2S_SHIFT;
+            pcm[i] = (int16_t)(v < -32768 ? -32768 : v > 32767 ? 32767 : v);
+        }
+        audio_meter_push(pcm, got / sizeof(int32_t));
+    }
+}
+
+static bool audio_meter_i2s_begin()
+{
+    i2s_config_t cfg = {};
+    cfg.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX);
+    cfg.sample_rate = AUDIO_METER_RATE;
+    cfg.bits_per_sample = I2S_BITS_PER_SAMPLE_32BIT;
+    cfg.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+    cfg.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+    cfg.dma_buf_count = 4;
+    cfg.dma_buf_len = AUDIO_METER_BLOCK;
+    i2s_pin_config_t pins = {};
+#ifdef ESP_IDF_VERSION_VAL
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 4, 0)
+    pins.mck_io_num = I2S_PIN_NO_CHANGE;
+#endif
+#endif
+    pins.bck_io_num = AUDIO_I2S_SCK;
+    pins.ws_io_num = AUDIO_I2S_WS;
+    pins.data_out_num = I2S_PIN_NO_CHANGE;
+    pins.data_in_num = AUDIO_I2S_SD;
+    if (i2s_driver_install(AUDIO_I2S_PORT, &cfg, 0, NULL) != ESP_OK || i2s_set_pin(AUDIO_I2S_PORT, &pins) != ESP_OK)
+        return false;
+    return xTaskCreatePinnedToCore(audio_meter_capture_task, "mic", 3072, NULL, 2, NULL, 0) == pdPASS;
+}
+#endif // AUDIO_METER_I2S
+#endif // ARDUINO
+
+bool audio_meter_begin(void (*on_activity)(uint32_t event_ms) = NULL)
+{
+    audio_meter_on_activity = on_activity;
+    audio_meter_tables();
+#ifdef ARDUINO
+    if (xTaskCreatePinnedToCore(audio_meter_task, "meter", 3072, NULL, 1, &audio_meter_task_handle, 0) != pdPASS)
+        return false;
+#ifdef AUDIO_METER_I2S
+    return audio_meter_i2s_begin();
+#endif
+#endif
+    return true;
+}
+
+static int audio_meter_cmp(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Syllable-like bursts of a gliding harmonic tone over noise */
+static void audio_meter_synth(int16_t *out, size_t n, uint32_t *pos)
+{
+    const float pi = 3.14159265358979f;
+    static float phase = 0;
+    for (size_t i = 0; i < n; i++, (*pos)++)
+    {
+        float t = (float)*pos / AUDIO_METER_RATE;
+        float f0 = 120.0f * powf(2.0f, 2.0f * sinf(2 * pi * 0.4f * t));
+        phase += 2 * pi * f0 / AUDIO_METER_RATE;
+        float env = sinf(2 * pi * 4.0f * t);
+        env = env > 0 ? env : 0;
+        float v = 0;
+        for (int h = 1; h <= 12; h++)
+            v += sinf(h * phase) / h;
+        v = 6000.0f * env * v + (float)(rand() % 401 - 200);
+        out[i] = (int16_t)(v < -32768 ? -32768 : v > 32767 ? 32767 : v);
+    }
+}
+
+/* Pixels LVGL will redraw on the next refresh */
+static uint32_t audio_meter_pending_px()
+{
+    lv_disp_t *disp = lv_disp_get_default();
+    uint32_t px = 0;
+    for (uint16_t i = 0; i < disp->inv_p; i++)
+        if (!disp->inv_area_joined[i])
+            px += lv_area_get_size(&disp->inv_areas[i]);
+    return px;
+}
+
+/* Frame after frame: 1/FPS s of audio in, analysis, widget update, render + flush */
+bool audio_meter_bench()
+{
+    static uint32_t us[AUDIO_METER_BENCH_FRAMES], px[AUDIO_METER_BENCH_FRAMES];
+    int16_t pcm[AUDIO_METER_RATE / AUDIO_METER_FPS];
+    uint32_t pos = 0, stalled = 0;
+    audio_meter_tables();
+
+    lv_obj_t *prev = lv_scr_act();
+    lv_obj_t *scr = lv_obj_create(NULL);
+    lv_scr_load(scr);
+    lv_obj_t *meter = audio_meter_create(scr, 280, 120);
+    lv_obj_center(meter);
+    lv_timer_pause(((audio_meter_t *)lv_obj_get_user_data(meter))->timer); // driven by hand below
+    lv_refr_now(NULL);
+    audio_meter_stats = audio_meter_stats_t();
+
+    for (uint16_t f = 0; f < AUDIO_METER_BENCH_FRAMES; f++)
+    {
+#ifdef AUDIO_METER_I2S
+        delay(1000 / AUDIO_METER_FPS); // the capture task is the only producer: measure live audio
+#else
+        audio_meter_synth(pcm, sizeof(pcm) / sizeof(pcm[0]), &pos);
+        audio_meter_push(pcm, sizeof(pcm) / sizeof(pcm[0]));
+#endif
+#ifndef ARDUINO
+        audio_meter_analyze(); // the analysis task does this on the device
+#endif
+        // on the device the task on core 0 publishes when it gets to it:
+        // only time the frame once the levels include this frame's audio
+        if (!audio_meter_wait_published(audio_meter_head.load(std::memory_order_acquire), 100))
+            stalled++;
+        uint32_t t0 = audio_meter_us();
+        audio_meter_update(meter);
+        px[f] = audio_meter_pending_px();
+        lv_refr_now(NULL);
+        us[f] = audio_meter_us() - t0;
+    }
+
+    uint32_t full_px = lv_area_get_size(&meter->coords);
+    uint32_t max_wait = audio_meter_max_wait(meter);
+    lv_scr_load(prev);
+    lv_obj_del(scr);
+
+    qsort(us, AUDIO_METER_BENCH_FRAMES, sizeof(us[0]), audio_meter_cmp);
+    qsort(px, AUDIO_METER_BENCH_FRAMES, sizeof(px[0]), audio_meter_cmp);
+    bool pass = px[AUDIO_METER_BENCH_FRAMES - 1] <= AUDIO_METER_MAX_PX &&
+                us[AUDIO_METER_BENCH_FRAMES * 99 / 100] <= 1000000 / AUDIO_METER_FPS &&
+                audio_meter_stats.max_wait <= max_wait && !stalled;
+    AUDIO_METER_PRINTF("BENCH,audio_meter,%u,%u,%u,%u,%u,%u,%u,%u,%u,%s\n", (unsigned)AUDIO_METER_BENCH_FRAMES,
+                       (unsigned)us[AUDIO_METER_BENCH_FRAMES / 2], (unsigned)us[AUDIO_METER_BENCH_FRAMES * 99 / 100],
+                       (unsigned)px[AUDIO_METER_BENCH_FRAMES / 2], (unsigned)px[AUDIO_METER_BENCH_FRAMES - 1],
+                       (unsigned)full_px, (unsigned)audio_meter_stats.deferred, (unsigned)audio_meter_stats.max_wait,
+                       (unsigned)stalled,
+                       pass ? "PASS" : "FAIL");
+    return pass;
+}
+
+#endif // _AUDIO_METER_H
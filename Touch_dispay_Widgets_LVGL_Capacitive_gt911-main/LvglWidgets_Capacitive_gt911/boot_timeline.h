@@ -0,0 +1,167 @@
+/*******************************************************************************
+ * Boot timeline and parallel initialisation
+ * boot_mark("phase") timestamps a boot step (micros since the app started)
+ * together with the core it ran on. boot_run_async() starts an init step as a
+ * task pinned to a core and sets an event bit when it is done, so independent
+ * steps (touch controller reset, Wi-Fi association) overlap with building the
+ * UI; boot_wait() joins them.
+ *
+ * Two milestones are reported next to the individual phases:
+ *   time to first frame   the first complete LVGL frame reached the panel
+ *   time to interactive   touch input is registered with LVGL
+ *
+ * boot_timeline_print() writes the timeline to Serial as
+ *   BOOT,<us>,<core>,<phase>
+ * boot_timeline_poll(), from setup() and loop(), prints it as soon as the
+ * interactive mark exists, or after BOOT_PRINT_TIMEOUT_MS without it and then
+ * once more when it lands, so a touch controller that comes up after setup()
+ * still gets its milestone.
+ ******************************************************************************/
+#ifndef _BOOT_TIMELINE_H
+#define _BOOT_TIMELINE_H
+
+#include <Arduino.h>
+
+#define BOOT_MAX_MARKS 32
+#define BOOT_TASK_STACK 4096
+#define BOOT_PRINT_TIMEOUT_MS 5000
+
+/* Event bits for boot_run_async() / boot_wait() */
+#define BOOT_TOUCH_READY BIT0
+#define BOOT_NET_READY BIT1
+
+typedef struct
+{
+    const char *name;
+    uint32_t us;
+    uint8_t core;
+} boot_mark_t;
+
+static boot_mark_t boot_marks[BOOT_MAX_MARKS];
+static uint8_t boot_mark_count = 0;
+static uint32_t boot_first_frame_us = 0;
+static uint32_t boot_interactive_us = 0;
+static uint8_t boot_timeline_printed = 0; // 1: without the interactive mark, 2: with it
+static portMUX_TYPE boot_mux = portMUX_INITIALIZER_UNLOCKED;
+static EventGroupHandle_t boot_events;
+
+void boot_mark(const char *name)
+{
+    uint32_t now = micros();
+    portENTER_CRITICAL(&boot_mux);
+    if (boot_mark_count < BOOT_MAX_MARKS)
+        boot_marks[boot_mark_count++] = {name, now, (uint8_t)xPortGetCoreID()};
+    portEXIT_CRITICAL(&boot_mux);
+}
+
+void boot_mark_first_frame()
+{
+    if (!boot_first_frame_us)
+    {
+        boot_first_frame_us = micros();
+        boot_mark("first frame");
+    }
+}
+
+void boot_mark_interactive()
+{
+    if (!boot_interactive_us)
+    {
+        boot_interactive_us = micros();
+        boot_mark("interactive");
+    }
+}
+
+typedef struct
+{
+    const char *name;
+    void (*fn)();
+    EventBits_t done_bit;
+} boot_job_t;
+
+static void boot_job_task(void *arg)
+{
+    boot_job_t *job = (boot_job_t *)arg;
+    job->fn();
+    boot_mark(job->name);
+    xEventGroupSetBits(boot_events, job->done_bit);
+    delete job;
+    vTaskDelete(NULL);
+}
+
+/* Runs fn() as a task on `core`; `name` is marked when it finishes */
+bool boot_run_async(const char *name, void (*fn)(), BaseType_t core, EventBits_t done_bit)
+{
+    if (!boot_events)
+        boot_events = xEventGroupCreate();
+    boot_job_t *job = new boot_job_t{name, fn, done_bit};
+    if (xTaskCreatePinnedToCore(boot_job_task, name, BOOT_TASK_STACK, job, 1, NULL, core) != pdPASS)
+    {
+        // no memory for a task: run it inline so boot still completes
+        delete job;
+        fn();
+        boot_mark(name);
+        xEventGroupSetBits(boot_events, done_bit);
+        return false;
+    }
+    return true;
+}
+
+/* Waits until all `bits` are set; returns false on timeout */
+bool boot_wait(EventBits_t bits, uint32_t timeout_ms)
+{
+    if (!boot_events)
+        return false;
+    EventBits_t got = xEventGroupWaitBits(boot_events, bits, pdFALSE, pdTRUE, pdMS_TO_TICKS(timeout_ms));
+    return (got & bits) == bits;
+}
+
+/* Non-blocking check, for steps that finish after setup() */
+bool boot_is_done(EventBits_t bits)
+{
+    return boot_events && (xEventGroupGetBits(boot_events) & bits) == bits;
+}
+
+void boot_timeline_print()
+{
+    // an async step may still be adding marks: sort a snapshot, not the live array
+    boot_mark_t marks[BOOT_MAX_MARKS];
+    portENTER_CRITICAL(&boot_mux);
+    uint8_t count = boot_mark_count;
+    memcpy(marks, boot_marks, count * sizeof(boot_mark_t));
+    portEXIT_CRITICAL(&boot_mux);
+
+    // async marks land out of order: print sorted by time
+    for (uint8_t i = 1; i < count; i++)
+    {
+        boot_mark_t m = marks[i];
+        int8_t j = i - 1;
+        while (j >= 0 && marks[j].us > m.us)
+        {
+            marks[j + 1] = marks[j];
+            j--;
+        }
+        marks[j + 1] = m;
+    }
+    for (uint8_t i = 0; i < count; i++)
+        Serial.printf("BOOT,%u,%u,%s\n", (unsigned)marks[i].us, marks[i].core, marks[i].name);
+    if (boot_interactive_us)
+        Serial.printf("BOOT,time to first frame %u us, time to interactive %u us\n",
+                      (unsigned)boot_first_frame_us, (unsigned)boot_interactive_us);
+    else
+        Serial.printf("BOOT,time to first frame %u us, not interactive after %u ms\n",
+                      (unsigned)boot_first_frame_us, (unsigned)(micros() / 1000));
+    boot_timeline_printed = boot_interactive_us ? 2 : 1;
+}
+
+/* Prints the timeline once the interactive mark exists, or on timeout and
+   again when the mark lands */
+void boot_timeline_poll()
+{
+    if (boot_timeline_printed == 2)
+        return;
+    if (boot_interactive_us || (!boot_timeline_printed && millis() >= BOOT_PRINT_TIMEOUT_MS))
+        boot_timeline_print();
+}
+
+#endif // _BOOT_TIMELINE_H
@@ -0,0 +1,139 @@
+/*******************************************************************************
+ * Host runner for the spectrum meter benchmark (see ../audio_meter.h)
+ *
+ * Build:  g++ -O2 -I. -I.. -I../../../libraries/q15_dsp/src audio_meter_bench.cpp -o audio_meter_bench
+ *
+ *   audio_meter_bench
+ *
+ * Runs audio_meter_bench() on the rectangle renderer of host/lvgl.h, which
+ * stands in for LVGL's draw of the widget's segments. After every refresh
+ * the invalidated segments must leave the frame buffer exactly as a full
+ * redraw of the widget would, so the pixel budget never leaves a stale
+ * segment behind. Bars jumping at random every frame must each be drawn
+ * within audio_meter_max_wait() frames. Also checks that the bench waits for
+ * the published levels,
+ * that loud audio reaches on_activity with its capture time and quiet audio
+ * does not, and that no audio is dropped. Exits non-zero if a check fails.
+ ******************************************************************************/
+#include <stdio.h>
+#include "lvgl.h"
+#include "audio_meter.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                     \
+    do                                       \
+    {                                        \
+        if (!(cond))                         \
+        {                                    \
+            printf("FAIL %s: ", #cond);      \
+            printf(__VA_ARGS__);             \
+            printf("\n");                    \
+            failures++;                      \
+        }                                    \
+    } while (0)
+
+static uint32_t refreshes = 0, stale = 0;
+static uint32_t activity_calls = 0, last_event_ms = 0;
+static bool event_in_future = false;
+
+/* Incremental refresh, then the widget redrawn in full must not change a pixel */
+static void check_refresh(lv_disp_t *disp)
+{
+    static uint16_t incremental[LV_VER_RES][LV_HOR_RES];
+    lv_sim_render(disp);
+    memcpy(incremental, lv_sim_fb, sizeof(lv_sim_fb));
+    for (lv_obj_t &o : lv_sim_objs)
+        if (o.used && o.user_data)
+            lv_sim_draw(&o.coords);
+    refreshes++;
+    stale += memcmp(incremental, lv_sim_fb, sizeof(lv_sim_fb)) != 0;
+}
+
+static void on_activity(uint32_t event_ms)
+{
+    activity_calls++;
+    event_in_future |= event_ms > audio_meter_us() / 1000;
+    last_event_ms = event_ms;
+}
+
+/* Blocks queued but not analysed yet are not published */
+static void test_wait_published()
+{
+    int16_t pcm[AUDIO_METER_BLOCK] = {0};
+    audio_meter_push(pcm, AUDIO_METER_BLOCK);
+    uint32_t head = audio_meter_head.load();
+    CHECK(!audio_meter_wait_published(head, 1), "levels reported before the analysis ran");
+    audio_meter_analyze();
+    CHECK(audio_meter_wait_published(head, 1), "levels not published after the analysis");
+}
+
+/* Room noise must not count as activity */
+static void test_quiet()
+{
+    int16_t pcm[AUDIO_METER_BLOCK];
+    int32_t levels[AUDIO_METER_COLS];
+    uint32_t before, after;
+    audio_meter_read(levels, &before);
+    for (int b = 0; b < 20; b++)
+    {
+        for (int i = 0; i < AUDIO_METER_BLOCK; i++)
+            pcm[i] = (int16_t)(rand() % 101 - 50);
+        audio_meter_push(pcm, AUDIO_METER_BLOCK);
+        audio_meter_analyze();
+    }
+    audio_meter_read(levels, &after);
+    CHECK(after == before, "room noise at %d Q8 counted as activity", (int)levels[0]);
+    CHECK(levels[0] < AUDIO_METER_WAKE_Q8, "room noise level %d Q8", (int)levels[0]);
+}
+
+/* Every bar jumps to a random height each frame: the budget defers most of
+ * them, none for longer than the bound */
+static void test_deferred_bound()
+{
+    lv_obj_t *prev = lv_scr_act();
+    lv_obj_t *scr = lv_obj_create(NULL);
+    lv_scr_load(scr);
+    lv_obj_t *meter = audio_meter_create(scr, 300, 230); // one full bar per budget
+    lv_obj_center(meter);
+    audio_meter_t *m = (audio_meter_t *)lv_obj_get_user_data(meter);
+    lv_timer_pause(m->timer);
+    lv_refr_now(NULL);
+    audio_meter_stats = audio_meter_stats_t();
+
+    for (int f = 0; f < 300; f++)
+    {
+        for (int c = 0; c < AUDIO_METER_COLS; c++)
+            audio_meter_levels[c] = rand() % 4 ? 0 : c ? AUDIO_METER_TOP_Q8 : AUDIO_METER_LEVEL_TOP_Q8;
+        audio_meter_update(meter);
+        lv_refr_now(NULL);
+    }
+    uint32_t bound = audio_meter_max_wait(meter);
+    CHECK(audio_meter_stats.deferred > 300, "only %u bar updates deferred", (unsigned)audio_meter_stats.deferred);
+    CHECK(audio_meter_stats.max_wait <= bound, "a bar waited %u frames, bound %u", (unsigned)audio_meter_stats.max_wait,
+          (unsigned)bound);
+    printf("deferred bars: %u deferrals, longest wait %u frames, bound %u\n", (unsigned)audio_meter_stats.deferred,
+           (unsigned)audio_meter_stats.max_wait, (unsigned)bound);
+    lv_scr_load(prev);
+    lv_obj_del(scr);
+}
+
+int main()
+{
+    srand(1);
+    audio_meter_begin(on_activity);
+    test_wait_published();
+    test_quiet();
+
+    lv_sim_refresh = check_refresh;
+    CHECK(audio_meter_bench(), "bench failed");
+    CHECK(refreshes >= AUDIO_METER_BENCH_FRAMES, "%u refreshes", (unsigned)refreshes);
+    CHECK(!stale, "%u of %u refreshes left stale segments", (unsigned)stale, (unsigned)refreshes);
+    CHECK(activity_calls > 0 && !event_in_future, "speech: %u activity calls", (unsigned)activity_calls);
+    CHECK(!audio_meter_stats.dropped, "%u samples dropped", (unsigned)audio_meter_stats.dropped);
+    test_deferred_bound();
+    CHECK(!stale, "%u of %u refreshes left stale segments", (unsigned)stale, (unsigned)refreshes);
+
+    printf("%s: %d failed checks\n", failures ? "FAIL" : "PASS", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,230 @@
+/*******************************************************************************
+ * Wake-up latency and energy of the activity governor (see ../power_governor.h)
+ *
+ * Build:  g++ -O2 -I. -I.. -I../../../ESP32 governor_sim.cpp -o governor_sim
+ *
+ *   governor_sim [touches] [seed]
+ *
+ * Runs loop() as the sketch does (lv_timer_handler(), then governor_wait())
+ * on the governor's virtual clock, with the LVGL timers of host/lvgl.h. Each
+ * touch comes after a random quiet time of 12..150 s, so it lands in IDLE or
+ * DOZE, and is held for 200 ms; the touch read timer polls it at the period
+ * the governor set. The event time is worked out as touch.h does:
+ *   polled  GT911 INT not wired: the last read that still saw no contact
+ *   irq     GT911 INT wired: the interrupt edge, i.e. the real touch time
+ *   key     a key of the ESP32/keypad.h simulation instead of a touch, its
+ *           events polled in loop() and passed on with their debounced time
+ * A loud audio block in between must wake the governor as well.
+ * One line per mode and state:
+ *   BENCH,governor,<mode>,<state>,<wakes>,<p50 ms>,<max ms>,<reported max ms>,<bound ms>
+ * where p50/max are the true touch-to-wake latencies and reported is the
+ * governor's wake_latency_max_ms. Exits non-zero if a latency exceeds the
+ * read period of its state (plus the debounce for keys) or the governor
+ * under-reports it.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "lvgl.h"
+#include "power_governor.h"
+#include "keypad.h"
+
+#define TOUCH_HOLD_MS 200
+#define KEY_DEBOUNCE_MS ((KEYPAD_INTEGRATOR_MAX + 1) * KEYPAD_SCAN_PERIOD_MS)
+#define LOOP_WORK_US 300           // lv_timer_handler() and the rest of loop()
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                     \
+    do                                       \
+    {                                        \
+        if (!(cond))                         \
+        {                                    \
+            printf("FAIL %s: ", #cond);      \
+            printf(__VA_ARGS__);             \
+            printf("\n");                    \
+            failures++;                      \
+        }                                    \
+    } while (0)
+
+static uint32_t sim_tick_ms() { return gov_now_ms(); }
+
+/* Scripted panel and the touch.h event time bookkeeping */
+static bool use_irq;
+static uint32_t touch_at_ms, touch_until_ms;
+static bool touch_down, touch_seen;
+static uint32_t touch_idle_read_ms;
+static uint8_t touch_state;                // governor state when the finger landed
+static std::vector<uint32_t> latency[3];   // true latency per state
+static bool key_pending;                   // key closed, press not seen by loop() yet
+static uint32_t key_at_ms;
+
+static void read_cb(lv_timer_t *)
+{
+    uint32_t now = gov_now_ms();
+    bool touched = now >= touch_at_ms && now < touch_until_ms;
+    if (touched && !touch_down && !touch_seen)
+    {
+        touch_seen = true;
+        latency[touch_state].push_back(now - touch_at_ms);
+        governor_activity(GOV_SRC_TOUCH, use_irq ? touch_at_ms : touch_idle_read_ms);
+    }
+    else if (touched)
+    {
+        governor_activity(GOV_SRC_TOUCH, now);
+    }
+    touch_down = touched;
+    if (!touched)
+        touch_idle_read_ms = now;
+}
+
+/* loop()'s keypad poll, as the sketch documents it */
+static void poll_keys()
+{
+    keypad_event_t ev;
+    while (keypad_get_event(&ev))
+    {
+        if (ev.type == KEYPAD_PRESS && key_pending)
+        {
+            key_pending = false;
+            latency[touch_state].push_back(gov_now_ms() - key_at_ms);
+        }
+        bool asleep = gov_state != GOV_ACTIVE;
+        uint32_t before = gov_stats.wakes[GOV_SRC_KEY];
+        governor_activity(GOV_SRC_KEY, ev.time_ms);
+        CHECK(!asleep || gov_stats.wakes[GOV_SRC_KEY] == before + 1, "key wake not counted");
+    }
+}
+
+/* The keypad's scan timer runs on its own during the governor's waits */
+static void keypad_catch_up() { keypad_sim_advance(gov_now_ms() - keypad_sim_time_ms); }
+
+/* Runs loop() until the virtual clock reaches end_ms */
+static void run_until(uint32_t end_ms)
+{
+    while (gov_now_ms() < end_ms)
+    {
+        uint32_t next_ms = lv_timer_handler();
+        poll_keys();
+        gov_sim_time_us += LOOP_WORK_US;
+        uint32_t left = end_ms - gov_now_ms();
+        if ((int32_t)left > 0 && next_ms > left)
+            next_ms = left;
+        governor_wait(next_ms);
+        keypad_catch_up();
+    }
+}
+
+enum
+{
+    MODE_POLLED,
+    MODE_IRQ,
+    MODE_KEY
+};
+
+static void run(uint8_t mode, uint32_t touches)
+{
+    static const char *names[] = {"active", "idle", "doze"};
+    static const char *modes[] = {"polled", "irq", "key"};
+    bool irq = mode == MODE_IRQ;
+    use_irq = irq;
+    for (auto &v : latency)
+        v.clear();
+    gov_sim_time_us = 0;
+    gov_stats = gov_stats_t();
+    lv_sim_tick_ms = sim_tick_ms;
+    lv_indev_t indev;
+    indev.read_timer = lv_timer_create(read_cb, LV_INDEV_DEF_READ_PERIOD, NULL);
+    lv_sim_disp.refr_timer = lv_timer_create(_lv_disp_refr_timer, LV_DISP_DEF_REFR_PERIOD, &lv_sim_disp);
+    governor_begin(&indev, NULL);
+    touch_at_ms = touch_until_ms = 0;
+    touch_down = false;
+    touch_idle_read_ms = 0;
+    keypad_sim_time_ms = 0;
+    keypad_init();
+
+    uint32_t audio_wakes = 0;
+    for (uint32_t i = 0; i < touches; i++)
+    {
+        // random phase against the read timer, so polling adds 0..period
+        uint32_t quiet_ms = 12000 + rand() % 138000;
+        uint32_t at = gov_now_ms() + quiet_ms;
+        run_until(at - 1);
+        gov_sim_time_us += rand() % 1000;
+        touch_state = gov_state;
+        if (mode == MODE_KEY)
+        {
+            keypad_catch_up();
+            key_at_ms = gov_now_ms();
+            key_pending = true;
+            keypad_sim_set_key(1, 1, true);
+            run_until(key_at_ms + TOUCH_HOLD_MS);
+            keypad_sim_set_key(1, 1, false);
+            run_until(key_at_ms + TOUCH_HOLD_MS + 100);
+            CHECK(!key_pending && gov_state == GOV_ACTIVE, "key %u did not wake the governor", (unsigned)i);
+        }
+        else
+        {
+            touch_at_ms = gov_now_ms();
+            touch_until_ms = touch_at_ms + TOUCH_HOLD_MS;
+            touch_seen = false;
+            run_until(touch_until_ms + 100);
+            CHECK(touch_seen && gov_state == GOV_ACTIVE, "touch %u not seen", (unsigned)i);
+        }
+
+        // every tenth quiet period ends with speech instead
+        if (i % 10 == 9)
+        {
+            run_until(gov_now_ms() + GOV_IDLE_MS + 1000);
+            uint32_t before = gov_stats.wakes[GOV_SRC_AUDIO];
+            governor_activity(GOV_SRC_AUDIO, gov_now_ms() - 16);
+            audio_wakes++;
+            CHECK(gov_state == GOV_ACTIVE && gov_stats.wakes[GOV_SRC_AUDIO] == before + 1, "audio did not wake");
+        }
+    }
+
+    bool ok = true;
+    for (uint8_t s = GOV_IDLE; s <= GOV_DOZE; s++)
+    {
+        std::vector<uint32_t> &v = latency[s];
+        if (v.empty())
+            continue;
+        std::sort(v.begin(), v.end());
+        uint32_t bound = gov_profiles[s].indev_ms + (mode == MODE_KEY ? KEY_DEBOUNCE_MS : 0);
+        printf("BENCH,governor,%s,%s,%u,%u,%u,%u,%u\n", modes[mode], names[s], (unsigned)v.size(),
+               (unsigned)v[v.size() / 2], (unsigned)v.back(), (unsigned)gov_stats.wake_latency_max_ms,
+               (unsigned)bound);
+        CHECK(v.back() <= bound, "%s: %u ms over the %u ms read period", names[s], (unsigned)v.back(),
+              (unsigned)bound);
+        // a key event is stamped when the debounce settles, after the contact
+        uint32_t stamp_lag = mode == MODE_KEY ? KEY_DEBOUNCE_MS : 0;
+        CHECK(gov_stats.wake_latency_max_ms + stamp_lag >= v.back(), "%s: reported %u ms, real %u ms", names[s],
+              (unsigned)gov_stats.wake_latency_max_ms, (unsigned)v.back());
+        ok &= !v.empty();
+    }
+    CHECK(!latency[GOV_IDLE].empty() && !latency[GOV_DOZE].empty(), "touches did not reach both states");
+    CHECK(gov_stats.wake_latency_max_ms > 0, "wake latency not measured");
+    if (irq)
+    {
+        uint32_t worst = std::max(latency[GOV_IDLE].back(), latency[GOV_DOZE].back());
+        CHECK(gov_stats.wake_latency_max_ms <= worst + 1, "irq: reported %u ms, real %u ms",
+              (unsigned)gov_stats.wake_latency_max_ms, (unsigned)worst);
+    }
+
+    lv_timer_del(indev.read_timer);
+    lv_timer_del(lv_sim_disp.refr_timer);
+    lv_sim_disp.refr_timer = NULL;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t touches = argc > 1 ? atoi(argv[1]) : 100;
+    srand(argc > 2 ? atoi(argv[2]) : 1);
+    run(MODE_POLLED, touches);
+    run(MODE_IRQ, touches);
+    run(MODE_KEY, touches);
+    printf("%s: %d failed checks\n", failures ? "FAIL" : "PASS", failures);
+    return failures ? 1 : 0;
+}
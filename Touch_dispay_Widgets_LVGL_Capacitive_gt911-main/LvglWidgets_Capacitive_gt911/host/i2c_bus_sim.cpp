@@ -0,0 +1,129 @@
+/*******************************************************************************
+ * Touch latency under a saturating OLED load (see ../i2c_bus.h)
+ *
+ * Build:  g++ -O2 -I.. i2c_bus_sim.cpp -o i2c_bus_sim
+ *
+ *   i2c_bus_sim [seconds]
+ *
+ * Runs the bus manager on its 400 kHz host model. The OLED keeps the low
+ * priority queue full with back-to-back frame writes while a GT911 read
+ * (TOUCH_GT911_READ_BYTES on the bus, as in touch.h) is submitted every
+ * 10 ms at a random phase. Three configurations:
+ *   priority   OLED in 128-byte chunks (oled.h), touch at high priority
+ *   fifo       same chunks, touch queued at low priority behind them
+ *   unchunked  one 1 KB write per frame (Adafruit-style display()), touch
+ *              at high priority: it can only get in between frames
+ * One line per configuration:
+ *   BENCH,i2c_touch,<config>,<reads>,<p50 us>,<p99 us>,<max us>,<oled util %>
+ * Exits non-zero if the prioritised, chunked bus does not bound the touch
+ * latency to one OLED chunk plus the read itself.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "i2c_bus.h"
+
+#define TOUCH_GT911_READ_BYTES 50
+#define TOUCH_PERIOD_US 10000
+#define OLED_CHUNK 128                 // control byte + OLED_I2C_CHUNK data bytes
+#define OLED_FRAME 1025
+#define OLED_INFLIGHT 4
+
+static uint8_t oled_data[OLED_FRAME];
+static i2c_txn_t oled_txns[OLED_INFLIGHT];
+static i2c_txn_t touch_txn;
+static bool touch_queued;
+static std::vector<uint32_t> touch_latency;
+
+static bool touch_read(void *) { return true; }
+
+static void touch_done(i2c_txn_t *t, bool)
+{
+    touch_latency.push_back((uint32_t)(i2c_bus_now_us() - t->submit_us));
+    touch_queued = false;
+}
+
+/* Each completed OLED write queues the next one: the queue never drains */
+static void oled_done(i2c_txn_t *t, bool) { i2c_bus_submit(t); }
+
+static void reset()
+{
+    memset(i2c_bus_stats, 0, sizeof(i2c_bus_stats));
+    memset(i2c_bus_head, 0, sizeof(i2c_bus_head));
+    memset(i2c_bus_tail, 0, sizeof(i2c_bus_tail));
+    i2c_bus_sim_time_ns = 0;
+    touch_latency.clear();
+    touch_queued = false;
+    i2c_bus_init();
+}
+
+/* Returns the worst touch latency in us */
+static uint32_t run(const char *name, size_t oled_write, uint8_t touch_prio, uint32_t seconds)
+{
+    reset();
+    for (int i = 0; i < OLED_INFLIGHT; i++)
+    {
+        i2c_txn_t *t = &oled_txns[i];
+        memset(t, 0, sizeof(*t));
+        t->client = I2C_CLIENT_OLED;
+        t->prio = I2C_PRIO_LOW;
+        t->type = I2C_TXN_WRITE;
+        t->addr = 0x3C;
+        t->tx = oled_data;
+        t->tx_len = oled_write;
+        t->done = oled_done;
+        i2c_bus_submit(t);
+    }
+
+    srand(1);
+    uint64_t end_ns = (uint64_t)seconds * 1000000000ULL;
+    for (uint64_t period = 0; period * TOUCH_PERIOD_US * 1000 < end_ns; period++)
+    {
+        uint64_t at_ns = (period * TOUCH_PERIOD_US + rand() % TOUCH_PERIOD_US) * 1000;
+        i2c_bus_sim_run(at_ns);
+        if (!touch_queued)
+        {
+            memset(&touch_txn, 0, sizeof(touch_txn));
+            touch_txn.client = I2C_CLIENT_TOUCH;
+            touch_txn.prio = touch_prio;
+            touch_txn.type = I2C_TXN_CALL;
+            touch_txn.fn = touch_read;
+            touch_txn.est_bytes = TOUCH_GT911_READ_BYTES;
+            touch_txn.done = touch_done;
+            touch_queued = i2c_bus_submit(&touch_txn);
+            // the model runs a transfer to its end before the clock is read
+            // again: the read really arrived at at_ns, mid-transfer
+            touch_txn.submit_us = at_ns / 1000;
+        }
+        i2c_bus_sim_run((period + 1) * TOUCH_PERIOD_US * 1000);
+    }
+
+    std::sort(touch_latency.begin(), touch_latency.end());
+    size_t n = touch_latency.size();
+    uint32_t max = n ? touch_latency[n - 1] : 0;
+    const i2c_client_stats_t *oled = &i2c_bus_stats[I2C_CLIENT_OLED];
+    printf("BENCH,i2c_touch,%s,%u,%u,%u,%u,%u\n", name, (unsigned)n, n ? (unsigned)touch_latency[n / 2] : 0,
+           n ? (unsigned)touch_latency[n * 99 / 100] : 0, (unsigned)max,
+           (unsigned)(oled->busy_us * 100 / (i2c_bus_now_us() - i2c_bus_stats_start_us)));
+    return max;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t seconds = argc > 1 ? atoi(argv[1]) : 60;
+    for (size_t i = 0; i < sizeof(oled_data); i++)
+        oled_data[i] = (uint8_t)i;
+
+    uint32_t prio_max = run("priority", OLED_CHUNK, I2C_PRIO_HIGH, seconds);
+    i2c_bus_print_stats();
+    uint32_t fifo_max = run("fifo", OLED_CHUNK, I2C_PRIO_LOW, seconds);
+    uint32_t unchunked_max = run("unchunked", OLED_FRAME, I2C_PRIO_HIGH, seconds);
+
+    // worst case: the read arrives just after an OLED chunk started
+    uint32_t bound_us = (uint32_t)((1 + OLED_CHUNK + TOUCH_GT911_READ_BYTES) * I2C_BUS_NS_PER_BYTE / 1000) + 1;
+    bool ok = prio_max <= bound_us && prio_max < fifo_max && prio_max < unchunked_max;
+    printf("BENCH,i2c_touch,bound,%u us,%s\n", (unsigned)bound_us, ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * Host test for the touch-to-photon tracer (see ../latency_trace.h)
+ *
+ * Build:  g++ -O2 -I.. latency_trace_test.cpp -o latency_trace_test
+ *
+ *   latency_trace_test
+ *
+ * Drives the trace points in the order the sketch hits them, with sleeps
+ * standing in for each stage: a render of RENDER_US between render_start_cb
+ * and the first flush, a TE wait of TE_US before it goes to the panel, and
+ * two flushes per frame as with the half-screen draw buffer. Every stage must
+ * see every input and at least its sleep; render_done must not collapse into
+ * flush_start. A second pass leaves out the render_start_cb. Ends with
+ * latency_trace_bench() and exits non-zero if any check fails.
+ ******************************************************************************/
+#define LATENCY_TRACE
+#include <string.h>
+#include <unistd.h>
+#include "latency_trace.h"
+
+#define INPUTS 50
+#define RENDER_US 2000
+#define TE_US 1000
+#define FLUSH_US 500
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                     \
+    do                                       \
+    {                                        \
+        if (!(cond))                         \
+        {                                    \
+            printf("FAIL %s: ", #cond);      \
+            printf(__VA_ARGS__);             \
+            printf("\n");                    \
+            failures++;                      \
+        }                                    \
+    } while (0)
+
+static uint32_t stage_count(uint8_t p)
+{
+    uint32_t n = 0;
+    for (uint8_t b = 0; b < LAT_BUCKETS; b++)
+        n += latency_hist[p][b];
+    return n;
+}
+
+static void reset()
+{
+    memset(latency_hist, 0, sizeof(latency_hist));
+    memset(latency_max_us, 0, sizeof(latency_max_us));
+}
+
+/* One input through a two-flush frame, as my_disp_flush sees it */
+static void frame(bool render_start_cb)
+{
+    latency_trace_sample();
+    latency_trace_mark(LAT_INDEV_READ);
+    latency_trace_mark(LAT_EVENT_CB);
+    latency_trace_mark(LAT_INVALIDATE);
+    if (render_start_cb)
+        latency_trace_mark(LAT_RENDER_START);
+    usleep(RENDER_US);
+    for (int area = 0; area < 2; area++)
+    {
+        latency_trace_mark(LAT_RENDER_DONE);
+        usleep(TE_US);
+        latency_trace_mark(LAT_FLUSH_START);
+        usleep(FLUSH_US);
+        latency_trace_flush_end(area == 1);
+    }
+}
+
+static void test_stages()
+{
+    reset();
+    for (int i = 0; i < INPUTS; i++)
+        frame(true);
+    latency_trace_print();
+    for (uint8_t p = 0; p < LAT_POINTS; p++)
+        CHECK(stage_count(p) == INPUTS, "stage %u: %u of %u inputs", p, (unsigned)stage_count(p), INPUTS);
+    // the lower edge of the p50 bucket is half its upper edge
+    CHECK(latency_percentile(LAT_RENDER_DONE, INPUTS, 500) * 2 > RENDER_US, "render_done p50 %u us",
+          (unsigned)latency_percentile(LAT_RENDER_DONE, INPUTS, 500));
+    CHECK(latency_percentile(LAT_FLUSH_START, INPUTS, 500) * 2 > TE_US, "flush_start p50 %u us",
+          (unsigned)latency_percentile(LAT_FLUSH_START, INPUTS, 500));
+    CHECK(latency_percentile(LAT_FLUSH_END, INPUTS, 500) * 2 > FLUSH_US + TE_US + FLUSH_US, "flush_end p50 %u us",
+          (unsigned)latency_percentile(LAT_FLUSH_END, INPUTS, 500));
+}
+
+/* No render_start_cb: the frame is matched at the first flush */
+static void test_without_render_start()
+{
+    reset();
+    for (int i = 0; i < INPUTS; i++)
+        frame(false);
+    CHECK(stage_count(LAT_RENDER_START) == 0, "render_start counted without the callback");
+    CHECK(stage_count(LAT_RENDER_DONE) == INPUTS && stage_count(LAT_TOUCH_SAMPLE) == INPUTS,
+          "without render_start_cb: %u frames", (unsigned)stage_count(LAT_TOUCH_SAMPLE));
+}
+
+/* A frame with no input behind it is not counted */
+static void test_idle_frame()
+{
+    reset();
+    latency_trace_mark(LAT_RENDER_START);
+    latency_trace_mark(LAT_RENDER_DONE);
+    latency_trace_mark(LAT_FLUSH_START);
+    latency_trace_flush_end(true);
+    CHECK(stage_count(LAT_TOUCH_SAMPLE) == 0, "idle frame counted");
+}
+
+int main()
+{
+    test_stages();
+    test_without_render_start();
+    test_idle_frame();
+    CHECK(latency_trace_bench(), "trace point over %u ns", LATENCY_MARK_MAX_NS);
+    CHECK(!latency_last_id && !latency_active_id && !latency_frame_id, "bench left an input open");
+
+    printf("%s: %d failed checks\n", failures ? "FAIL" : "PASS", failures);
+    return failures ? 1 : 0;
+}
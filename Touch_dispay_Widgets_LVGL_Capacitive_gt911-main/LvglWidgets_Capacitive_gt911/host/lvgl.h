@@ -0,0 +1,1281 @@
+/*******************************************************************************
+ * Host stand-in for the LVGL 8.3 calls the timer-driven modules make
+ * (power_governor.h, te_pacing.h) and for custom-drawn widgets
+ * (audio_meter.h, num_label.h). Timers run from lv_timer_handler() as in LVGL
+ * and the tick comes from the harness's lv_sim_tick_ms hook, so a simulation
+ * can put the modules on the same virtual clock it drives them with.
+ *
+ * Objects are rectangles with event callbacks. A refresh (the refresh timer
+ * or lv_refr_now()) pauses the refresh timer until the next invalidation, as
+ * LVGL does, and calls the harness's lv_sim_refresh hook if set. Otherwise
+ * the invalid areas are joined as LVGL joins them and the object tree of the
+ * active screen is drawn into each one, parents first, every object clipped
+ * to its parent: by the default theme-less draw of its widget kind, then its
+ * LV_EVENT_DRAW_MAIN callbacks.
+ *   - without a display driver everything is drawn straight into lv_sim_fb
+ *   - with lv_disp_drv_register(), areas are rendered in row bands into the
+ *     driver's draw buffer on a white screen and handed to its flush_cb, as
+ *     LVGL does with one buffer
+ *
+ * Enough of the demo's widgets to drive it through a pointer indev: buttons,
+ * sliders, labels in a bitmap font with placeholder glyph shapes (4 bpp,
+ * drawn through the same unpack + blend path as LVGL's letters), and a
+ * tabview whose content scrolls with the finger and snaps to a tab with an
+ * animation. No styles, padding or scroll momentum; lv_mem_monitor() counts
+ * the stub's own allocations.
+ *
+ * Only for the single-file harnesses in this folder: everything is static.
+ ******************************************************************************/
+#ifndef _HOST_LVGL_H
+#define _HOST_LVGL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LV_HOR_RES 320
+#define LV_VER_RES 240
+#define LV_INV_BUF_SIZE 32
+#define LV_SIM_OBJS 48
+#define LV_DISP_DEF_REFR_PERIOD 15
+#define LV_INDEV_DEF_READ_PERIOD 30
+#define LV_INDEV_DEF_SCROLL_LIMIT 10
+#define LV_NO_TIMER_READY 0xFFFFFFFF
+#define LV_MEM_SIZE (48U * 1024U)
+#define LV_COLOR_16_SWAP 0
+#define LV_SIM_SCROLL_ANIM_MS 200      // tab snap after a swipe
+#define LV_SIM_SLIDER_KNOB 6           // knob overhang around the slider's track
+#define LV_SIM_BTN_SHADOW 4            // button shadow around its box
+
+/*******************************************************************************
+ * Memory accounting
+ ******************************************************************************/
+typedef struct
+{
+    uint32_t total_size;
+    uint32_t free_cnt;
+    uint32_t free_size;
+    uint32_t free_biggest_size;
+    uint32_t used_cnt;
+    uint32_t max_used;
+    uint8_t used_pct;
+    uint8_t frag_pct;
+} lv_mem_monitor_t;
+
+static uint32_t lv_sim_mem_used = 0, lv_sim_mem_max = 0, lv_sim_mem_cnt = 0;
+
+static inline void *lv_mem_alloc(size_t size)
+{
+    size_t *p = (size_t *)calloc(1, sizeof(size_t) + size);
+    *p = size;
+    lv_sim_mem_used += size;
+    lv_sim_mem_cnt++;
+    if (lv_sim_mem_used > lv_sim_mem_max)
+        lv_sim_mem_max = lv_sim_mem_used;
+    return p + 1;
+}
+
+static inline void lv_mem_free(void *data)
+{
+    if (!data)
+        return;
+    size_t *p = (size_t *)data - 1;
+    lv_sim_mem_used -= *p;
+    lv_sim_mem_cnt--;
+    free(p);
+}
+
+static inline void lv_mem_monitor(lv_mem_monitor_t *mon)
+{
+    memset(mon, 0, sizeof(*mon));
+    mon->total_size = LV_MEM_SIZE;
+    mon->free_size = LV_MEM_SIZE - lv_sim_mem_used;
+    mon->free_biggest_size = mon->free_size;
+    mon->free_cnt = 1;
+    mon->used_cnt = lv_sim_mem_cnt;
+    mon->max_used = lv_sim_mem_max;
+    mon->used_pct = (uint8_t)(100 * lv_sim_mem_used / LV_MEM_SIZE);
+}
+
+/*******************************************************************************
+ * Timers
+ ******************************************************************************/
+struct _lv_timer_t;
+typedef void (*lv_timer_cb_t)(struct _lv_timer_t *);
+
+typedef struct _lv_timer_t
+{
+    uint32_t period;
+    uint32_t last_run;
+    lv_timer_cb_t timer_cb;
+    void *user_data;
+    bool paused;
+    struct _lv_timer_t *next;
+} lv_timer_t;
+
+/* Harness hooks */
+static uint32_t (*lv_sim_tick_ms)(void) = NULL;
+
+static lv_timer_t *lv_sim_timers = NULL;
+
+static inline uint32_t lv_tick_get() { return lv_sim_tick_ms ? lv_sim_tick_ms() : 0; }
+
+static lv_timer_t *lv_timer_create(lv_timer_cb_t cb, uint32_t period, void *user_data)
+{
+    lv_timer_t *t = (lv_timer_t *)lv_mem_alloc(sizeof(lv_timer_t));
+    t->period = period;
+    t->last_run = lv_tick_get();
+    t->timer_cb = cb;
+    t->user_data = user_data;
+    t->next = lv_sim_timers;
+    lv_sim_timers = t;
+    return t;
+}
+
+static inline void lv_timer_del(lv_timer_t *t)
+{
+    for (lv_timer_t **p = &lv_sim_timers; *p; p = &(*p)->next)
+    {
+        if (*p == t)
+        {
+            *p = t->next;
+            lv_mem_free(t);
+            return;
+        }
+    }
+}
+
+static inline void lv_timer_set_period(lv_timer_t *t, uint32_t period) { t->period = period; }
+static inline void lv_timer_set_cb(lv_timer_t *t, lv_timer_cb_t cb) { t->timer_cb = cb; }
+static inline void lv_timer_pause(lv_timer_t *t) { t->paused = true; }
+static inline void lv_timer_resume(lv_timer_t *t) { t->paused = false; }
+static inline void lv_timer_ready(lv_timer_t *t) { t->last_run = lv_tick_get() - t->period - 1; }
+
+/* Runs the due timers; returns the ms until the next one is due */
+static inline uint32_t lv_timer_handler()
+{
+    uint32_t now = lv_tick_get();
+    for (lv_timer_t *t = lv_sim_timers, *next; t; t = next)
+    {
+        next = t->next; // a callback may delete its own timer
+        if (!t->paused && now - t->last_run >= t->period)
+        {
+            t->last_run = now;
+            t->timer_cb(t);
+        }
+    }
+    uint32_t wait = LV_NO_TIMER_READY;
+    now = lv_tick_get();
+    for (lv_timer_t *t = lv_sim_timers; t; t = t->next)
+    {
+        if (t->paused)
+            continue;
+        uint32_t elapsed = now - t->last_run;
+        uint32_t left = elapsed >= t->period ? 0 : t->period - elapsed;
+        if (left < wait)
+            wait = left;
+    }
+    return wait;
+}
+
+/*******************************************************************************
+ * Colours, areas and the display
+ ******************************************************************************/
+typedef int16_t lv_coord_t;
+typedef uint8_t lv_opa_t;
+
+#define LV_OPA_TRANSP 0
+#define LV_OPA_MIN 2
+#define LV_OPA_MAX 253
+#define LV_OPA_COVER 255
+
+typedef struct
+{
+    lv_coord_t x1, y1, x2, y2;
+} lv_area_t;
+
+typedef struct
+{
+    lv_coord_t x, y;
+} lv_point_t;
+
+typedef union
+{
+    uint16_t full;           // RGB565
+} lv_color_t;
+
+static inline uint32_t lv_area_get_size(const lv_area_t *a) { return (uint32_t)(a->x2 - a->x1 + 1) * (a->y2 - a->y1 + 1); }
+static inline lv_coord_t lv_area_get_width(const lv_area_t *a) { return (lv_coord_t)(a->x2 - a->x1 + 1); }
+static inline lv_coord_t lv_area_get_height(const lv_area_t *a) { return (lv_coord_t)(a->y2 - a->y1 + 1); }
+
+static inline bool _lv_area_intersect(lv_area_t *r, const lv_area_t *a, const lv_area_t *b)
+{
+    r->x1 = a->x1 > b->x1 ? a->x1 : b->x1;
+    r->y1 = a->y1 > b->y1 ? a->y1 : b->y1;
+    r->x2 = a->x2 < b->x2 ? a->x2 : b->x2;
+    r->y2 = a->y2 < b->y2 ? a->y2 : b->y2;
+    return r->x1 <= r->x2 && r->y1 <= r->y2;
+}
+
+static inline void _lv_area_join(lv_area_t *r, const lv_area_t *a, const lv_area_t *b)
+{
+    r->x1 = a->x1 < b->x1 ? a->x1 : b->x1;
+    r->y1 = a->y1 < b->y1 ? a->y1 : b->y1;
+    r->x2 = a->x2 > b->x2 ? a->x2 : b->x2;
+    r->y2 = a->y2 > b->y2 ? a->y2 : b->y2;
+}
+
+static inline bool _lv_area_is_point_on(const lv_area_t *a, const lv_point_t *p)
+{
+    return p->x >= a->x1 && p->x <= a->x2 && p->y >= a->y1 && p->y <= a->y2;
+}
+
+static inline lv_color_t lv_color_hex(uint32_t c)
+{
+    lv_color_t r;
+    r.full = (uint16_t)(((c >> 8) & 0xF800) | ((c >> 5) & 0x07E0) | ((c & 0xFF) >> 3));
+    return r;
+}
+
+/* c1 weighted by mix/255 over c2, per RGB565 channel like LV_COLOR_MIX */
+static inline lv_color_t lv_color_mix(lv_color_t c1, lv_color_t c2, uint8_t mix)
+{
+    uint32_t r1 = c1.full >> 11, g1 = (c1.full >> 5) & 0x3F, b1 = c1.full & 0x1F;
+    uint32_t r2 = c2.full >> 11, g2 = (c2.full >> 5) & 0x3F, b2 = c2.full & 0x1F;
+    lv_color_t r;
+    r.full = (uint16_t)((((r1 * mix + r2 * (255 - mix) + 128) >> 8) << 11) |
+                        (((g1 * mix + g2 * (255 - mix) + 128) >> 8) << 5) |
+                        ((b1 * mix + b2 * (255 - mix) + 128) >> 8));
+    return r;
+}
+
+struct _lv_disp_drv_t;
+typedef struct
+{
+    void *buf1;
+    void *buf2;
+    uint32_t size;           // in pixels
+    volatile int flushing;
+    volatile int flushing_last;
+} lv_disp_draw_buf_t;
+
+typedef struct _lv_disp_drv_t
+{
+    lv_coord_t hor_res, ver_res;
+    lv_disp_draw_buf_t *draw_buf;
+    void (*flush_cb)(struct _lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_p);
+    void (*render_start_cb)(struct _lv_disp_drv_t *drv);
+    void *user_data;
+} lv_disp_drv_t;
+
+typedef struct
+{
+    lv_disp_drv_t *driver;
+    lv_timer_t *refr_timer;
+    uint16_t inv_p;          // invalidated areas waiting for a refresh
+    lv_area_t inv_areas[LV_INV_BUF_SIZE];
+    uint8_t inv_area_joined[LV_INV_BUF_SIZE];
+} lv_disp_t;
+
+static void (*lv_sim_refresh)(lv_disp_t *disp) = NULL;   // renders and flushes one frame
+static lv_disp_t lv_sim_disp;
+
+static inline lv_disp_t *lv_disp_get_default() { return &lv_sim_disp; }
+
+static inline void lv_disp_draw_buf_init(lv_disp_draw_buf_t *draw_buf, void *buf1, void *buf2, uint32_t size_in_px)
+{
+    memset(draw_buf, 0, sizeof(*draw_buf));
+    draw_buf->buf1 = buf1;
+    draw_buf->buf2 = buf2;
+    draw_buf->size = size_in_px;
+}
+
+static inline void lv_disp_drv_init(lv_disp_drv_t *drv)
+{
+    memset(drv, 0, sizeof(*drv));
+    drv->hor_res = LV_HOR_RES;
+    drv->ver_res = LV_VER_RES;
+}
+
+static inline void lv_disp_flush_ready(lv_disp_drv_t *drv) { drv->draw_buf->flushing = 0; }
+static inline bool lv_disp_flush_is_last(lv_disp_drv_t *drv) { return drv->draw_buf->flushing_last; }
+
+/*******************************************************************************
+ * Fonts
+ ******************************************************************************/
+typedef struct
+{
+    uint16_t adv_w;
+    uint16_t box_w, box_h;
+    int16_t ofs_x, ofs_y;
+    uint8_t bpp;
+} lv_font_glyph_dsc_t;
+
+typedef struct _lv_font_t
+{
+    bool (*get_glyph_dsc)(const struct _lv_font_t *, lv_font_glyph_dsc_t *, uint32_t letter, uint32_t next);
+    const uint8_t *(*get_glyph_bitmap)(const struct _lv_font_t *, uint32_t letter);
+    lv_coord_t line_height;
+    lv_coord_t base_line;
+    const void *dsc;
+} lv_font_t;
+
+static inline bool lv_font_get_glyph_dsc(const lv_font_t *font, lv_font_glyph_dsc_t *dsc, uint32_t letter, uint32_t next)
+{
+    return font->get_glyph_dsc(font, dsc, letter, next);
+}
+
+static inline const uint8_t *lv_font_get_glyph_bitmap(const lv_font_t *font, uint32_t letter)
+{
+    return font->get_glyph_bitmap(font, letter);
+}
+
+/* Montserrat 14 metrics (16 px lines, digits 9 px wide), placeholder shapes */
+#define LV_SIM_GLYPH_W 8
+#define LV_SIM_GLYPH_H 10
+
+static bool lv_sim_font_dsc(const lv_font_t *, lv_font_glyph_dsc_t *dsc, uint32_t letter, uint32_t)
+{
+    if (letter < 0x20 || letter > 0x7E)
+        return false;
+    memset(dsc, 0, sizeof(*dsc));
+    dsc->bpp = 4;
+    dsc->adv_w = letter == ' ' ? 4 : letter >= '0' && letter <= '9' ? 9 : letter == '.' || letter == ',' ? 4 : 8;
+    if (letter != ' ')
+    {
+        dsc->box_w = letter == '.' || letter == ',' ? 3 : LV_SIM_GLYPH_W - (letter >= '0' && letter <= '9' ? 1 : 0);
+        dsc->box_h = LV_SIM_GLYPH_H;
+        dsc->ofs_x = 1;
+    }
+    return true;
+}
+
+/* 4 bpp, one MSB-first bit stream per glyph like LVGL's bitmaps */
+static const uint8_t *lv_sim_font_bitmap(const lv_font_t *font, uint32_t letter)
+{
+    static uint8_t bitmaps[0x7F - 0x20][LV_SIM_GLYPH_W * LV_SIM_GLYPH_H / 2];
+    static bool built = false;
+    if (!built)
+    {
+        for (uint32_t c = 0x20; c < 0x7F; c++)
+        {
+            lv_font_glyph_dsc_t d;
+            lv_sim_font_dsc(font, &d, c, 0);
+            for (uint32_t p = 0; p < (uint32_t)d.box_w * d.box_h; p++)
+            {
+                uint32_t x = p % d.box_w, y = p / d.box_w;
+                uint8_t v = ((c * 7 + x * 3 + y * 5) % 6) < 3 ? 15 : (x + y) % 4; // strokes with anti-aliased edges
+                bitmaps[c - 0x20][p / 2] |= (uint8_t)(v << (p % 2 ? 0 : 4));
+            }
+        }
+        built = true;
+    }
+    return letter >= 0x20 && letter < 0x7F ? bitmaps[letter - 0x20] : NULL;
+}
+
+static const lv_font_t lv_font_montserrat_14 = {lv_sim_font_dsc, lv_sim_font_bitmap, 16, 3, NULL};
+#define LV_FONT_DEFAULT (&lv_font_montserrat_14)
+
+/*******************************************************************************
+ * Objects and events
+ ******************************************************************************/
+typedef enum
+{
+    LV_EVENT_ALL,
+    LV_EVENT_PRESSED,
+    LV_EVENT_PRESS_LOST,
+    LV_EVENT_RELEASED,
+    LV_EVENT_CLICKED,
+    LV_EVENT_DRAW_MAIN,
+    LV_EVENT_VALUE_CHANGED,
+    LV_EVENT_DELETE,
+} lv_event_code_t;
+
+typedef enum
+{
+    LV_OBJ_FLAG_CLICKABLE = 1 << 1,
+    LV_OBJ_FLAG_SCROLLABLE = 1 << 4,
+} lv_obj_flag_t;
+
+typedef enum
+{
+    LV_ALIGN_DEFAULT,
+    LV_ALIGN_TOP_MID,
+    LV_ALIGN_CENTER,
+    LV_ALIGN_OUT_TOP_MID,
+} lv_align_t;
+
+typedef enum
+{
+    LV_ANIM_OFF,
+    LV_ANIM_ON,
+} lv_anim_enable_t;
+
+typedef uint8_t lv_dir_t;
+#define LV_DIR_TOP (1 << 2)
+#define LV_PART_MAIN 0
+
+typedef struct
+{
+    void *buf;               // the buffer being rendered, lv_color_t
+    const lv_area_t *buf_area;
+    const lv_area_t *clip_area;
+} lv_draw_ctx_t;
+
+typedef struct
+{
+    lv_color_t bg_color;
+} lv_draw_rect_dsc_t;
+
+typedef struct
+{
+    const lv_font_t *font;
+    lv_color_t color;
+    lv_opa_t opa;
+} lv_draw_label_dsc_t;
+
+typedef enum
+{
+    LV_SIM_OBJ,
+    LV_SIM_BTN,
+    LV_SIM_LABEL,
+    LV_SIM_SLIDER,
+    LV_SIM_TABVIEW,
+    LV_SIM_TAB_BAR,
+    LV_SIM_TAB_CONTENT,
+} lv_sim_kind_t;
+
+struct _lv_obj_t;
+typedef struct
+{
+    struct _lv_obj_t *target;
+    lv_event_code_t code;
+    lv_draw_ctx_t *draw_ctx;
+    void *user_data;
+} lv_event_t;
+typedef void (*lv_event_cb_t)(lv_event_t *);
+
+#define LV_SIM_OBJ_CBS 4
+typedef struct _lv_obj_t
+{
+    lv_area_t coords;
+    struct _lv_obj_t *parent;
+    void *user_data;
+    bool used;
+    uint8_t kind;
+    uint8_t flags;           // lv_obj_flag_t
+    bool pressed;
+    int32_t value;           // slider value, active tab
+    char *text;              // label text
+    uint8_t align;           // kept so a label that changes size stays aligned
+    struct _lv_obj_t *align_base;
+    lv_coord_t align_x, align_y;
+    lv_event_cb_t cb[LV_SIM_OBJ_CBS];
+    lv_event_code_t cb_filter[LV_SIM_OBJ_CBS];
+    void *cb_user_data[LV_SIM_OBJ_CBS];
+} lv_obj_t;
+
+static lv_obj_t lv_sim_objs[LV_SIM_OBJS];
+static lv_obj_t *lv_sim_scr = NULL;
+static uint16_t lv_sim_fb[LV_VER_RES][LV_HOR_RES];   // what the panel shows without a driver
+
+static inline lv_obj_t *lv_obj_create(lv_obj_t *parent)
+{
+    for (lv_obj_t &o : lv_sim_objs)
+    {
+        if (o.used)
+            continue;
+        memset(&o, 0, sizeof(o));
+        o.used = true;
+        o.parent = parent;
+        o.flags = LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_SCROLLABLE;
+        o.coords = parent ? parent->coords : lv_area_t{0, 0, LV_HOR_RES - 1, LV_VER_RES - 1};
+        lv_sim_mem_used += sizeof(lv_obj_t);   // objects live in a static pool, counted as LVGL would allocate them
+        lv_sim_mem_cnt++;
+        if (lv_sim_mem_used > lv_sim_mem_max)
+            lv_sim_mem_max = lv_sim_mem_used;
+        return &o;
+    }
+    abort();
+}
+
+static inline lv_obj_t *lv_scr_act()
+{
+    if (!lv_sim_scr)
+        lv_sim_scr = lv_obj_create(NULL);
+    return lv_sim_scr;
+}
+
+static inline lv_obj_t *lv_obj_get_parent(const lv_obj_t *obj) { return obj->parent; }
+
+static inline uint32_t lv_obj_get_index(const lv_obj_t *obj)
+{
+    uint32_t i = 0;
+    for (const lv_obj_t &o : lv_sim_objs)
+    {
+        if (&o == obj)
+            return i;
+        if (o.used && o.parent == obj->parent)
+            i++;
+    }
+    return 0;
+}
+
+/* Extra drawn around the box: the slider knob, the button shadow */
+static inline lv_coord_t lv_sim_ext_draw(const lv_obj_t *obj)
+{
+    return obj->kind == LV_SIM_SLIDER ? LV_SIM_SLIDER_KNOB : obj->kind == LV_SIM_BTN ? LV_SIM_BTN_SHADOW : 0;
+}
+
+static inline void lv_obj_invalidate_area(lv_obj_t *obj, const lv_area_t *a)
+{
+    lv_disp_t *d = &lv_sim_disp;
+    lv_area_t r;
+    lv_area_t screen = {0, 0, LV_HOR_RES - 1, LV_VER_RES - 1};
+    if (!_lv_area_intersect(&r, a, &screen))
+        return;
+    // only what shows through the parents, and only on the active screen
+    const lv_obj_t *p = obj;
+    for (; p && p->parent; p = p->parent)
+        if (!_lv_area_intersect(&r, &r, &p->parent->coords))
+            return;
+    if (p && p != lv_sim_scr)
+        return;
+    for (uint16_t i = 0; i < d->inv_p; i++)
+    {
+        lv_area_t in;
+        if (_lv_area_intersect(&in, &r, &d->inv_areas[i]) && lv_area_get_size(&in) == lv_area_get_size(&r))
+            return; // already covered
+    }
+    if (d->inv_p == LV_INV_BUF_SIZE)
+    {
+        // out of slots: redraw the whole screen, as LVGL does
+        d->inv_p = 0;
+        r = screen;
+    }
+    d->inv_areas[d->inv_p] = r;
+    d->inv_area_joined[d->inv_p++] = 0;
+    if (d->refr_timer)
+        lv_timer_resume(d->refr_timer);
+}
+
+static inline void lv_obj_invalidate(lv_obj_t *obj)
+{
+    lv_coord_t e = lv_sim_ext_draw(obj);
+    lv_area_t a = {(lv_coord_t)(obj->coords.x1 - e), (lv_coord_t)(obj->coords.y1 - e),
+                   (lv_coord_t)(obj->coords.x2 + e), (lv_coord_t)(obj->coords.y2 + e)};
+    lv_obj_invalidate_area(obj, &a);
+}
+
+static inline void lv_scr_load(lv_obj_t *scr)
+{
+    lv_sim_scr = scr;
+    lv_obj_invalidate(scr);
+}
+
+static inline void lv_event_send_cb(lv_obj_t *obj, lv_event_code_t code, lv_draw_ctx_t *draw_ctx)
+{
+    lv_event_t e = {obj, code, draw_ctx, NULL};
+    for (uint8_t i = 0; i < LV_SIM_OBJ_CBS; i++)
+        if (obj->cb[i] && (obj->cb_filter[i] == code || obj->cb_filter[i] == LV_EVENT_ALL))
+        {
+            e.user_data = obj->cb_user_data[i];
+            obj->cb[i](&e);
+        }
+}
+
+static inline void lv_event_send(lv_obj_t *obj, lv_event_code_t code, void *) { lv_event_send_cb(obj, code, NULL); }
+
+static inline void lv_obj_del(lv_obj_t *obj)
+{
+    for (lv_obj_t &o : lv_sim_objs)
+        if (o.used && o.parent == obj)
+            lv_obj_del(&o);
+    lv_event_send_cb(obj, LV_EVENT_DELETE, NULL);
+    lv_mem_free(obj->text);
+    obj->used = false;
+    lv_sim_mem_used -= sizeof(lv_obj_t);
+    lv_sim_mem_cnt--;
+    if (lv_sim_scr == obj)
+        lv_sim_scr = NULL;
+}
+
+static inline void lv_obj_add_event_cb(lv_obj_t *obj, lv_event_cb_t cb, lv_event_code_t filter, void *user_data)
+{
+    for (uint8_t i = 0; i < LV_SIM_OBJ_CBS; i++)
+        if (!obj->cb[i])
+        {
+            obj->cb[i] = cb;
+            obj->cb_filter[i] = filter;
+            obj->cb_user_data[i] = user_data;
+            return;
+        }
+}
+
+static inline void lv_obj_remove_style_all(lv_obj_t *) {}
+static inline void lv_obj_add_flag(lv_obj_t *obj, lv_obj_flag_t f) { obj->flags |= f; }
+static inline void lv_obj_clear_flag(lv_obj_t *obj, lv_obj_flag_t f) { obj->flags &= ~f; }
+static inline void lv_obj_set_user_data(lv_obj_t *obj, void *data) { obj->user_data = data; }
+static inline void *lv_obj_get_user_data(lv_obj_t *obj) { return obj->user_data; }
+static inline lv_obj_t *lv_event_get_target(lv_event_t *e) { return e->target; }
+static inline lv_event_code_t lv_event_get_code(lv_event_t *e) { return e->code; }
+static inline lv_draw_ctx_t *lv_event_get_draw_ctx(lv_event_t *e) { return e->draw_ctx; }
+static inline void *lv_event_get_user_data(lv_event_t *e) { return e->user_data; }
+
+static inline const lv_font_t *lv_obj_get_style_text_font(const lv_obj_t *, uint32_t) { return LV_FONT_DEFAULT; }
+static inline lv_color_t lv_obj_get_style_text_color(const lv_obj_t *, uint32_t) { return lv_color_hex(0x000000); }
+static inline lv_opa_t lv_obj_get_style_text_opa(const lv_obj_t *, uint32_t) { return LV_OPA_COVER; }
+
+/* Moves obj and everything on it */
+static inline void lv_sim_obj_move(lv_obj_t *obj, lv_coord_t dx, lv_coord_t dy)
+{
+    obj->coords.x1 += dx;
+    obj->coords.x2 += dx;
+    obj->coords.y1 += dy;
+    obj->coords.y2 += dy;
+    for (lv_obj_t &o : lv_sim_objs)
+        if (o.used && o.parent == obj)
+            lv_sim_obj_move(&o, dx, dy);
+}
+
+static inline void lv_sim_obj_place(lv_obj_t *obj)
+{
+    if (!obj->align)
+        return;
+    const lv_area_t &b = obj->align_base->coords;
+    lv_coord_t w = lv_area_get_width(&obj->coords), h = lv_area_get_height(&obj->coords);
+    lv_coord_t x = (lv_coord_t)(b.x1 + (lv_area_get_width(&b) - w) / 2 + obj->align_x);
+    lv_coord_t y = obj->align == LV_ALIGN_TOP_MID ? b.y1
+                   : obj->align == LV_ALIGN_CENTER ? (lv_coord_t)(b.y1 + (lv_area_get_height(&b) - h) / 2)
+                                                   : (lv_coord_t)(b.y1 - h);
+    lv_sim_obj_move(obj, x - obj->coords.x1, (lv_coord_t)(y + obj->align_y - obj->coords.y1));
+}
+
+static inline void lv_obj_set_size(lv_obj_t *obj, lv_coord_t w, lv_coord_t h)
+{
+    obj->coords.x2 = obj->coords.x1 + w - 1;
+    obj->coords.y2 = obj->coords.y1 + h - 1;
+    lv_sim_obj_place(obj);
+}
+
+static inline void lv_obj_align_to(lv_obj_t *obj, lv_obj_t *base, lv_align_t align, lv_coord_t x, lv_coord_t y)
+{
+    obj->align = (uint8_t)align;
+    obj->align_base = base;
+    obj->align_x = x;
+    obj->align_y = y;
+    lv_sim_obj_place(obj);
+}
+
+static inline void lv_obj_align(lv_obj_t *obj, lv_align_t align, lv_coord_t x, lv_coord_t y)
+{
+    lv_obj_align_to(obj, obj->parent, align, x, y);
+}
+
+static inline void lv_obj_center(lv_obj_t *obj) { lv_obj_align(obj, LV_ALIGN_CENTER, 0, 0); }
+
+/*******************************************************************************
+ * Drawing
+ ******************************************************************************/
+static inline void lv_draw_rect_dsc_init(lv_draw_rect_dsc_t *dsc) { memset(dsc, 0, sizeof(*dsc)); }
+static inline void lv_draw_label_dsc_init(lv_draw_label_dsc_t *dsc)
+{
+    memset(dsc, 0, sizeof(*dsc));
+    dsc->font = LV_FONT_DEFAULT;
+    dsc->opa = LV_OPA_COVER;
+}
+
+static inline lv_color_t *lv_sim_buf_px(lv_draw_ctx_t *draw_ctx, lv_coord_t x, lv_coord_t y)
+{
+    const lv_area_t *b = draw_ctx->buf_area;
+    return (lv_color_t *)draw_ctx->buf + (y - b->y1) * lv_area_get_width(b) + (x - b->x1);
+}
+
+static inline void lv_draw_rect(lv_draw_ctx_t *draw_ctx, const lv_draw_rect_dsc_t *dsc, const lv_area_t *a)
+{
+    lv_area_t r;
+    if (!_lv_area_intersect(&r, a, draw_ctx->clip_area))
+        return;
+    for (lv_coord_t y = r.y1; y <= r.y2; y++)
+    {
+        lv_color_t *p = lv_sim_buf_px(draw_ctx, r.x1, y);
+        for (lv_coord_t x = r.x1; x <= r.x2; x++)
+            *p++ = dsc->bg_color;
+    }
+}
+
+/* LVGL's generic letter path: unpack the bit stream, map to opacity, blend */
+static inline void lv_draw_letter(lv_draw_ctx_t *draw_ctx, const lv_draw_label_dsc_t *dsc, const lv_point_t *pos,
+                                  uint32_t letter)
+{
+    static const uint8_t opa4[16] = {0, 17, 34, 51, 68, 85, 102, 119, 136, 153, 170, 187, 204, 221, 238, 255};
+    lv_font_glyph_dsc_t g;
+    if (!lv_font_get_glyph_dsc(dsc->font, &g, letter, 0) || !g.box_w || !g.box_h)
+        return;
+    const uint8_t *bitmap = lv_font_get_glyph_bitmap(dsc->font, letter);
+    lv_coord_t x0 = pos->x + g.ofs_x;
+    lv_coord_t y0 = pos->y + (dsc->font->line_height - dsc->font->base_line) - g.box_h - g.ofs_y;
+    lv_area_t a = {x0, y0, (lv_coord_t)(x0 + g.box_w - 1), (lv_coord_t)(y0 + g.box_h - 1)}, clip;
+    if (!bitmap || !_lv_area_intersect(&clip, &a, draw_ctx->clip_area))
+        return;
+    for (lv_coord_t y = clip.y1; y <= clip.y2; y++)
+    {
+        lv_color_t *dst = lv_sim_buf_px(draw_ctx, clip.x1, y);
+        for (lv_coord_t x = clip.x1; x <= clip.x2; x++, dst++)
+        {
+            uint32_t bit = (uint32_t)((y - y0) * g.box_w + (x - x0)) * g.bpp;
+            uint8_t v = (bitmap[bit >> 3] >> (8 - g.bpp - (bit & 7))) & ((1 << g.bpp) - 1);
+            lv_opa_t opa = dsc->opa == LV_OPA_COVER ? opa4[v] : (lv_opa_t)((opa4[v] * dsc->opa) >> 8);
+            if (opa >= LV_OPA_MAX)
+                *dst = dsc->color;
+            else if (opa > LV_OPA_MIN)
+                *dst = lv_color_mix(dsc->color, *dst, opa);
+        }
+    }
+}
+
+static inline void lv_sim_fill(lv_draw_ctx_t *draw_ctx, const lv_area_t *a, uint32_t hex)
+{
+    lv_draw_rect_dsc_t dsc;
+    lv_draw_rect_dsc_init(&dsc);
+    dsc.bg_color = lv_color_hex(hex);
+    lv_draw_rect(draw_ctx, &dsc, a);
+}
+
+/* The theme-less look of each widget kind */
+static inline void lv_sim_draw_widget(lv_obj_t *obj, lv_draw_ctx_t *draw_ctx)
+{
+    const lv_area_t &c = obj->coords;
+    switch (obj->kind)
+    {
+    case LV_SIM_OBJ:
+        if (!obj->parent && lv_sim_disp.driver)
+            lv_sim_fill(draw_ctx, &c, 0xFFFFFF);
+        break;
+    case LV_SIM_BTN:
+    {
+        lv_area_t s = {(lv_coord_t)(c.x1 + 2), (lv_coord_t)(c.y1 + LV_SIM_BTN_SHADOW), (lv_coord_t)(c.x2 + 2),
+                       (lv_coord_t)(c.y2 + LV_SIM_BTN_SHADOW)};
+        lv_sim_fill(draw_ctx, &s, 0xB0B0B0);
+        lv_sim_fill(draw_ctx, &c, obj->pressed ? 0x1565C0 : 0x2196F3);
+        break;
+    }
+    case LV_SIM_LABEL:
+    {
+        lv_draw_label_dsc_t dsc;
+        lv_draw_label_dsc_init(&dsc);
+        lv_point_t pos = {c.x1, c.y1};
+        for (const char *p = obj->text; p && *p; p++)
+        {
+            lv_font_glyph_dsc_t g;
+            lv_draw_letter(draw_ctx, &dsc, &pos, (uint8_t)*p);
+            pos.x += lv_font_get_glyph_dsc(dsc.font, &g, (uint8_t)*p, 0) ? g.adv_w : 0;
+        }
+        break;
+    }
+    case LV_SIM_SLIDER:
+    {
+        lv_coord_t knob = (lv_coord_t)(c.x1 + (int32_t)(lv_area_get_width(&c) - 1) * obj->value / 100);
+        lv_area_t ind = {c.x1, c.y1, knob, c.y2};
+        lv_area_t k = {(lv_coord_t)(knob - LV_SIM_SLIDER_KNOB), (lv_coord_t)(c.y1 - LV_SIM_SLIDER_KNOB),
+                       (lv_coord_t)(knob + LV_SIM_SLIDER_KNOB), (lv_coord_t)(c.y2 + LV_SIM_SLIDER_KNOB)};
+        lv_sim_fill(draw_ctx, &c, 0xDDDDDD);
+        lv_sim_fill(draw_ctx, &ind, 0x2196F3);
+        lv_sim_fill(draw_ctx, &k, 0x1976D2);
+        break;
+    }
+    case LV_SIM_TAB_BAR:
+    {
+        lv_sim_fill(draw_ctx, &c, 0xF0F0F0);
+        lv_obj_t *tv = obj->parent;
+        uint32_t tabs = (uint32_t)obj->value, w = tabs ? lv_area_get_width(&c) / tabs : 0;
+        lv_area_t u = {(lv_coord_t)(c.x1 + tv->value * w), (lv_coord_t)(c.y2 - 3),
+                       (lv_coord_t)(c.x1 + (tv->value + 1) * w - 1), c.y2};
+        if (tabs)
+            lv_sim_fill(draw_ctx, &u, 0x2196F3);
+        break;
+    }
+    case LV_SIM_TAB_CONTENT:
+        lv_sim_fill(draw_ctx, &c, 0xFAFAFA);
+        break;
+    }
+}
+
+/* Draws obj and its children, each clipped to its parent */
+static inline void lv_sim_draw_obj(lv_obj_t *obj, lv_draw_ctx_t *draw_ctx)
+{
+    lv_coord_t e = lv_sim_ext_draw(obj);
+    lv_area_t a = {(lv_coord_t)(obj->coords.x1 - e), (lv_coord_t)(obj->coords.y1 - e),
+                   (lv_coord_t)(obj->coords.x2 + e), (lv_coord_t)(obj->coords.y2 + e)}, r;
+    if (!_lv_area_intersect(&r, &a, draw_ctx->clip_area))
+        return;
+    lv_sim_draw_widget(obj, draw_ctx);
+    lv_event_send_cb(obj, LV_EVENT_DRAW_MAIN, draw_ctx);
+
+    lv_area_t child_clip;
+    if (!_lv_area_intersect(&child_clip, &obj->coords, draw_ctx->clip_area))
+        return;
+    lv_draw_ctx_t child_ctx = *draw_ctx;
+    child_ctx.clip_area = &child_clip;
+    for (lv_obj_t &o : lv_sim_objs)
+        if (o.used && o.parent == obj)
+            lv_sim_draw_obj(&o, &child_ctx);
+}
+
+/* Draws `clip` of the active screen into lv_sim_fb */
+static inline void lv_sim_draw(const lv_area_t *clip)
+{
+    static const lv_area_t fb_area = {0, 0, LV_HOR_RES - 1, LV_VER_RES - 1};
+    lv_draw_ctx_t ctx = {lv_sim_fb, &fb_area, clip};
+    if (lv_sim_scr)
+        lv_sim_draw_obj(lv_sim_scr, &ctx);
+}
+
+/* Merges areas whose bounding box is smaller than the two of them, like lv_refr_join_area() */
+static inline void lv_sim_join_areas(lv_disp_t *disp)
+{
+    for (uint16_t i = 0; i < disp->inv_p; i++)
+    {
+        if (disp->inv_area_joined[i])
+            continue;
+        for (uint16_t j = 0; j < disp->inv_p; j++)
+        {
+            lv_area_t u, in;
+            if (i == j || disp->inv_area_joined[j])
+                continue;
+            _lv_area_join(&u, &disp->inv_areas[i], &disp->inv_areas[j]);
+            uint32_t sum = lv_area_get_size(&disp->inv_areas[i]) + lv_area_get_size(&disp->inv_areas[j]);
+            if (_lv_area_intersect(&in, &disp->inv_areas[i], &disp->inv_areas[j]))
+                sum -= lv_area_get_size(&in);
+            if (lv_area_get_size(&u) < sum)
+            {
+                disp->inv_areas[i] = u;
+                disp->inv_area_joined[j] = 1;
+                j = (uint16_t)-1; // the grown area may now join earlier ones
+            }
+        }
+    }
+}
+
+/* The default refresh: redraws every invalid area */
+static inline void lv_sim_render(lv_disp_t *disp)
+{
+    lv_sim_join_areas(disp);
+    for (uint16_t i = 0; i < disp->inv_p; i++)
+        if (!disp->inv_area_joined[i])
+            lv_sim_draw(&disp->inv_areas[i]);
+}
+
+/* With a driver: every area in row bands through the draw buffer to flush_cb */
+static inline void lv_sim_render_flush(lv_disp_t *disp)
+{
+    lv_disp_drv_t *drv = disp->driver;
+    lv_sim_join_areas(disp);
+    if (drv->render_start_cb)
+        drv->render_start_cb(drv);
+    int32_t last = -1;
+    for (uint16_t i = 0; i < disp->inv_p; i++)
+        if (!disp->inv_area_joined[i])
+            last = i;
+    for (int32_t i = 0; i <= last; i++)
+    {
+        if (disp->inv_area_joined[i])
+            continue;
+        const lv_area_t &a = disp->inv_areas[i];
+        lv_coord_t rows = (lv_coord_t)(drv->draw_buf->size / lv_area_get_width(&a));
+        for (lv_coord_t y = a.y1; y <= a.y2; y += rows)
+        {
+            lv_area_t band = {a.x1, y, a.x2, (lv_coord_t)(y + rows - 1 < a.y2 ? y + rows - 1 : a.y2)};
+            lv_draw_ctx_t ctx = {drv->draw_buf->buf1, &band, &band};
+            if (lv_sim_scr)
+                lv_sim_draw_obj(lv_sim_scr, &ctx);
+            drv->draw_buf->flushing = 1;
+            drv->draw_buf->flushing_last = i == last && band.y2 == a.y2;
+            drv->flush_cb(drv, &band, (lv_color_t *)drv->draw_buf->buf1);
+        }
+    }
+}
+
+/* As in LVGL, the timer pauses itself before refreshing and an invalidation
+   resumes it: an idle screen leaves lv_timer_handler() nothing to run */
+static void _lv_disp_refr_timer(lv_timer_t *t)
+{
+    if (t)
+        lv_timer_pause(t);
+    if (!lv_sim_disp.inv_p)
+        return;
+    if (lv_sim_refresh)
+        lv_sim_refresh(&lv_sim_disp);
+    else if (lv_sim_disp.driver)
+        lv_sim_render_flush(&lv_sim_disp);
+    else
+        lv_sim_render(&lv_sim_disp);
+    lv_sim_disp.inv_p = 0;
+}
+
+static inline void lv_refr_now(lv_disp_t *) { _lv_disp_refr_timer(lv_sim_disp.refr_timer); }
+
+static inline void lv_init() {}
+
+static inline lv_disp_t *lv_disp_drv_register(lv_disp_drv_t *drv)
+{
+    lv_sim_disp.driver = drv;
+    lv_sim_disp.refr_timer = lv_timer_create(_lv_disp_refr_timer, LV_DISP_DEF_REFR_PERIOD, &lv_sim_disp);
+    lv_obj_invalidate(lv_scr_act());
+    return &lv_sim_disp;
+}
+
+/*******************************************************************************
+ * Widgets
+ ******************************************************************************/
+static inline lv_obj_t *lv_btn_create(lv_obj_t *parent)
+{
+    lv_obj_t *obj = lv_obj_create(parent);
+    obj->kind = LV_SIM_BTN;
+    lv_obj_clear_flag(obj, LV_OBJ_FLAG_SCROLLABLE);
+    return obj;
+}
+
+static inline void lv_label_set_text(lv_obj_t *obj, const char *text)
+{
+    lv_obj_invalidate(obj);
+    lv_mem_free(obj->text);
+    size_t len = strlen(text);
+    obj->text = (char *)lv_mem_alloc(len + 1);
+    memcpy(obj->text, text, len + 1);
+    // size to the text (LV_SIZE_CONTENT), then stay aligned
+    lv_coord_t w = 0;
+    for (const char *p = text; *p; p++)
+    {
+        lv_font_glyph_dsc_t g;
+        w += lv_font_get_glyph_dsc(LV_FONT_DEFAULT, &g, (uint8_t)*p, 0) ? g.adv_w : 0;
+    }
+    lv_obj_set_size(obj, w ? w : 1, LV_FONT_DEFAULT->line_height);
+    lv_obj_invalidate(obj);
+}
+
+static inline lv_obj_t *lv_label_create(lv_obj_t *parent)
+{
+    lv_obj_t *obj = lv_obj_create(parent);
+    obj->kind = LV_SIM_LABEL;
+    lv_obj_clear_flag(obj, (lv_obj_flag_t)(LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_SCROLLABLE));
+    lv_label_set_text(obj, "Text");
+    return obj;
+}
+
+static inline lv_obj_t *lv_slider_create(lv_obj_t *parent)
+{
+    lv_obj_t *obj = lv_obj_create(parent);
+    obj->kind = LV_SIM_SLIDER;
+    lv_obj_clear_flag(obj, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_set_size(obj, 150, 10);
+    return obj;
+}
+
+static inline void lv_slider_set_value(lv_obj_t *obj, int32_t value, lv_anim_enable_t)
+{
+    value = value < 0 ? 0 : value > 100 ? 100 : value;
+    if (value == obj->value)
+        return;
+    obj->value = value;
+    lv_obj_invalidate(obj);
+}
+
+static inline int32_t lv_slider_get_value(const lv_obj_t *obj) { return obj->value; }
+
+/* tabview: the tab bar, then the content whose children are the tabs side by side */
+static inline lv_obj_t *lv_tabview_create(lv_obj_t *parent, lv_dir_t, lv_coord_t bar_h)
+{
+    lv_obj_t *tv = lv_obj_create(parent);
+    tv->kind = LV_SIM_TABVIEW;
+    lv_obj_clear_flag(tv, (lv_obj_flag_t)(LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_SCROLLABLE));
+    lv_obj_t *bar = lv_obj_create(tv);
+    bar->kind = LV_SIM_TAB_BAR;
+    lv_obj_clear_flag(bar, LV_OBJ_FLAG_SCROLLABLE);
+    bar->coords.y2 = bar->coords.y1 + bar_h - 1;
+    lv_obj_t *content = lv_obj_create(tv);
+    content->kind = LV_SIM_TAB_CONTENT;
+    content->coords.y1 = bar->coords.y2 + 1;
+    return tv;
+}
+
+static inline lv_obj_t *lv_sim_tabview_part(lv_obj_t *tv, uint8_t kind)
+{
+    for (lv_obj_t &o : lv_sim_objs)
+        if (o.used && o.parent == tv && o.kind == kind)
+            return &o;
+    return NULL;
+}
+
+static inline lv_obj_t *lv_tabview_add_tab(lv_obj_t *tv, const char *name)
+{
+    lv_obj_t *bar = lv_sim_tabview_part(tv, LV_SIM_TAB_BAR);
+    lv_obj_t *content = lv_sim_tabview_part(tv, LV_SIM_TAB_CONTENT);
+    lv_obj_t *tab = lv_obj_create(content);
+    lv_coord_t w = lv_area_get_width(&content->coords);
+    lv_sim_obj_move(tab, (lv_coord_t)((bar->value - content->value) * w), 0);
+    lv_obj_clear_flag(tab, LV_OBJ_FLAG_CLICKABLE);
+
+    // the bar shows the names in equal cells
+    lv_obj_t *label = lv_label_create(bar);
+    lv_label_set_text(label, name);
+    bar->value++;
+    uint32_t cell = lv_area_get_width(&bar->coords) / bar->value, i = 0;
+    for (lv_obj_t &o : lv_sim_objs)
+    {
+        if (!o.used || o.parent != bar)
+            continue;
+        lv_area_t c = {(lv_coord_t)(bar->coords.x1 + i * cell), bar->coords.y1,
+                       (lv_coord_t)(bar->coords.x1 + (i + 1) * cell - 1), bar->coords.y2};
+        o.align_base = NULL;
+        lv_sim_obj_move(&o, (lv_coord_t)(c.x1 + (lv_area_get_width(&c) - lv_area_get_width(&o.coords)) / 2 - o.coords.x1),
+                        (lv_coord_t)(c.y1 + (lv_area_get_height(&c) - lv_area_get_height(&o.coords)) / 2 - o.coords.y1));
+        o.align = 0;
+        i++;
+    }
+    lv_obj_invalidate(bar);
+    return tab;
+}
+
+static inline uint16_t lv_tabview_get_tab_act(lv_obj_t *tv) { return (uint16_t)tv->value; }
+
+/* Content scroll position (content->value) in px; tabs move with it */
+static inline void lv_sim_scroll_to(lv_obj_t *content, int32_t x)
+{
+    if (x == content->value)
+        return;
+    for (lv_obj_t &o : lv_sim_objs)
+        if (o.used && o.parent == content)
+            lv_sim_obj_move(&o, (lv_coord_t)(content->value - x), 0);
+    content->value = x;
+    lv_obj_invalidate(content);
+}
+
+static struct
+{
+    lv_obj_t *content;
+    int32_t from, to;
+    uint32_t start;
+    lv_timer_t *timer;
+} lv_sim_scroll_anim;
+
+static void lv_sim_scroll_anim_cb(lv_timer_t *t)
+{
+    lv_obj_t *content = lv_sim_scroll_anim.content;
+    uint32_t elapsed = lv_tick_get() - lv_sim_scroll_anim.start;
+    if (elapsed >= LV_SIM_SCROLL_ANIM_MS)
+    {
+        lv_sim_scroll_to(content, lv_sim_scroll_anim.to);
+        lv_obj_t *tv = content->parent;
+        lv_coord_t w = lv_area_get_width(&content->coords);
+        int32_t tab = (lv_sim_scroll_anim.to + w / 2) / w;
+        lv_timer_del(t);
+        lv_sim_scroll_anim.timer = NULL;
+        if (tab != tv->value)
+        {
+            tv->value = tab;
+            lv_obj_invalidate(lv_sim_tabview_part(tv, LV_SIM_TAB_BAR));
+            lv_event_send_cb(tv, LV_EVENT_VALUE_CHANGED, NULL);
+        }
+        return;
+    }
+    // ease out, like lv_anim_path_ease_out
+    int32_t p = (int32_t)(1024 * elapsed / LV_SIM_SCROLL_ANIM_MS);
+    int32_t eased = 1024 - (1024 - p) * (1024 - p) / 1024;
+    lv_sim_scroll_to(content, lv_sim_scroll_anim.from + (lv_sim_scroll_anim.to - lv_sim_scroll_anim.from) * eased / 1024);
+}
+
+static inline void lv_sim_scroll_snap(lv_obj_t *content, int32_t to)
+{
+    if (lv_sim_scroll_anim.timer)
+        lv_timer_del(lv_sim_scroll_anim.timer);
+    lv_sim_scroll_anim.content = content;
+    lv_sim_scroll_anim.from = content->value;
+    lv_sim_scroll_anim.to = to;
+    lv_sim_scroll_anim.start = lv_tick_get();
+    lv_sim_scroll_anim.timer = lv_timer_create(lv_sim_scroll_anim_cb, LV_DISP_DEF_REFR_PERIOD, NULL);
+}
+
+/*******************************************************************************
+ * Pointer input
+ ******************************************************************************/
+typedef enum
+{
+    LV_INDEV_TYPE_NONE,
+    LV_INDEV_TYPE_POINTER,
+} lv_indev_type_t;
+
+typedef enum
+{
+    LV_INDEV_STATE_REL = 0,
+    LV_INDEV_STATE_PR,
+} lv_indev_state_t;
+
+typedef struct
+{
+    lv_point_t point;
+    lv_indev_state_t state;
+} lv_indev_data_t;
+
+typedef struct _lv_indev_drv_t
+{
+    lv_indev_type_t type;
+    void (*read_cb)(struct _lv_indev_drv_t *drv, lv_indev_data_t *data);
+    void *user_data;
+} lv_indev_drv_t;
+
+typedef struct
+{
+    lv_timer_t *read_timer;
+    lv_indev_drv_t *driver;
+    lv_obj_t *act_obj;        // pressed object
+    lv_obj_t *scroll_obj;     // tab content being dragged
+    lv_point_t press_point, last_point;
+    int32_t scroll_start;
+    bool pressed;
+} lv_indev_t;
+
+static inline lv_timer_t *lv_indev_get_read_timer(lv_indev_t *indev) { return indev->read_timer; }
+
+static inline void lv_indev_drv_init(lv_indev_drv_t *drv) { memset(drv, 0, sizeof(*drv)); }
+
+/* Topmost clickable object under p; children are on top of their parent */
+static inline lv_obj_t *lv_sim_hit(lv_obj_t *obj, const lv_point_t *p)
+{
+    if (!_lv_area_is_point_on(&obj->coords, p))
+        return NULL;
+    lv_obj_t *hit = NULL;
+    for (lv_obj_t &o : lv_sim_objs)
+        if (o.used && o.parent == obj)
+        {
+            lv_obj_t *h = lv_sim_hit(&o, p);
+            if (h)
+                hit = h;
+        }
+    return hit ? hit : (obj->flags & LV_OBJ_FLAG_CLICKABLE) ? obj : NULL;
+}
+
+static inline void lv_sim_slider_drag(lv_obj_t *slider, lv_coord_t x)
+{
+    int32_t w = lv_area_get_width(&slider->coords);
+    int32_t v = ((int32_t)(x - slider->coords.x1) * 100 + w / 2) / w;
+    int32_t old = slider->value;
+    lv_slider_set_value(slider, v, LV_ANIM_OFF);
+    if (slider->value != old)
+        lv_event_send_cb(slider, LV_EVENT_VALUE_CHANGED, NULL);
+}
+
+static inline void lv_sim_set_pressed(lv_obj_t *obj, bool pressed)
+{
+    if (obj->kind == LV_SIM_BTN && obj->pressed != pressed)
+        lv_obj_invalidate(obj);
+    obj->pressed = pressed;
+}
+
+/* Press, drag, release on a pointer sample, like indev_pointer_proc() */
+static inline void lv_sim_indev_proc(lv_indev_t *indev, const lv_indev_data_t *data)
+{
+    const lv_point_t &p = data->point;
+    if (data->state == LV_INDEV_STATE_PR && !indev->pressed)
+    {
+        indev->pressed = true;
+        indev->press_point = p;
+        indev->scroll_obj = NULL;
+        indev->act_obj = lv_sim_scr ? lv_sim_hit(lv_sim_scr, &p) : NULL;
+        if (indev->act_obj)
+        {
+            lv_sim_set_pressed(indev->act_obj, true);
+            lv_event_send_cb(indev->act_obj, LV_EVENT_PRESSED, NULL);
+            if (indev->act_obj->kind == LV_SIM_SLIDER)
+                lv_sim_slider_drag(indev->act_obj, p.x);
+        }
+    }
+    else if (data->state == LV_INDEV_STATE_PR)
+    {
+        lv_obj_t *act = indev->act_obj;
+        if (act && act->kind == LV_SIM_SLIDER)
+        {
+            lv_sim_slider_drag(act, p.x);
+        }
+        else if (!indev->scroll_obj && act && abs(p.x - indev->press_point.x) > LV_INDEV_DEF_SCROLL_LIMIT)
+        {
+            // the drag becomes a scroll of the tab content the object is on
+            lv_obj_t *s = act;
+            while (s && s->kind != LV_SIM_TAB_CONTENT)
+                s = s->parent;
+            if (s)
+            {
+                lv_sim_set_pressed(act, false);
+                lv_event_send_cb(act, LV_EVENT_PRESS_LOST, NULL);
+                if (lv_sim_scroll_anim.timer)
+                {
+                    lv_timer_del(lv_sim_scroll_anim.timer);
+                    lv_sim_scroll_anim.timer = NULL;
+                }
+                indev->scroll_obj = s;
+                indev->scroll_start = s->value;
+                indev->act_obj = NULL;
+            }
+        }
+        if (indev->scroll_obj)
+        {
+            lv_obj_t *s = indev->scroll_obj;
+            int32_t max = 0;
+            for (lv_obj_t &o : lv_sim_objs)
+                if (o.used && o.parent == s)
+                    max += lv_area_get_width(&s->coords);
+            max -= lv_area_get_width(&s->coords);
+            int32_t x = indev->scroll_start - (p.x - indev->press_point.x);
+            lv_sim_scroll_to(s, x < 0 ? 0 : x > max ? max : x);
+        }
+    }
+    else if (data->state == LV_INDEV_STATE_REL && indev->pressed)
+    {
+        indev->pressed = false;
+        if (indev->scroll_obj)
+        {
+            // snap to the neighbouring tab in the direction of the swipe
+            lv_obj_t *s = indev->scroll_obj;
+            lv_coord_t w = lv_area_get_width(&s->coords);
+            int32_t dir = indev->press_point.x > p.x ? 1 : -1;
+            int32_t tab = (indev->scroll_start + w / 2) / w + dir, tabs = 0;
+            for (lv_obj_t &o : lv_sim_objs)
+                tabs += o.used && o.parent == s;
+            tab = tab < 0 ? 0 : tab >= tabs ? tabs - 1 : tab;
+            lv_sim_scroll_snap(s, tab * w);
+            indev->scroll_obj = NULL;
+        }
+        else if (indev->act_obj)
+        {
+            lv_obj_t *act = indev->act_obj;
+            lv_sim_set_pressed(act, false);
+            lv_event_send_cb(act, LV_EVENT_RELEASED, NULL);
+            if (act->kind != LV_SIM_SLIDER)
+                lv_event_send_cb(act, LV_EVENT_CLICKED, NULL);
+        }
+        indev->act_obj = NULL;
+    }
+    indev->last_point = p;
+}
+
+static void lv_sim_indev_read_timer(lv_timer_t *t)
+{
+    lv_indev_t *indev = (lv_indev_t *)t->user_data;
+    lv_indev_data_t data;
+    memset(&data, 0, sizeof(data));
+    data.point = indev->last_point; // a release reports where the finger was
+    indev->driver->read_cb(indev->driver, &data);
+    lv_sim_indev_proc(indev, &data);
+}
+
+static inline lv_indev_t *lv_indev_drv_register(lv_indev_drv_t *drv)
+{
+    static lv_indev_t indev;
+    memset(&indev, 0, sizeof(indev));
+    indev.driver = drv;
+    indev.read_timer = lv_timer_create(lv_sim_indev_read_timer, LV_INDEV_DEF_READ_PERIOD, &indev);
+    return &indev;
+}
+
+#endif // _HOST_LVGL_H
@@ -0,0 +1,55 @@
+/*******************************************************************************
+ * Host runner for the glyph-cached label benchmark (see ../num_label.h)
+ *
+ * Build:  g++ -O2 -I. -I.. num_label_bench.cpp -o num_label_bench
+ *
+ *   num_label_bench
+ *
+ * A 320x240 display on host/lvgl.h with the sketch's half-screen draw buffer;
+ * the flush copies into a frame buffer as the SPI bus would. Prints the BENCH
+ * lines of num_label_bench() and exits non-zero if the cached label is not
+ * faster than the stock one.
+ *
+ * host/lvgl.h renders lv_label through lv_draw_letter with a placeholder 4bpp
+ * font of Montserrat 14's metrics, so the invalidated pixels match the device
+ * and the times only rank the two labels. A run on the 1-CPU build box:
+ *   BENCH,label_stock,200,2,5,280,0
+ *   BENCH,label_cached,200,1,5,80,0
+ *   BENCH,label_cached,448 cached draws,0 fallback draws,PASS
+ * The same program links against the simulator's LVGL 8.3 build (16-bit
+ * colour, Montserrat 14) with that include path first and this folder off it.
+ ******************************************************************************/
+#include <stdint.h>
+#include <string.h>
+#include <lvgl.h>
+#include "../num_label.h"
+
+#define SCREEN_W 320
+#define SCREEN_H 240
+
+static lv_color_t frame_buffer[SCREEN_W * SCREEN_H];
+static lv_color_t draw_pixels[SCREEN_W * SCREEN_H / 2];
+
+static void host_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p)
+{
+    int32_t w = area->x2 - area->x1 + 1;
+    for (int32_t y = area->y1; y <= area->y2; y++, color_p += w)
+        memcpy(&frame_buffer[y * SCREEN_W + area->x1], color_p, w * sizeof(lv_color_t));
+    lv_disp_flush_ready(disp);
+}
+
+int main()
+{
+    static lv_disp_draw_buf_t draw_buf;
+    static lv_disp_drv_t disp_drv;
+    lv_init();
+    lv_disp_draw_buf_init(&draw_buf, draw_pixels, NULL, SCREEN_W * SCREEN_H / 2);
+    lv_disp_drv_init(&disp_drv);
+    disp_drv.hor_res = SCREEN_W;
+    disp_drv.ver_res = SCREEN_H;
+    disp_drv.flush_cb = host_flush;
+    disp_drv.draw_buf = &draw_buf;
+    lv_disp_drv_register(&disp_drv);
+
+    return num_label_bench() ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+/*******************************************************************************
+ * Host test for the OLED driver (see ../oled.h)
+ *
+ * Build:  g++ -O2 -I.. oled_test.cpp -o oled_test
+ *
+ *   oled_test
+ *
+ * Runs the driver against the mock bus, which decodes the addressing commands
+ * into a simulated panel RAM. After every update the panel RAM must equal the
+ * frame buffer, and the bytes on the wire must match what the dirty spans
+ * cost: 8 for the column/page window command, then 2 per data write plus the
+ * data itself. Prints the bytes per update for each case and exits non-zero
+ * if any check fails.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "oled.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                     \
+    do                                       \
+    {                                        \
+        if (!(cond))                         \
+        {                                    \
+            printf("FAIL %s: ", #cond);      \
+            printf(__VA_ARGS__);             \
+            printf("\n");                    \
+            failures++;                      \
+        }                                    \
+    } while (0)
+
+/* Updates and checks the panel RAM; returns the wire bytes */
+static uint32_t update(const char *what)
+{
+    uint32_t bytes = oled_update();
+    CHECK(!memcmp(oled_sim_gddram, oled_buffer, sizeof(oled_buffer)), "%s: panel RAM differs from the frame", what);
+    oled_stats_t s = oled_get_stats();
+    printf("%-28s %5u bytes in %u writes\n", what, (unsigned)bytes, bytes ? (unsigned)s.last_writes : 0);
+    return bytes;
+}
+
+/* Columns that differ between two renderings of a text at x */
+static int changed_span(int16_t x, const char *a, const char *b)
+{
+    static uint8_t frame_a[SCREEN_WIDTH];
+    oled_draw_text(x, 0, a);
+    memcpy(frame_a, oled_buffer[0], SCREEN_WIDTH);
+    oled_draw_text(x, 0, b);
+    int x0 = SCREEN_WIDTH, x1 = -1;
+    for (int i = 0; i < SCREEN_WIDTH; i++)
+    {
+        if (frame_a[i] != oled_buffer[0][i])
+        {
+            x0 = i < x0 ? i : x0;
+            x1 = i;
+        }
+    }
+    oled_draw_text(x, 0, a);
+    oled_update();
+    return x1 < x0 ? 0 : x1 - x0 + 1;
+}
+
+int main()
+{
+    memset(oled_sim_gddram, 0xA5, sizeof(oled_sim_gddram)); // undefined at power up
+    oled_init();
+    CHECK(!memcmp(oled_sim_gddram, oled_buffer, sizeof(oled_buffer)), "init: panel RAM not cleared");
+    CHECK(oled_get_stats().last_bytes == OLED_FULL_FRAME_BYTES, "init: %u bytes, full frame is %u",
+          (unsigned)oled_get_stats().last_bytes, (unsigned)OLED_FULL_FRAME_BYTES);
+    printf("%-28s %5u bytes\n", "init (full frame)", (unsigned)oled_get_stats().last_bytes);
+
+    CHECK(update("no change") == 0, "an unchanged frame was sent");
+
+    oled_draw_text(0, 0, "41");
+    update("two digits");
+    CHECK(update("same text again") == 0, "redrawing the same text was sent");
+
+    // one digit: a single window, one data write of the changed columns
+    int span = changed_span(6, "1", "2");
+    oled_draw_text(0, 0, "42");
+    uint32_t bytes = update("one digit 41 -> 42");
+    CHECK(bytes == 8u + 2 + span, "one digit: %u bytes, %d changed columns", (unsigned)bytes, span);
+    CHECK(bytes == 15, "one digit: %u bytes, expected 15", (unsigned)bytes);
+
+    // one digit on each of two pages far apart: two windows, not a merged block
+    oled_draw_text(0, 0, "43");
+    oled_draw_text(0, 6, "7");
+    bytes = update("digits on pages 0 and 6");
+    CHECK(bytes <= 2 * (8 + 2 + 6), "two pages: %u bytes", (unsigned)bytes);
+
+    // a block over neighbouring pages merges into one window
+    oled_fill_rect(100, 8, 10, 24, true);
+    bytes = update("10x24 block over 3 pages");
+    CHECK(oled_get_stats().last_writes == 2, "block: %u writes", (unsigned)oled_get_stats().last_writes);
+    CHECK(bytes == 8u + 2 + 3 * 10, "block: %u bytes", (unsigned)bytes);
+
+    // writes are chunked to the Wire buffer
+    oled_clear();
+    oled_fill_rect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, true);
+    bytes = update("whole screen");
+    CHECK(bytes == OLED_FULL_FRAME_BYTES, "whole screen: %u bytes", (unsigned)bytes);
+
+    oled_print_stats();
+    printf("%s: %d failed checks\n", failures ? "FAIL" : "PASS", failures);
+    return failures ? 1 : 0;
+}
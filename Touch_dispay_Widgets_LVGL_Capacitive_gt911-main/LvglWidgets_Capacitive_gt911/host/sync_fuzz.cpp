@@ -0,0 +1,285 @@
+/*******************************************************************************
+ * Fuzz test and benchmark for the state sync protocol (see ../sync.h)
+ *
+ * Build:  g++ -O2 -fsanitize=address,undefined -I.. sync_fuzz.cpp -o sync_fuzz
+ *
+ *   sync_fuzz [iterations] [seed]
+ *
+ * The sender runs against a random UI (slider drags, tab switches, button
+ * presses) with the sketch's log lines interleaved on the same stream, and
+ * the wire is damaged on the way to the reference peer:
+ *   truncated  a frame is cut short (its EOF and tail are lost)
+ *   garbled    one byte of a frame is replaced
+ *   gapped     a whole frame is lost
+ * Whenever the peer reports itself synced, its mirror must equal the state
+ * the sender had put on the wire. A damaged frame that slips past the CRC is
+ * counted as undetected, and the check waits for the next intact snapshot.
+ *
+ * The benchmark compares wire bytes and encode/decode time per UI change
+ * with the text lines the sketch printed before (LOG_PRINTF).
+ * Exits non-zero on a mirror mismatch or a failed directed test.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "sync.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                     \
+    do                                       \
+    {                                        \
+        if (!(cond))                         \
+        {                                    \
+            printf("FAIL %s: ", #cond);      \
+            printf(__VA_ARGS__);             \
+            printf("\n");                    \
+            failures++;                      \
+        }                                    \
+    } while (0)
+
+/* Every frame the sender wrote, with the state it put on the wire */
+struct sent_frame_t
+{
+    std::vector<uint8_t> wire;
+    int32_t state[SYNC_FIELDS];
+};
+static std::vector<sent_frame_t> sent;
+
+static size_t capture(const uint8_t *buf, size_t len)
+{
+    sent_frame_t f;
+    f.wire.assign(buf, buf + len);
+    memcpy(f.state, sync_sent, sizeof(f.state));
+    sent.push_back(f);
+    return len;
+}
+
+static void sender_reset()
+{
+    memset(sync_values, 0, sizeof(sync_values));
+    memset(sync_sent, 0, sizeof(sync_sent));
+    memset(&sync_stats, 0, sizeof(sync_stats));
+    sync_seq = 0;
+    sync_last_send_ms = sync_last_snapshot_ms = 0;
+    sync_begin(capture);
+    sent.clear();
+}
+
+static uint32_t events_seen;
+static void on_event(uint32_t) { events_seen++; }
+
+static bool feed(sync_peer_t *peer, const uint8_t *p, size_t n)
+{
+    bool applied = false;
+    for (size_t i = 0; i < n; i++)
+        applied |= sync_peer_feed(peer, p[i]);
+    return applied;
+}
+
+static const char *log_lines[] = {
+    "BOOT,1234,1,lv_init\n", "GOV,idle,50,96\n", "LAT,flush,120,8000,15000,16000\n",
+    "TE,60,0,0,16949\n", "BENCH,tab_swipe,120,14000,22000,3840000,21000,180000,PASS\n"};
+
+/* A lost delta followed by an event and a delta must leave the peer unsynced
+   until the next snapshot */
+static void test_gap_then_event()
+{
+    sender_reset();
+    sync_peer_t peer;
+    sync_peer_init(&peer, on_event);
+    sync_poll(0); // snapshot, seq 0
+    sync_set(SYNC_FIELD_SLIDER(0, 0), 10);
+    sync_poll(100); // delta, seq 1: lost
+    sync_event(SYNC_EVENT_BUTTON(0, 0)); // seq 2
+    sync_set(SYNC_FIELD_SLIDER(0, 1), 20);
+    sync_poll(200); // delta, seq 3
+    feed(&peer, sent[0].wire.data(), sent[0].wire.size());
+    for (size_t i = 2; i < sent.size(); i++)
+        feed(&peer, sent[i].wire.data(), sent[i].wire.size());
+    CHECK(!peer.synced && peer.lost == 1, "gap before an event: synced %d lost %u", peer.synced, (unsigned)peer.lost);
+
+    sync_poll(SYNC_SNAPSHOT_MS + 10);
+    feed(&peer, sent.back().wire.data(), sent.back().wire.size());
+    CHECK(peer.synced && !memcmp(peer.values, sync_values, sizeof(peer.values)), "snapshot did not resync");
+}
+
+/* Frames and log lines share the port */
+static void test_text_interleaved()
+{
+    sender_reset();
+    sync_peer_t peer;
+    sync_peer_init(&peer, on_event);
+    std::vector<uint8_t> stream;
+    for (int i = 0; i < 100; i++)
+    {
+        sync_set(SYNC_FIELD_SLIDER(i & 1, 0), i * 37 - 500);
+        sync_poll(i * 50);
+        const char *line = log_lines[i % 5];
+        stream.insert(stream.end(), line, line + strlen(line));
+    }
+    for (auto &f : sent)
+        stream.insert(stream.end(), f.wire.begin(), f.wire.end());
+    feed(&peer, stream.data(), stream.size());
+    CHECK(peer.frames == sent.size() && !peer.errors && peer.synced, "text lines: %u of %u frames, %u errors",
+          (unsigned)peer.frames, (unsigned)sent.size(), (unsigned)peer.errors);
+    CHECK(!memcmp(peer.values, sync_values, sizeof(peer.values)), "text lines: mirror differs");
+}
+
+static void fuzz(uint32_t iterations)
+{
+    sender_reset();
+    sync_peer_t peer;
+    sync_peer_init(&peer, on_event);
+    uint32_t now = 0, truncated = 0, garbled = 0, gapped = 0, undetected = 0, checked = 0;
+    bool trusted = true;
+
+    for (uint32_t it = 0; it < iterations; it++)
+    {
+        now += 1 + rand() % 40;
+        size_t first = sent.size();
+        switch (rand() % 8)
+        {
+        case 0:
+            sync_event(rand() % 4);
+            break;
+        case 1:
+            sync_set(SYNC_FIELD_TAB, rand() % SYNC_TABS);
+            break;
+        default:
+            sync_set(1 + rand() % (SYNC_FIELDS - 1), rand() % 2 ? rand() % 101 : rand() - RAND_MAX / 2);
+            break;
+        }
+        sync_poll(now);
+
+        for (size_t i = first; i < sent.size(); i++)
+        {
+            if (rand() % 3 == 0)
+            {
+                const char *line = log_lines[rand() % 5];
+                feed(&peer, (const uint8_t *)line, strlen(line));
+            }
+            std::vector<uint8_t> w = sent[i].wire;
+            bool damaged = true;
+            switch (rand() % 64)
+            {
+            case 0:
+                w.resize(rand() % w.size());
+                truncated++;
+                break;
+            case 1:
+                w[rand() % w.size()] = (uint8_t)rand();
+                garbled++;
+                break;
+            case 2:
+                w.clear();
+                gapped++;
+                break;
+            default:
+                damaged = false;
+                break;
+            }
+            bool applied = feed(&peer, w.data(), w.size());
+            if (damaged && applied && w != sent[i].wire)
+            {
+                undetected++;
+                trusted = false;
+            }
+            if (!damaged && applied && w[3] == SYNC_MSG_SNAPSHOT)
+                trusted = true;
+            if (trusted && applied && peer.synced)
+            {
+                CHECK(!memcmp(peer.values, sent[i].state, sizeof(peer.values)), "mirror differs after frame %u",
+                      (unsigned)i);
+                checked++;
+            }
+        }
+    }
+    printf("fuzz: %u frames, %u truncated, %u garbled, %u gapped, %u undetected, %u mirror checks, "
+           "peer: %u frames %u lost %u errors\n",
+           (unsigned)sent.size(), (unsigned)truncated, (unsigned)garbled, (unsigned)gapped, (unsigned)undetected,
+           (unsigned)checked, (unsigned)peer.frames, (unsigned)peer.lost, (unsigned)peer.errors);
+    CHECK(checked > iterations / 20, "too few mirror checks: %u", (unsigned)checked);
+}
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Bytes and ns per UI change: binary frames vs the old text lines */
+static void bench()
+{
+    const int n = 200000;
+    char line[64];
+    size_t text_bytes = 0;
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < n; i++)
+    {
+        int len = (i & 7) ? snprintf(line, sizeof(line), "Slider changed to %d in tab %d\n", i % 101, 1 + (i & 1))
+                          : snprintf(line, sizeof(line), "Button %d pressed in tab %d\n", 1 + (i & 1), 1 + (i >> 1 & 1));
+        text_bytes += len;
+    }
+    uint64_t text_ns = now_ns() - t0;
+
+    sender_reset();
+    sent.reserve(n + n / 8);
+    uint32_t now = 0;
+    t0 = now_ns();
+    for (int i = 0; i < n; i++)
+    {
+        now += SYNC_MIN_INTERVAL_MS;
+        if (i & 7)
+        {
+            sync_set(SYNC_FIELD_SLIDER(i & 1, 0), i % 101);
+            sync_poll(now);
+        }
+        else
+        {
+            sync_event(SYNC_EVENT_BUTTON(i & 1, 0));
+        }
+    }
+    uint64_t enc_ns = now_ns() - t0;
+
+    sync_peer_t peer;
+    sync_peer_init(&peer, on_event);
+    t0 = now_ns();
+    for (auto &f : sent)
+        feed(&peer, f.wire.data(), f.wire.size());
+    uint64_t dec_ns = now_ns() - t0;
+
+    size_t delta_bytes = 0, deltas = 0;
+    for (auto &f : sent)
+    {
+        if (f.wire[3] == SYNC_MSG_DELTA)
+        {
+            delta_bytes += f.wire.size();
+            deltas++;
+        }
+    }
+    printf("BENCH,sync,text,%u changes,%.1f bytes/change,%.0f ns/change\n", n, (double)text_bytes / n,
+           (double)text_ns / n);
+    printf("BENCH,sync,binary,%u changes,%.1f bytes/change (%.1f per delta frame, snapshot every %u ms),"
+           "%.0f ns encode,%.0f ns decode\n",
+           n, (double)sync_stats.bytes / n, deltas ? (double)delta_bytes / deltas : 0.0, SYNC_SNAPSHOT_MS,
+           (double)enc_ns / n, (double)dec_ns / n);
+    CHECK(peer.frames == sent.size() && !memcmp(peer.values, sync_values, sizeof(peer.values)), "bench: decode");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iterations = argc > 1 ? atoi(argv[1]) : 200000;
+    srand(argc > 2 ? atoi(argv[2]) : 1);
+
+    test_gap_then_event();
+    test_text_interleaved();
+    fuzz(iterations);
+    bench();
+
+    printf("%s: %d failed checks\n", failures ? "FAIL" : "PASS", failures);
+    return failures ? 1 : 0;
+}
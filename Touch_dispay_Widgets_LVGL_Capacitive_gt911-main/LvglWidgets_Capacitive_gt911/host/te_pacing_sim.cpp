@@ -0,0 +1,173 @@
+/*******************************************************************************
+ * Tear-free pacing against a simulated panel (see ../te_pacing.h)
+ *
+ * Build:  g++ -O2 -I. -I.. te_pacing_sim.cpp -o te_pacing_sim
+ *
+ *   te_pacing_sim [seed]
+ *
+ * Runs loop() as the sketch does (lv_timer_handler(), te_pacing_poll(), then
+ * a wait of the returned ms) on the virtual clock of te_pacing.h's simulated
+ * TE generator (59 Hz with jitter), with the LVGL timers of host/lvgl.h. The
+ * screen changes continuously; a refresh renders and flushes it in two
+ * halves as the half-screen draw buffer does, each flush going through
+ * te_pacing_flush_gate() / te_pacing_flush_done() at SPI_NS_PER_PX.
+ * Phases, one line each:
+ *   BENCH,te_pacing,<phase>,<frames>,<missed>,<torn>,<fallbacks>
+ *   portrait     random render times, 1 in 20 frames spikes before the first
+ *                flush: misses allowed, no tears. Two 7.7 ms flushes and
+ *                their renders do not fit one period, so a frame takes two
+ *                pulses
+ *   late_half    the second half renders for longer than a period: every
+ *                frame must be reported torn
+ *   te_lost      TE stops: one fallback, the refresh timer renders again at
+ *                the period the governor set
+ *   te_back      TE returns: the probe switches TE mode back on
+ *   slow_period  the governor's 50 ms period applies in TE mode too
+ *   idle         nothing changes: no frames, and the refresh timer pauses
+ *                until the screen is invalidated again
+ *   landscape    full-width bands cross every scan line: all torn
+ * Exits non-zero if a check fails.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "lvgl.h"
+#include "te_pacing.h"
+
+#define HOR_RES 320
+#define VER_RES 240
+#define SPI_NS_PER_PX 200          // 80 MHz SPI, 16 bit pixels
+#define LOOP_WORK_US 300
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                     \
+    do                                       \
+    {                                        \
+        if (!(cond))                         \
+        {                                    \
+            printf("FAIL %s: ", #cond);      \
+            printf(__VA_ARGS__);             \
+            printf("\n");                    \
+            failures++;                      \
+        }                                    \
+    } while (0)
+
+static bool late_second_half = false;
+static bool screen_changes = true;
+static uint32_t refreshes = 0;
+
+static uint32_t sim_tick_ms() { return te_now_us() / 1000; }
+
+/* Render and flush one frame in two halves, as LVGL does with the half-screen buffer */
+static void refresh(lv_disp_t *)
+{
+    refreshes++;
+    for (int half = 0; half < 2; half++)
+    {
+        uint32_t render = 1500 + (uint32_t)rand() % 2500;
+        if (half == 0 && rand() % 20 == 0)
+            render += 12000;
+        if (half == 1 && late_second_half)
+            render += 20000;
+        te_sim_spend(render);
+        lv_area_t area = {0, (lv_coord_t)(half * VER_RES / 2), HOR_RES - 1, (lv_coord_t)((half + 1) * VER_RES / 2 - 1)};
+        te_pacing_flush_gate(&area);
+        te_sim_spend(lv_area_get_size(&area) * SPI_NS_PER_PX / 1000);
+        te_pacing_flush_done(half == 1);
+    }
+}
+
+/* loop() for `ms` of virtual time, with the screen changing all the time */
+static te_stats_t run(uint32_t ms)
+{
+    te_stats = te_stats_t();
+    te_report_ms = te_now_us() / 1000; // the TE report would reset te_stats mid-phase
+    refreshes = 0;
+    uint32_t end = te_now_us() + ms * 1000;
+    while ((int32_t)(end - te_now_us()) > 0)
+    {
+        if (screen_changes)
+            lv_obj_invalidate(lv_scr_act());
+        uint32_t next_ms = lv_timer_handler();
+        next_ms = te_pacing_poll(next_ms);
+        te_sim_spend(LOOP_WORK_US + next_ms * 1000);
+    }
+    return te_stats;
+}
+
+static void report(const char *phase, const te_stats_t &s)
+{
+    printf("BENCH,te_pacing,%s,%u,%u,%u,%u\n", phase, (unsigned)s.frames, (unsigned)s.missed, (unsigned)s.torn,
+           (unsigned)s.fallbacks);
+}
+
+int main(int argc, char **argv)
+{
+    srand(argc > 1 ? atoi(argv[1]) : 1);
+    lv_sim_tick_ms = sim_tick_ms;
+    lv_sim_refresh = refresh;
+    te_sim_next_us = 5000;
+    // the governor's active period, not LVGL's default
+    lv_sim_disp.refr_timer = lv_timer_create(_lv_disp_refr_timer, 12, &lv_sim_disp);
+
+    CHECK(te_pacing_begin(0, VER_RES, false) && te_mode == TE_MODE_TE, "no TE mode with pulses");
+    CHECK(lv_sim_disp.refr_timer && lv_sim_disp.refr_timer->period == 12, "refresh timer lost its period");
+    te_stats_t s = run(9000);
+    report("portrait", s);
+    uint32_t pulses = 9000000 / te_sim_period_us;
+    CHECK(s.frames >= pulses * 35 / 100 && s.frames <= pulses / 2, "%u frames for %u pulses", (unsigned)s.frames,
+          (unsigned)pulses);
+    CHECK(s.torn == 0, "%u torn", (unsigned)s.torn);
+    CHECK(s.missed <= s.frames / 10, "%u missed", (unsigned)s.missed);
+
+    late_second_half = true;
+    s = run(3000);
+    report("late_half", s);
+    CHECK(s.frames > 0 && s.torn == s.frames, "late second half: %u of %u torn", (unsigned)s.torn,
+          (unsigned)s.frames);
+    late_second_half = false;
+
+    te_sim_enabled = false;
+    s = run(3000);
+    report("te_lost", s);
+    CHECK(s.fallbacks == 1 && te_mode == TE_MODE_TIMER, "%u fallbacks, mode %u", (unsigned)s.fallbacks,
+          (unsigned)te_mode);
+    CHECK(lv_sim_disp.refr_timer->timer_cb == _lv_disp_refr_timer && lv_sim_disp.refr_timer->period == 12,
+          "timer pacing not restored at the governor's period");
+    CHECK(s.frames >= 3000 / 25, "timer pacing: %u frames", (unsigned)s.frames);
+
+    te_sim_enabled = true;
+    te_sim_next_us = te_sim_us + 1000;
+    s = run(3 * TE_PROBE_MS);
+    report("te_back", s);
+    CHECK(te_mode == TE_MODE_TE, "TE mode not back after the pulses returned");
+
+    lv_timer_set_period(lv_sim_disp.refr_timer, 50);
+    s = run(5000);
+    report("slow_period", s);
+    CHECK(s.frames <= 5000 / 50 + 1 && s.frames >= 5000 / 50 * 8 / 10, "governor period in TE mode: %u frames",
+          (unsigned)s.frames);
+    CHECK(s.torn == 0, "%u torn", (unsigned)s.torn);
+    lv_timer_set_period(lv_sim_disp.refr_timer, 12);
+
+    screen_changes = false;
+    s = run(1000);
+    report("idle", s);
+    CHECK(s.frames <= 1 && lv_sim_disp.refr_timer->paused, "idle: %u frames, refresh timer %s", (unsigned)s.frames,
+          lv_sim_disp.refr_timer->paused ? "paused" : "running");
+    lv_obj_invalidate(lv_scr_act());
+    CHECK(!lv_sim_disp.refr_timer->paused, "invalidation did not resume the refresh timer");
+    screen_changes = true;
+    s = run(500);
+    CHECK(s.frames > 0, "no frames after idle");
+
+    // landscape: the half-screen band is full width, i.e. it crosses every scan line
+    te_lines = HOR_RES;
+    te_scan_x = true;
+    s = run(3000);
+    report("landscape", s);
+    CHECK(s.frames > 0 && s.torn == s.frames, "landscape: %u of %u torn", (unsigned)s.torn, (unsigned)s.frames);
+
+    printf("%s: %d failed checks\n", failures ? "FAIL" : "PASS", failures);
+    return failures ? 1 : 0;
+}
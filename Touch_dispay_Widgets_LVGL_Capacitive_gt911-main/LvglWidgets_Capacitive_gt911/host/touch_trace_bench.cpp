@@ -0,0 +1,144 @@
+/*******************************************************************************
+ * Host runner for the touch replay benchmark (see ../touch_trace.h)
+ *
+ * Build:  g++ -O2 -I. -I.. touch_trace_bench.cpp -o touch_trace_bench
+ *
+ *   touch_trace_bench
+ *
+ * Builds the demo's tab layout (create_controls_for_tab: two buttons, two
+ * sliders with num_label values per tab) on host/lvgl.h with the sketch's
+ * half-screen draw buffer, registers my_touchpad_read as the pointer indev
+ * and runs touch_bench_run_all(): every canned scenario goes through
+ * my_touchpad_read -> touch_trace_replay_read on the virtual clock. The flush
+ * copies into a frame buffer as the SPI bus would.
+ *
+ * Prints the BENCH lines (the heap_min column is device-only, "-" here) and
+ * checks that each scenario did what it replays: swipes change the tab,
+ * drags move a slider end to end, taps click both buttons. Exits non-zero if
+ * a check fails or a scenario exceeds the host baselines in touch_benches[].
+ ******************************************************************************/
+#include <stdio.h>
+#include "lvgl.h"
+#include "touch_trace.h"
+#include "num_label.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                     \
+    do                                       \
+    {                                        \
+        if (!(cond))                         \
+        {                                    \
+            printf("FAIL %s: ", #cond);      \
+            printf(__VA_ARGS__);             \
+            printf("\n");                    \
+            failures++;                      \
+        }                                    \
+    } while (0)
+
+#define SCREEN_W 320
+#define SCREEN_H 240
+
+static lv_color_t frame_buffer[SCREEN_W * SCREEN_H];
+static lv_color_t draw_pixels[SCREEN_W * SCREEN_H / 2];
+static uint32_t clicks[2], tab_changes, slider_min = 100, slider_max = 0;
+
+/* my_disp_flush without the panel: the copy stands in for the SPI transfer */
+static void host_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p)
+{
+    uint32_t w = (area->x2 - area->x1 + 1);
+    uint32_t h = (area->y2 - area->y1 + 1);
+    for (int32_t y = area->y1; y <= area->y2; y++, color_p += w)
+        memcpy(&frame_buffer[y * SCREEN_W + area->x1], color_p, w * sizeof(lv_color_t));
+    touch_trace_on_flush(w * h);
+    lv_disp_flush_ready(disp);
+}
+
+/* my_touchpad_read: the replay first, then the panel, which the host has not got */
+static void my_touchpad_read(lv_indev_drv_t *indev_driver, lv_indev_data_t *data)
+{
+    if (touch_trace_replay_read(data))
+    {
+        return;
+    }
+    data->state = LV_INDEV_STATE_REL;
+}
+
+/* create_controls_for_tab's layout and value labels, counting instead of logging */
+static void create_controls_for_tab(lv_obj_t *parent, const char *btn1_text, const char *btn2_text)
+{
+    const int button_width = 120;
+    const int button_height = 50;
+    const int button_spacing = 20;
+    const int total_width = (button_width * 2) + button_spacing;
+    const int start_x = -(total_width / 2) + (button_width / 2);
+
+    for (int i = 0; i < 2; i++)
+    {
+        lv_obj_t *btn = lv_btn_create(parent);
+        lv_obj_set_size(btn, button_width, button_height);
+        lv_obj_align(btn, LV_ALIGN_TOP_MID, start_x + i * (button_width + button_spacing), 20);
+        lv_obj_t *label = lv_label_create(btn);
+        lv_label_set_text(label, i ? btn2_text : btn1_text);
+        lv_obj_center(label);
+        lv_obj_add_event_cb(btn, [](lv_event_t *e) {
+            clicks[lv_obj_get_index(lv_event_get_target(e))]++;
+        }, LV_EVENT_CLICKED, NULL);
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        lv_obj_t *slider = lv_slider_create(parent);
+        lv_obj_set_size(slider, 200, 10);
+        lv_obj_align(slider, LV_ALIGN_TOP_MID, 0, 90 + i * 50);
+        lv_obj_t *label = num_label_create(parent, 3);
+        num_label_set_int(label, 0);
+        lv_obj_align_to(label, slider, LV_ALIGN_OUT_TOP_MID, 0, -5);
+        lv_obj_add_event_cb(slider, [](lv_event_t *e) {
+            uint32_t v = (uint32_t)lv_slider_get_value(lv_event_get_target(e));
+            num_label_set_int((lv_obj_t *)lv_event_get_user_data(e), (int32_t)v);
+            slider_min = v < slider_min ? v : slider_min;
+            slider_max = v > slider_max ? v : slider_max;
+        }, LV_EVENT_VALUE_CHANGED, label);
+    }
+}
+
+int main()
+{
+    static lv_disp_draw_buf_t draw_buf;
+    static lv_disp_drv_t disp_drv;
+    static lv_indev_drv_t indev_drv;
+    lv_sim_tick_ms = lv_virtual_millis;
+    lv_init();
+    lv_disp_draw_buf_init(&draw_buf, draw_pixels, NULL, SCREEN_W * SCREEN_H / 2);
+    lv_disp_drv_init(&disp_drv);
+    disp_drv.hor_res = SCREEN_W;
+    disp_drv.ver_res = SCREEN_H;
+    disp_drv.flush_cb = host_flush;
+    disp_drv.draw_buf = &draw_buf;
+    lv_disp_drv_register(&disp_drv);
+    lv_indev_drv_init(&indev_drv);
+    indev_drv.type = LV_INDEV_TYPE_POINTER;
+    indev_drv.read_cb = my_touchpad_read;
+    lv_indev_drv_register(&indev_drv);
+
+    lv_obj_t *tabview = lv_tabview_create(lv_scr_act(), LV_DIR_TOP, 30);
+    create_controls_for_tab(lv_tabview_add_tab(tabview, "Tab 1"), "Tab1 Btn1", "Tab1 Btn2");
+    create_controls_for_tab(lv_tabview_add_tab(tabview, "Tab 2"), "Tab2 Btn1", "Tab2 Btn2");
+    lv_obj_add_event_cb(tabview, [](lv_event_t *) { tab_changes++; }, LV_EVENT_VALUE_CHANGED, NULL);
+    lv_refr_now(NULL);
+
+    int failed = touch_bench_run_all();
+    CHECK(failed == 0, "%d scenarios over their baseline", failed);
+    // every scenario is replayed TOUCH_BENCH_REPEAT times
+    CHECK(tab_changes == 6 * TOUCH_BENCH_REPEAT, "6 swipes changed the tab %u times", (unsigned)tab_changes / TOUCH_BENCH_REPEAT);
+    CHECK(slider_min == 0 && slider_max == 100, "slider drags covered %u..%u", (unsigned)slider_min,
+          (unsigned)slider_max);
+    CHECK(clicks[0] == 20 * TOUCH_BENCH_REPEAT && clicks[1] == 20 * TOUCH_BENCH_REPEAT, "40 taps clicked %u + %u",
+          (unsigned)clicks[0] / TOUCH_BENCH_REPEAT, (unsigned)clicks[1] / TOUCH_BENCH_REPEAT);
+    CHECK(lv_tabview_get_tab_act(tabview) == 0, "even number of swipes left tab %u active",
+          (unsigned)lv_tabview_get_tab_act(tabview));
+
+    printf("%s: %d failed checks\n", failures ? "FAIL" : "PASS", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,344 @@
+/*******************************************************************************
+ * Shared I2C bus manager
+ * One task owns the Wire peripheral. Clients (touch, OLED, sensors) queue
+ * transactions at high or low priority and get completions through callbacks
+ * or by blocking in i2c_bus_transfer(). Each queued transaction is one bus
+ * transfer, so a bulk writer that splits its data into chunks (the OLED
+ * driver sends at most 128 bytes per write) is preempted between chunks
+ * whenever a high priority transaction such as a touch read is waiting.
+ *
+ * Usage:
+ *   Wire.begin(SDA, SCL);
+ *   i2c_bus_init();
+ *   i2c_bus_call(I2C_CLIENT_TOUCH, I2C_PRIO_HIGH, read_fn, NULL, 44);
+ *
+ * Without ARDUINO the bus is simulated with a 400 kHz byte-time model and
+ * i2c_bus_sim_run() executes the queue in virtual time; host/i2c_bus_sim.cpp
+ * measures touch latency under a saturating OLED load with it.
+ ******************************************************************************/
+#ifndef _I2C_BUS_H
+#define _I2C_BUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define I2C_BUS_QUEUE_SIZE 16      // per priority, must be a power of two
+#define I2C_BUS_FREQ 400000
+#define I2C_BUS_NS_PER_BYTE (9 * 1000000000ULL / I2C_BUS_FREQ) // 8 data bits + ACK
+
+enum i2c_client_t
+{
+    I2C_CLIENT_TOUCH,
+    I2C_CLIENT_OLED,
+    I2C_CLIENT_SENSOR,
+    I2C_CLIENT_COUNT
+};
+
+enum i2c_prio_t
+{
+    I2C_PRIO_HIGH,
+    I2C_PRIO_LOW,
+    I2C_PRIO_COUNT
+};
+
+enum i2c_txn_type_t
+{
+    I2C_TXN_WRITE, // tx to addr
+    I2C_TXN_READ,  // tx (register address) then repeated start and rx
+    I2C_TXN_CALL   // fn(arg) runs with exclusive access, for libraries that drive Wire themselves
+};
+
+struct i2c_txn_t;
+typedef void (*i2c_done_cb_t)(i2c_txn_t *txn, bool ok);
+
+struct i2c_txn_t
+{
+    uint8_t client;       // i2c_client_t
+    uint8_t prio;         // i2c_prio_t
+    uint8_t type;         // i2c_txn_type_t
+    uint8_t addr;
+    const uint8_t *tx;
+    size_t tx_len;
+    uint8_t *rx;
+    size_t rx_len;
+    bool (*fn)(void *arg);
+    void *arg;
+    uint16_t est_bytes;   // bus bytes of a CALL, for the host time model
+    i2c_done_cb_t done;   // may be NULL; runs on the bus task
+    void *user;
+    uint64_t submit_us;   // filled in by the bus manager
+    void *waiter;         // blocked i2c_bus_transfer() caller
+    bool ok;
+};
+
+typedef struct
+{
+    uint32_t txns;
+    uint64_t busy_us;     // time this client held the bus
+    uint64_t latency_us;  // submit -> completion, summed
+    uint32_t latency_us_max;
+} i2c_client_stats_t;
+
+static i2c_client_stats_t i2c_bus_stats[I2C_CLIENT_COUNT];
+static uint64_t i2c_bus_stats_start_us;
+static i2c_txn_t *i2c_bus_queue[I2C_PRIO_COUNT][I2C_BUS_QUEUE_SIZE];
+static uint32_t i2c_bus_head[I2C_PRIO_COUNT], i2c_bus_tail[I2C_PRIO_COUNT];
+
+/* Platform layer */
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <Wire.h>
+#include <esp_timer.h>
+
+static portMUX_TYPE i2c_bus_mux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t i2c_bus_pending; // counts queued transactions
+static TaskHandle_t i2c_bus_task_handle;
+
+#define I2C_BUS_LOCK() portENTER_CRITICAL(&i2c_bus_mux)
+#define I2C_BUS_UNLOCK() portEXIT_CRITICAL(&i2c_bus_mux)
+
+static inline uint64_t i2c_bus_now_us() { return esp_timer_get_time(); }
+
+static bool i2c_bus_execute(i2c_txn_t *t)
+{
+    switch (t->type)
+    {
+    case I2C_TXN_WRITE:
+        Wire.beginTransmission(t->addr);
+        Wire.write(t->tx, t->tx_len);
+        return Wire.endTransmission() == 0;
+    case I2C_TXN_READ:
+        Wire.beginTransmission(t->addr);
+        Wire.write(t->tx, t->tx_len);
+        if (Wire.endTransmission(false) != 0)
+            return false;
+        if (Wire.requestFrom(t->addr, (uint8_t)t->rx_len) != t->rx_len)
+            return false;
+        for (size_t i = 0; i < t->rx_len; i++)
+            t->rx[i] = Wire.read();
+        return true;
+    case I2C_TXN_CALL:
+        return t->fn(t->arg);
+    }
+    return false;
+}
+
+#else
+#include <stdio.h>
+
+static uint64_t i2c_bus_sim_time_ns = 0;
+
+#define I2C_BUS_LOCK()
+#define I2C_BUS_UNLOCK()
+
+static inline uint64_t i2c_bus_now_us() { return i2c_bus_sim_time_ns / 1000; }
+
+/* Advances virtual time by the bytes the transaction puts on the wire */
+static bool i2c_bus_execute(i2c_txn_t *t)
+{
+    size_t bytes;
+    bool ok = true;
+    switch (t->type)
+    {
+    case I2C_TXN_WRITE:
+        bytes = 1 + t->tx_len;
+        break;
+    case I2C_TXN_READ:
+        bytes = 1 + t->tx_len + 1 + t->rx_len;
+        break;
+    default:
+        bytes = t->est_bytes;
+        ok = t->fn(t->arg);
+        break;
+    }
+    i2c_bus_sim_time_ns += bytes * I2C_BUS_NS_PER_BYTE;
+    return ok;
+}
+#endif
+
+/* Queue */
+bool i2c_bus_submit(i2c_txn_t *t)
+{
+    uint8_t p = t->prio < I2C_PRIO_COUNT ? t->prio : (uint8_t)I2C_PRIO_LOW;
+    t->submit_us = i2c_bus_now_us();
+    I2C_BUS_LOCK();
+    if (i2c_bus_head[p] - i2c_bus_tail[p] >= I2C_BUS_QUEUE_SIZE)
+    {
+        I2C_BUS_UNLOCK();
+        return false;
+    }
+    i2c_bus_queue[p][i2c_bus_head[p]++ & (I2C_BUS_QUEUE_SIZE - 1)] = t;
+    I2C_BUS_UNLOCK();
+#ifdef ARDUINO
+    xSemaphoreGive(i2c_bus_pending);
+#endif
+    return true;
+}
+
+/* Highest priority first; low priority only when nothing urgent waits */
+static i2c_txn_t *i2c_bus_next()
+{
+    i2c_txn_t *t = NULL;
+    I2C_BUS_LOCK();
+    for (uint8_t p = 0; p < I2C_PRIO_COUNT && !t; p++)
+    {
+        if (i2c_bus_head[p] != i2c_bus_tail[p])
+            t = i2c_bus_queue[p][i2c_bus_tail[p]++ & (I2C_BUS_QUEUE_SIZE - 1)];
+    }
+    I2C_BUS_UNLOCK();
+    return t;
+}
+
+static void i2c_bus_run_one(i2c_txn_t *t)
+{
+    uint64_t start = i2c_bus_now_us();
+    bool ok = i2c_bus_execute(t);
+    uint64_t end = i2c_bus_now_us();
+
+    i2c_client_stats_t *s = &i2c_bus_stats[t->client < I2C_CLIENT_COUNT ? t->client : (uint8_t)I2C_CLIENT_SENSOR];
+    uint32_t latency = (uint32_t)(end - t->submit_us);
+    s->txns++;
+    s->busy_us += end - start;
+    s->latency_us += latency;
+    if (latency > s->latency_us_max)
+        s->latency_us_max = latency;
+
+    t->ok = ok;
+    if (t->done)
+        t->done(t, ok);
+    if (t->waiter)
+    {
+        // t lives on the waiter's stack: clear it before the waiter can return
+        void *waiter = t->waiter;
+        t->waiter = NULL;
+#ifdef ARDUINO
+        xSemaphoreGive((SemaphoreHandle_t)waiter);
+#else
+        (void)waiter;
+#endif
+    }
+}
+
+#ifdef ARDUINO
+static void i2c_bus_task(void *)
+{
+    for (;;)
+    {
+        xSemaphoreTake(i2c_bus_pending, portMAX_DELAY);
+        i2c_txn_t *t = i2c_bus_next();
+        if (t)
+            i2c_bus_run_one(t);
+    }
+}
+
+/* Call after Wire.begin(); the bus task sits above the LVGL loop priority */
+void i2c_bus_init()
+{
+    if (i2c_bus_task_handle)
+        return;
+    i2c_bus_pending = xSemaphoreCreateCounting(I2C_PRIO_COUNT * I2C_BUS_QUEUE_SIZE, 0);
+    xTaskCreate(i2c_bus_task, "i2c_bus", 4096, NULL, 3, &i2c_bus_task_handle);
+    i2c_bus_stats_start_us = i2c_bus_now_us();
+}
+
+/* Blocking transfer from any task except the bus task itself.
+ * The completion is a semaphore on the caller's stack, so the caller's task
+ * notification value stays free for its own use (te_pacing.h, oled.h) */
+bool i2c_bus_transfer(i2c_txn_t *t)
+{
+    if (xTaskGetCurrentTaskHandle() == i2c_bus_task_handle)
+    {
+        i2c_bus_run_one(t);
+        return t->ok;
+    }
+    StaticSemaphore_t done_buf;
+    SemaphoreHandle_t done = xSemaphoreCreateBinaryStatic(&done_buf);
+    t->waiter = done;
+    bool ok = i2c_bus_submit(t);
+    if (ok)
+    {
+        xSemaphoreTake(done, portMAX_DELAY);
+        ok = t->ok;
+    }
+    vSemaphoreDelete(done);
+    return ok;
+}
+#else
+void i2c_bus_init() { i2c_bus_stats_start_us = i2c_bus_now_us(); }
+
+/* Host: run queued transactions until the queue is empty or time_ns is reached */
+void i2c_bus_sim_run(uint64_t until_ns)
+{
+    i2c_txn_t *t;
+    while (i2c_bus_sim_time_ns < until_ns && (t = i2c_bus_next()) != NULL)
+        i2c_bus_run_one(t);
+    if (i2c_bus_sim_time_ns < until_ns)
+        i2c_bus_sim_time_ns = until_ns;
+}
+
+/* Host: a blocking transfer runs the queue in priority order until it is done */
+bool i2c_bus_transfer(i2c_txn_t *t)
+{
+    t->waiter = t;
+    if (!i2c_bus_submit(t))
+        return false;
+    i2c_txn_t *n;
+    while (t->waiter && (n = i2c_bus_next()) != NULL)
+        i2c_bus_run_one(n);
+    return t->ok;
+}
+#endif
+
+/* Convenience wrappers */
+bool i2c_bus_call(uint8_t client, uint8_t prio, bool (*fn)(void *), void *arg, uint16_t est_bytes)
+{
+    i2c_txn_t t = {};
+    t.client = client;
+    t.prio = prio;
+    t.type = I2C_TXN_CALL;
+    t.fn = fn;
+    t.arg = arg;
+    t.est_bytes = est_bytes;
+    return i2c_bus_transfer(&t);
+}
+
+bool i2c_bus_write(uint8_t client, uint8_t prio, uint8_t addr, const uint8_t *buf, size_t len)
+{
+    i2c_txn_t t = {};
+    t.client = client;
+    t.prio = prio;
+    t.type = I2C_TXN_WRITE;
+    t.addr = addr;
+    t.tx = buf;
+    t.tx_len = len;
+    return i2c_bus_transfer(&t);
+}
+
+/* The OLED driver's bus hook (oled.h): every chunk is a separate low
+ * priority transaction, so touch reads can get in between them */
+static inline bool i2c_bus_oled_write(uint8_t addr, const uint8_t *buf, size_t len)
+{
+    return i2c_bus_write(I2C_CLIENT_OLED, I2C_PRIO_LOW, addr, buf, len);
+}
+
+void i2c_bus_print_stats()
+{
+    static const char *names[I2C_CLIENT_COUNT] = {"touch", "oled", "sensor"};
+    uint64_t elapsed = i2c_bus_now_us() - i2c_bus_stats_start_us;
+    for (uint8_t c = 0; c < I2C_CLIENT_COUNT; c++)
+    {
+        const i2c_client_stats_t *s = &i2c_bus_stats[c];
+#ifdef ARDUINO
+        Serial.printf(
+#else
+        printf(
+#endif
+            "i2c %s: %u txns, util %u.%u%%, latency avg %u us max %u us\n", names[c], (unsigned)s->txns,
+            (unsigned)(elapsed ? s->busy_us * 100 / elapsed : 0),
+            (unsigned)(elapsed ? s->busy_us * 1000 / elapsed % 10 : 0),
+            (unsigned)(s->txns ? s->latency_us / s->txns : 0), (unsigned)s->latency_us_max);
+    }
+}
+
+#endif // _I2C_BUS_H
@@ -0,0 +1,255 @@
+/*******************************************************************************
+ * Touch-to-photon latency tracer
+ * Every new touch sample gets a correlation id. The id is carried through the
+ * trace points below until the first flush that completes after it, so each
+ * input is matched with the first frame that shows its effect:
+ *
+ *   TOUCH_SAMPLE  GT911 read returned a contact             (touch.h)
+ *   INDEV_READ    my_touchpad_read handed it to LVGL
+ *   EVENT_CB      a widget event callback ran
+ *   INVALIDATE    the callback changed something on screen
+ *   RENDER_START  LVGL started drawing the frame      (disp_drv.render_start_cb)
+ *   RENDER_DONE   the first area is drawn                (my_disp_flush entry)
+ *   FLUSH_START   the first area started going to the panel, after any wait
+ *                 for the TE pulse (te_pacing.h)
+ *   FLUSH_END     the last area of that frame was sent
+ *
+ * Without a render_start_cb the frame is matched at RENDER_DONE and the
+ * render stage is folded into the one before it.
+ *
+ * A trace point is one cycle counter read and two stores. latency_trace_bench()
+ * measures that cost on the target (TOUCH_BENCH runs it) and checks it stays
+ * under 1 us. Per-stage latencies (from the previous point that was hit) and
+ * the total go into log2 histograms; latency_trace_print() writes them to
+ * Serial as "LAT,<stage>,<count>,<p50_us>,<p99_us>,<max_us>" lines.
+ *
+ * Define LATENCY_TRACE before including this file to enable it; otherwise all
+ * trace points compile to nothing.
+ ******************************************************************************/
+#ifndef _LATENCY_TRACE_H
+#define _LATENCY_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+enum latency_point_t
+{
+    LAT_TOUCH_SAMPLE,
+    LAT_INDEV_READ,
+    LAT_EVENT_CB,
+    LAT_INVALIDATE,
+    LAT_RENDER_START,
+    LAT_RENDER_DONE,
+    LAT_FLUSH_START,
+    LAT_FLUSH_END,
+    LAT_POINTS
+};
+
+#ifdef LATENCY_TRACE
+
+#define LAT_SLOTS 8                // in-flight inputs, power of two
+#define LAT_BUCKETS 20             // log2 us: 1 us .. 0.5 s
+#define LATENCY_TRACE_REPORT_MS 10000
+#define LATENCY_BENCH_ROUNDS 10000
+#define LATENCY_MARK_MAX_NS 1000
+
+#ifdef ARDUINO
+#include <Arduino.h>
+static inline uint32_t latency_cycles() { return ESP.getCycleCount(); }
+static inline uint32_t latency_cycles_per_us() { return getCpuFrequencyMhz(); }
+#define LATENCY_PRINTF Serial.printf
+#else
+#include <stdio.h>
+#include <time.h>
+static inline uint32_t latency_cycles()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+static inline uint32_t latency_cycles_per_us() { return 1000; }
+#define LATENCY_PRINTF printf
+#endif
+
+typedef struct
+{
+    uint32_t id;
+    uint8_t seen;        // bit per latency_point_t
+    bool done;
+    uint32_t cyc[LAT_POINTS];
+} latency_slot_t;
+
+static latency_slot_t latency_slots[LAT_SLOTS];
+static uint32_t latency_next_id = 1;
+static volatile uint32_t latency_last_id = 0;   // newest touch sample
+static uint32_t latency_active_id = 0;          // input LVGL is currently processing
+static uint32_t latency_frame_id = 0;           // input the frame being flushed belongs to
+static uint32_t latency_hist[LAT_POINTS][LAT_BUCKETS]; // [LAT_TOUCH_SAMPLE] holds the total
+static uint32_t latency_max_us[LAT_POINTS];
+static uint32_t latency_last_report = 0;
+
+static inline latency_slot_t *latency_slot(uint32_t id) { return &latency_slots[id & (LAT_SLOTS - 1)]; }
+
+static inline void latency_stamp(uint32_t id, uint8_t point)
+{
+    latency_slot_t *s = latency_slot(id);
+    if (s->id == id && !(s->seen & (1 << point)))
+    {
+        s->cyc[point] = latency_cycles();
+        s->seen |= 1 << point;
+    }
+}
+
+/* TOUCH_SAMPLE: opens a new correlation id */
+static inline void latency_trace_sample()
+{
+    uint32_t id = latency_next_id++;
+    latency_slot_t *s = latency_slot(id);
+    s->cyc[LAT_TOUCH_SAMPLE] = latency_cycles();
+    s->seen = 1 << LAT_TOUCH_SAMPLE;
+    s->done = false;
+    s->id = id;
+    latency_last_id = id;
+}
+
+static inline void latency_trace_mark(uint8_t point)
+{
+    switch (point)
+    {
+    case LAT_INDEV_READ:
+        latency_active_id = latency_last_id;
+        if (latency_active_id)
+            latency_stamp(latency_active_id, point);
+        break;
+    case LAT_EVENT_CB:
+    case LAT_INVALIDATE:
+        if (latency_active_id)
+            latency_stamp(latency_active_id, point);
+        break;
+    case LAT_RENDER_START:
+    case LAT_RENDER_DONE:
+        // widgets restyle themselves on press without an app callback, so any
+        // frame after an unanswered input counts as its first frame
+        if (!latency_frame_id && latency_active_id && !latency_slot(latency_active_id)->done)
+            latency_frame_id = latency_active_id;
+        // fall through
+    case LAT_FLUSH_START:
+        if (latency_frame_id)
+            latency_stamp(latency_frame_id, point);
+        break;
+    }
+}
+
+static void latency_hist_add(uint8_t stage, uint32_t cycles)
+{
+    uint32_t us = cycles / latency_cycles_per_us();
+    uint8_t b = 0;
+    while (b < LAT_BUCKETS - 1 && (us >> b) > 1)
+        b++;
+    latency_hist[stage][b]++;
+    if (us > latency_max_us[stage])
+        latency_max_us[stage] = us;
+}
+
+/* FLUSH_END: call with lv_disp_flush_is_last() so only whole frames complete */
+static inline void latency_trace_flush_end(bool last)
+{
+    if (!latency_frame_id || !last)
+        return;
+    latency_slot_t *s = latency_slot(latency_frame_id);
+    latency_frame_id = 0;
+    if (s->done)
+        return;
+    s->cyc[LAT_FLUSH_END] = latency_cycles();
+    s->seen |= 1 << LAT_FLUSH_END;
+    s->done = true;
+
+    uint8_t prev = LAT_TOUCH_SAMPLE;
+    for (uint8_t p = LAT_INDEV_READ; p < LAT_POINTS; p++)
+    {
+        if (!(s->seen & (1 << p)))
+            continue;
+        latency_hist_add(p, s->cyc[p] - s->cyc[prev]);
+        prev = p;
+    }
+    latency_hist_add(LAT_TOUCH_SAMPLE, s->cyc[LAT_FLUSH_END] - s->cyc[LAT_TOUCH_SAMPLE]);
+}
+
+/* Upper edge of the bucket holding the given per-mille of the samples */
+static uint32_t latency_percentile(uint8_t stage, uint32_t count, uint32_t permille)
+{
+    uint32_t want = (count * permille + 999) / 1000, seen = 0;
+    for (uint8_t b = 0; b < LAT_BUCKETS; b++)
+    {
+        seen += latency_hist[stage][b];
+        if (seen >= want)
+            return (2u << b) < latency_max_us[stage] ? (2u << b) : latency_max_us[stage];
+    }
+    return latency_max_us[stage];
+}
+
+void latency_trace_print()
+{
+    static const char *names[LAT_POINTS] = {"total",        "indev_read",  "event_cb",    "invalidate",
+                                            "render_start", "render_done", "flush_start", "flush_end"};
+    for (uint8_t p = 0; p < LAT_POINTS; p++)
+    {
+        uint32_t count = 0;
+        for (uint8_t b = 0; b < LAT_BUCKETS; b++)
+            count += latency_hist[p][b];
+        if (count)
+            LATENCY_PRINTF("LAT,%s,%u,%u,%u,%u\n", names[p], (unsigned)count,
+                           (unsigned)latency_percentile(p, count, 500), (unsigned)latency_percentile(p, count, 990),
+                           (unsigned)latency_max_us[p]);
+    }
+}
+
+/* Cost of one trace point: a new sample and the three input-side marks per
+   round, so every mark finds its slot and stores. Prints
+   "BENCH,latency_mark,<marks>,<ns per mark>,<PASS|FAIL>" and leaves no input
+   open, the histograms are not touched. */
+bool latency_trace_bench()
+{
+    uint32_t saved_next_id = latency_next_id;
+    uint32_t start = latency_cycles();
+    for (uint32_t i = 0; i < LATENCY_BENCH_ROUNDS; i++)
+    {
+        latency_trace_sample();
+        latency_trace_mark(LAT_INDEV_READ);
+        latency_trace_mark(LAT_EVENT_CB);
+        latency_trace_mark(LAT_INVALIDATE);
+    }
+    uint32_t cycles = latency_cycles() - start;
+    uint32_t marks = LATENCY_BENCH_ROUNDS * 4;
+    uint32_t ns = (uint32_t)((uint64_t)cycles * 1000 / latency_cycles_per_us() / marks);
+
+    for (uint8_t i = 0; i < LAT_SLOTS; i++)
+        latency_slots[i].id = 0;
+    latency_next_id = saved_next_id;
+    latency_last_id = latency_active_id = latency_frame_id = 0;
+
+    bool pass = ns < LATENCY_MARK_MAX_NS;
+    LATENCY_PRINTF("BENCH,latency_mark,%u,%u,%s\n", (unsigned)marks, (unsigned)ns, pass ? "PASS" : "FAIL");
+    return pass;
+}
+
+/* From loop(): periodic report */
+void latency_trace_poll(uint32_t now_ms)
+{
+    if (now_ms - latency_last_report >= LATENCY_TRACE_REPORT_MS)
+    {
+        latency_last_report = now_ms;
+        latency_trace_print();
+    }
+}
+
+#else
+static inline void latency_trace_sample() {}
+static inline void latency_trace_mark(uint8_t) {}
+static inline void latency_trace_flush_end(bool) {}
+static inline void latency_trace_print() {}
+static inline bool latency_trace_bench() { return true; }
+static inline void latency_trace_poll(uint32_t) {}
+#endif // LATENCY_TRACE
+
+#endif // _LATENCY_TRACE_H
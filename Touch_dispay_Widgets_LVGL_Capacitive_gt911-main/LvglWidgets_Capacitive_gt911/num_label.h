@@ -0,0 +1,407 @@
+/*******************************************************************************
+ * Fast numeric label with a pre-rasterised glyph cache
+ * lv_label re-lays out its text, invalidates its whole area and renders every
+ * glyph through the generic letter pipeline (bitmap unpack, opa table, blend)
+ * on each lv_label_set_text(). The slider labels change on every drag step, so
+ * this widget keeps the glyphs of NUM_LABEL_CHARSET as ready-to-blend A8
+ * bitmaps in a fixed RAM pool and lays them out on a fixed cell pitch:
+ *
+ *   - a text update compares cell by cell and invalidates only the glyph
+ *     boxes of the characters that changed
+ *   - drawing blends the cached A8 alpha straight into the draw buffer,
+ *     without touching the font data
+ *
+ * Characters outside the charset, or fonts other than the one the cache was
+ * built for, still work: they are drawn with lv_draw_letter().
+ *
+ *   lv_obj_t *l = num_label_create(parent, 3);    // room for 3 characters
+ *   num_label_set_int(l, lv_slider_get_value(slider));
+ *
+ * num_label_bench() compares per-update draw time and invalidated pixels
+ * with a stock lv_label and prints
+ *   BENCH,<name>,<updates>,<p50_us>,<p99_us>,<inv_px/update>,<flush_us/update>
+ * The p50/p99 times are the update plus LVGL's render, without the flush:
+ * the display driver's flush_cb is timed separately during the bench, which
+ * assumes it is synchronous (calls lv_disp_flush_ready() before returning),
+ * as my_disp_flush is. host/num_label_bench.cpp runs it on host/lvgl.h.
+ ******************************************************************************/
+#ifndef _NUM_LABEL_H
+#define _NUM_LABEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lvgl.h>
+
+#define NUM_LABEL_CHARSET "0123456789-+.,:%"
+#define NUM_LABEL_CACHE_BYTES 1536     // A8 pool; glyphs that do not fit are drawn uncached
+#define NUM_LABEL_MAX_CHARS 8
+#define NUM_LABEL_BENCH_UPDATES 200
+
+#ifdef ARDUINO
+#include <Arduino.h>
+static inline uint32_t num_label_us() { return micros(); }
+#define NUM_LABEL_PRINTF Serial.printf
+#else
+#include <stdio.h>
+#include <time.h>
+static inline uint32_t num_label_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+#define NUM_LABEL_PRINTF printf
+#endif
+
+typedef struct
+{
+    uint8_t letter;
+    uint8_t adv_w;
+    uint8_t box_w;
+    uint8_t box_h;
+    int8_t ofs_x;
+    int8_t ofs_y;
+    uint16_t offset;     // into num_label_pool, 0xFFFF when not cached
+} num_label_glyph_t;
+
+typedef struct
+{
+    uint32_t updates;
+    uint32_t cells_changed;
+    uint32_t inv_px;        // glyph box pixels invalidated
+    uint32_t cached_draws;
+    uint32_t fallback_draws;
+} num_label_stats_t;
+
+typedef struct
+{
+    char text[NUM_LABEL_MAX_CHARS + 1];
+    uint8_t cells;
+} num_label_t;
+
+static const lv_font_t *num_label_font = NULL;   // font the cache was built for
+static num_label_glyph_t num_label_glyphs[sizeof(NUM_LABEL_CHARSET) - 1];
+static uint8_t num_label_pool[NUM_LABEL_CACHE_BYTES];
+static uint8_t num_label_pitch = 0;              // cell width: widest cached glyph advance
+static num_label_stats_t num_label_stats;
+
+/* Rasterises the charset of `font` into the pool once */
+void num_label_cache_init(const lv_font_t *font)
+{
+    if (num_label_font == font)
+        return;
+    num_label_font = font;
+    num_label_pitch = 0;
+    uint16_t used = 0;
+    for (uint8_t i = 0; i < sizeof(num_label_glyphs) / sizeof(num_label_glyphs[0]); i++)
+    {
+        num_label_glyph_t *g = &num_label_glyphs[i];
+        lv_font_glyph_dsc_t dsc;
+        memset(g, 0, sizeof(*g));
+        g->letter = (uint8_t)NUM_LABEL_CHARSET[i];
+        g->offset = 0xFFFF;
+        if (!lv_font_get_glyph_dsc(font, &dsc, g->letter, 0))
+            continue;
+        g->adv_w = (uint8_t)dsc.adv_w;
+        g->box_w = (uint8_t)dsc.box_w;
+        g->box_h = (uint8_t)dsc.box_h;
+        g->ofs_x = (int8_t)dsc.ofs_x;
+        g->ofs_y = (int8_t)dsc.ofs_y;
+        if (g->letter >= '0' && g->letter <= '9' && g->adv_w > num_label_pitch)
+            num_label_pitch = g->adv_w;
+
+        uint16_t size = (uint16_t)g->box_w * g->box_h;
+        const uint8_t *src = size ? lv_font_get_glyph_bitmap(font, g->letter) : NULL;
+        if (!src || dsc.bpp > 8 || used + size > NUM_LABEL_CACHE_BYTES)
+            continue;
+        // LVGL glyph bitmaps are one MSB-first bit stream, rows are not byte aligned
+        uint8_t bpp = dsc.bpp, max = (1 << bpp) - 1;
+        for (uint16_t p = 0; p < size; p++)
+        {
+            uint32_t bit = (uint32_t)p * bpp;
+            uint8_t v = (src[bit >> 3] >> (8 - bpp - (bit & 7))) & max;
+            num_label_pool[used + p] = (uint8_t)(v * 255 / max);
+        }
+        g->offset = used;
+        used += size;
+    }
+}
+
+static const num_label_glyph_t *num_label_find(uint8_t letter)
+{
+    for (uint8_t i = 0; i < sizeof(num_label_glyphs) / sizeof(num_label_glyphs[0]); i++)
+        if (num_label_glyphs[i].letter == letter)
+            return &num_label_glyphs[i];
+    return NULL;
+}
+
+/* Left edge of character i, relative to the object: the text is centred on the cell grid */
+static inline lv_coord_t num_label_cell_x(const num_label_t *nl, uint8_t len, uint8_t i)
+{
+    return (lv_coord_t)((nl->cells - len) * num_label_pitch / 2 + i * num_label_pitch);
+}
+
+/* Absolute glyph box of `letter` drawn in the cell at cell_x */
+static bool num_label_glyph_area(lv_obj_t *obj, uint8_t letter, lv_coord_t cell_x, lv_area_t *a)
+{
+    const lv_font_t *font = lv_obj_get_style_text_font(obj, LV_PART_MAIN);
+    lv_font_glyph_dsc_t dsc;
+    if (!lv_font_get_glyph_dsc(font, &dsc, letter, 0) || !dsc.box_w || !dsc.box_h)
+        return false;
+    a->x1 = obj->coords.x1 + cell_x + (num_label_pitch - dsc.adv_w) / 2 + dsc.ofs_x;
+    a->y1 = obj->coords.y1 + (font->line_height - font->base_line) - dsc.box_h - dsc.ofs_y;
+    a->x2 = a->x1 + dsc.box_w - 1;
+    a->y2 = a->y1 + dsc.box_h - 1;
+    return true;
+}
+
+static void num_label_blit(lv_draw_ctx_t *draw_ctx, const num_label_glyph_t *g, lv_coord_t x, lv_coord_t y,
+                           lv_color_t color, lv_opa_t opa)
+{
+    lv_area_t a = {x, y, (lv_coord_t)(x + g->box_w - 1), (lv_coord_t)(y + g->box_h - 1)}, clip;
+    if (!_lv_area_intersect(&clip, &a, draw_ctx->clip_area))
+        return;
+    lv_color_t *buf = (lv_color_t *)draw_ctx->buf;
+    lv_coord_t buf_w = lv_area_get_width(draw_ctx->buf_area);
+    const uint8_t *alpha = &num_label_pool[g->offset];
+    for (lv_coord_t py = clip.y1; py <= clip.y2; py++)
+    {
+        const uint8_t *src = alpha + (py - y) * g->box_w + (clip.x1 - x);
+        lv_color_t *dst = buf + (py - draw_ctx->buf_area->y1) * buf_w + (clip.x1 - draw_ctx->buf_area->x1);
+        for (lv_coord_t px = clip.x1; px <= clip.x2; px++, src++, dst++)
+        {
+            lv_opa_t a8 = opa == LV_OPA_COVER ? *src : (lv_opa_t)((*src * opa) >> 8);
+            if (a8 >= LV_OPA_MAX)
+                *dst = color;
+            else if (a8 > LV_OPA_MIN)
+                *dst = lv_color_mix(color, *dst, a8);
+        }
+    }
+}
+
+static void num_label_event_cb(lv_event_t *e)
+{
+    lv_obj_t *obj = lv_event_get_target(e);
+    num_label_t *nl = (num_label_t *)lv_obj_get_user_data(obj);
+    if (lv_event_get_code(e) == LV_EVENT_DELETE)
+    {
+        free(nl);
+        return;
+    }
+
+    lv_draw_ctx_t *draw_ctx = lv_event_get_draw_ctx(e);
+    const lv_font_t *font = lv_obj_get_style_text_font(obj, LV_PART_MAIN);
+    lv_color_t color = lv_obj_get_style_text_color(obj, LV_PART_MAIN);
+    lv_opa_t opa = lv_obj_get_style_text_opa(obj, LV_PART_MAIN);
+    if (opa <= LV_OPA_MIN)
+        return;
+    lv_draw_label_dsc_t dsc;
+    lv_draw_label_dsc_init(&dsc);
+    dsc.font = font;
+    dsc.color = color;
+    dsc.opa = opa;
+
+    uint8_t len = (uint8_t)strlen(nl->text);
+    for (uint8_t i = 0; i < len; i++)
+    {
+        uint8_t letter = (uint8_t)nl->text[i];
+        lv_coord_t cell_x = obj->coords.x1 + num_label_cell_x(nl, len, i);
+        const num_label_glyph_t *g = font == num_label_font ? num_label_find(letter) : NULL;
+        if (g && g->offset != 0xFFFF)
+        {
+            lv_coord_t x = cell_x + (num_label_pitch - g->adv_w) / 2 + g->ofs_x;
+            lv_coord_t y = obj->coords.y1 + (font->line_height - font->base_line) - g->box_h - g->ofs_y;
+            num_label_blit(draw_ctx, g, x, y, color, opa);
+            num_label_stats.cached_draws++;
+        }
+        else if (letter != ' ')
+        {
+            lv_font_glyph_dsc_t gd;
+            lv_coord_t adv = lv_font_get_glyph_dsc(font, &gd, letter, 0) ? gd.adv_w : num_label_pitch;
+            lv_point_t pos = {(lv_coord_t)(cell_x + (num_label_pitch - adv) / 2), obj->coords.y1};
+            lv_draw_letter(draw_ctx, &dsc, &pos, letter);
+            num_label_stats.fallback_draws++;
+        }
+    }
+}
+
+/* `cells` is the longest text the label shows; the object is sized for it */
+lv_obj_t *num_label_create(lv_obj_t *parent, uint8_t cells)
+{
+    lv_obj_t *obj = lv_obj_create(parent);
+    lv_obj_remove_style_all(obj); // transparent, no padding: only the glyphs are drawn
+    lv_obj_clear_flag(obj, (lv_obj_flag_t)(LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_SCROLLABLE));
+
+    const lv_font_t *font = lv_obj_get_style_text_font(obj, LV_PART_MAIN);
+    num_label_cache_init(font);
+
+    num_label_t *nl = (num_label_t *)calloc(1, sizeof(num_label_t));
+    nl->cells = cells > NUM_LABEL_MAX_CHARS ? NUM_LABEL_MAX_CHARS : cells;
+    lv_obj_set_user_data(obj, nl);
+    lv_obj_set_size(obj, nl->cells * num_label_pitch, font->line_height);
+    lv_obj_add_event_cb(obj, num_label_event_cb, LV_EVENT_DRAW_MAIN, NULL);
+    lv_obj_add_event_cb(obj, num_label_event_cb, LV_EVENT_DELETE, NULL);
+    return obj;
+}
+
+/* Invalidates only the glyph boxes of characters that differ from the shown text */
+void num_label_set_text(lv_obj_t *obj, const char *text)
+{
+    num_label_t *nl = (num_label_t *)lv_obj_get_user_data(obj);
+    uint8_t old_len = (uint8_t)strlen(nl->text);
+    uint8_t new_len = (uint8_t)strnlen(text, nl->cells);
+    if (old_len == new_len && !memcmp(nl->text, text, new_len))
+        return;
+    num_label_stats.updates++;
+
+    lv_area_t a;
+    for (uint8_t i = 0; i < old_len; i++)
+    {
+        // a character stays only if the same letter lands on the same cell
+        lv_coord_t x = num_label_cell_x(nl, old_len, i);
+        bool kept = false;
+        for (uint8_t j = 0; j < new_len && !kept; j++)
+            kept = text[j] == nl->text[i] && num_label_cell_x(nl, new_len, j) == x;
+        if (!kept && num_label_glyph_area(obj, (uint8_t)nl->text[i], x, &a))
+        {
+            lv_obj_invalidate_area(obj, &a);
+            num_label_stats.cells_changed++;
+            num_label_stats.inv_px += lv_area_get_size(&a);
+        }
+    }
+    for (uint8_t j = 0; j < new_len; j++)
+    {
+        lv_coord_t x = num_label_cell_x(nl, new_len, j);
+        bool kept = false;
+        for (uint8_t i = 0; i < old_len && !kept; i++)
+            kept = text[j] == nl->text[i] && num_label_cell_x(nl, old_len, i) == x;
+        if (!kept && num_label_glyph_area(obj, (uint8_t)text[j], x, &a))
+        {
+            lv_obj_invalidate_area(obj, &a);
+            num_label_stats.cells_changed++;
+            num_label_stats.inv_px += lv_area_get_size(&a);
+        }
+    }
+    memcpy(nl->text, text, new_len);
+    nl->text[new_len] = '\0';
+}
+
+void num_label_set_int(lv_obj_t *obj, int32_t value)
+{
+    char buf[12], *p = buf + sizeof(buf) - 1;
+    uint32_t v = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    *p = '\0';
+    do
+    {
+        *--p = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    if (value < 0)
+        *--p = '-';
+    num_label_set_text(obj, p);
+}
+
+/* Pixels LVGL will redraw on the next refresh */
+static uint32_t num_label_pending_px()
+{
+    lv_disp_t *disp = lv_disp_get_default();
+    uint32_t px = 0;
+    for (uint16_t i = 0; i < disp->inv_p; i++)
+        if (!disp->inv_area_joined[i])
+            px += lv_area_get_size(&disp->inv_areas[i]);
+    return px;
+}
+
+/* Bench: the driver's flush_cb, wrapped to take its time out of the draw time */
+static void (*num_label_flush_cb)(lv_disp_drv_t *, const lv_area_t *, lv_color_t *) = NULL;
+static uint32_t num_label_flush_us = 0;
+
+static void num_label_timed_flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *px)
+{
+    uint32_t t0 = num_label_us();
+    num_label_flush_cb(drv, area, px);
+    num_label_flush_us += num_label_us() - t0;
+}
+
+static int num_label_cmp(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Drives both label kinds through the same slider-like value sequence on a
+ * scratch screen; every update is rendered and flushed with lv_refr_now(),
+ * the flush time is taken out. Passes when the cached label takes less time
+ * over the updates below p99 and invalidates less than the stock one,
+ * without falling back to the font. */
+bool num_label_bench()
+{
+    static uint32_t us[NUM_LABEL_BENCH_UPDATES];
+    uint32_t total[2], px[2];
+    lv_disp_t *disp = lv_disp_get_default();
+    lv_obj_t *prev = lv_scr_act();
+    lv_obj_t *scr = lv_obj_create(NULL);
+    lv_scr_load(scr);
+    lv_obj_t *stock = lv_label_create(scr);
+    lv_obj_t *fast = num_label_create(scr, 3);
+    lv_obj_align(stock, LV_ALIGN_CENTER, 0, -20);
+    lv_obj_align(fast, LV_ALIGN_CENTER, 0, 20);
+    lv_label_set_text(stock, "0");
+    num_label_set_int(fast, 0);
+    lv_refr_now(NULL);
+
+    num_label_flush_cb = disp->driver->flush_cb;
+    disp->driver->flush_cb = num_label_timed_flush;
+    for (uint8_t kind = 0; kind < 2; kind++)
+    {
+        uint32_t flush_total = 0;
+        px[kind] = 0;
+        total[kind] = 0;
+        num_label_stats = num_label_stats_t();
+        for (uint16_t i = 0; i < NUM_LABEL_BENCH_UPDATES; i++)
+        {
+            // drag up 0..100 and back, with a jump every 50 updates
+            int32_t v = i % 50 == 49 ? (i * 37) % 101 : (i / 100) % 2 ? 100 - i % 100 : i % 100;
+            num_label_flush_us = 0;
+            uint32_t t0 = num_label_us();
+            if (kind == 0)
+            {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "%d", (int)v);
+                lv_label_set_text(stock, buf);
+            }
+            else
+            {
+                num_label_set_int(fast, v);
+            }
+            px[kind] += num_label_pending_px();
+            lv_refr_now(NULL);
+            us[i] = num_label_us() - t0 - num_label_flush_us;
+            flush_total += num_label_flush_us;
+        }
+        qsort(us, NUM_LABEL_BENCH_UPDATES, sizeof(us[0]), num_label_cmp);
+        for (uint16_t i = 0; i < NUM_LABEL_BENCH_UPDATES * 99 / 100; i++)
+            total[kind] += us[i];
+        NUM_LABEL_PRINTF("BENCH,%s,%u,%u,%u,%u,%u\n", kind ? "label_cached" : "label_stock",
+                         (unsigned)NUM_LABEL_BENCH_UPDATES, (unsigned)us[NUM_LABEL_BENCH_UPDATES / 2],
+                         (unsigned)us[NUM_LABEL_BENCH_UPDATES * 99 / 100], (unsigned)(px[kind] / NUM_LABEL_BENCH_UPDATES),
+                         (unsigned)(flush_total / NUM_LABEL_BENCH_UPDATES));
+    }
+    disp->driver->flush_cb = num_label_flush_cb;
+
+    // the sum below p99, not p50: on a PC an update takes about a
+    // microsecond, the resolution of num_label_us(), and a preempted update
+    // must not decide the result
+    bool pass = total[1] < total[0] && px[1] < px[0] && !num_label_stats.fallback_draws;
+    NUM_LABEL_PRINTF("BENCH,label_cached,%u cached draws,%u fallback draws,%s\n",
+                     (unsigned)num_label_stats.cached_draws, (unsigned)num_label_stats.fallback_draws,
+                     pass ? "PASS" : "FAIL");
+
+    lv_scr_load(prev);
+    lv_obj_del(scr);
+    return pass;
+}
+
+#endif // _NUM_LABEL_H
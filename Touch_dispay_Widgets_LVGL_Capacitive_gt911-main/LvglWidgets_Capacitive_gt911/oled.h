@@ -0,0 +1,469 @@
+/*******************************************************************************
+ * SSD1306 128x64 I2C OLED driver with dirty-page tracking
+ * The frame buffer is 8 pages of 128 column bytes (1 bit per pixel, 8 pixels
+ * per byte vertically). Every draw call only marks the column span of a page
+ * dirty if the byte actually changed, and oled_update() sends just those spans
+ * instead of the whole 1 KB frame. Consecutive pages with (nearly) the same
+ * span are merged into one address window so each transfer is as long as the
+ * I2C buffer allows.
+ *
+ * Usage:
+ *   oled_init();                         // after touch_init(): shares its bus
+ *   oled_draw_text(0, 0, "42");
+ *   oled_update();                       // or oled_update_async()
+ *
+ * With oled_update_async() the transfer runs on a task; draw calls, the
+ * snapshot and oled_stats share one mutex, which is never held across I2C.
+ * A blocking oled_update() waits for an async transfer still on the bus.
+ *
+ * The panel sits on the GT911 I2C bus. Every write goes through the bus
+ * manager (i2c_bus.h) as a low priority transaction, so touch reads get in
+ * between the chunks. Without ARDUINO a mock bus decodes the traffic into
+ * oled_sim_gddram for host checks (host/oled_test.cpp).
+ ******************************************************************************/
+#ifndef _OLED_H
+#define _OLED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Panel size, as in ESP32/parameters.h */
+#ifndef SCREEN_WIDTH
+#define SCREEN_WIDTH 128
+#define SCREEN_HEIGHT 64
+#endif
+
+#define OLED_I2C_ADDR 0x3C
+#define OLED_PAGES (SCREEN_HEIGHT / 8)
+#define OLED_I2C_CHUNK 127   // payload bytes per write (Wire buffer minus control byte)
+#define OLED_MERGE_SLACK 8   // clean bytes worth resending to avoid a new address window
+
+// wire bytes of a whole-frame push: addressing command + chunked data writes
+#define OLED_FRAME_BYTES (OLED_PAGES * SCREEN_WIDTH)
+#define OLED_FULL_FRAME_BYTES (8 + OLED_FRAME_BYTES + 2 * ((OLED_FRAME_BYTES + OLED_I2C_CHUNK - 1) / OLED_I2C_CHUNK))
+
+typedef bool (*oled_bus_write_t)(uint8_t addr, const uint8_t *buf, size_t len);
+
+typedef struct
+{
+    uint32_t updates;        // oled_update() calls that sent something
+    uint32_t last_bytes;     // bytes on the wire for the last update (incl. address bytes)
+    uint32_t last_writes;    // I2C writes for the last update
+    uint32_t total_bytes;
+    uint32_t total_writes;
+} oled_stats_t;
+
+static uint8_t oled_buffer[OLED_PAGES][SCREEN_WIDTH];
+static int16_t oled_dirty_x0[OLED_PAGES]; // x0 > x1 means the page is clean
+static int16_t oled_dirty_x1[OLED_PAGES];
+static oled_stats_t oled_stats;
+
+/* 5x7 glyphs, column-major, LSB at the top */
+static const char oled_font_chars[] = " -.:%0123456789";
+static const uint8_t oled_font[][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, // ' '
+    {0x08, 0x08, 0x08, 0x08, 0x08}, // '-'
+    {0x00, 0x60, 0x60, 0x00, 0x00}, // '.'
+    {0x00, 0x36, 0x36, 0x00, 0x00}, // ':'
+    {0x23, 0x13, 0x08, 0x64, 0x62}, // '%'
+    {0x3E, 0x51, 0x49, 0x45, 0x3E}, // '0'
+    {0x00, 0x42, 0x7F, 0x40, 0x00}, // '1'
+    {0x42, 0x61, 0x51, 0x49, 0x46}, // '2'
+    {0x21, 0x41, 0x45, 0x4B, 0x31}, // '3'
+    {0x18, 0x14, 0x12, 0x7F, 0x10}, // '4'
+    {0x27, 0x45, 0x45, 0x45, 0x39}, // '5'
+    {0x3C, 0x4A, 0x49, 0x49, 0x30}, // '6'
+    {0x01, 0x71, 0x09, 0x05, 0x03}, // '7'
+    {0x36, 0x49, 0x49, 0x49, 0x36}, // '8'
+    {0x06, 0x49, 0x49, 0x29, 0x1E}, // '9'
+};
+
+/* Bus layer */
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "i2c_bus.h"
+
+static oled_bus_write_t oled_bus_write = i2c_bus_oled_write;
+
+/* Draws, the async snapshot and oled_stats; created by oled_init() */
+static SemaphoreHandle_t oled_mutex;
+#define OLED_LOCK()                                    \
+    do                                                 \
+    {                                                  \
+        if (oled_mutex)                                \
+            xSemaphoreTake(oled_mutex, portMAX_DELAY); \
+    } while (0)
+#define OLED_UNLOCK()                    \
+    do                                   \
+    {                                    \
+        if (oled_mutex)                  \
+            xSemaphoreGive(oled_mutex);  \
+    } while (0)
+
+#else
+#include <stdio.h>
+
+/* Mock bus: decodes column/page addressing so the panel RAM can be compared */
+static uint8_t oled_sim_gddram[OLED_PAGES][SCREEN_WIDTH];
+static uint8_t oled_sim_col0, oled_sim_col1 = SCREEN_WIDTH - 1, oled_sim_page0, oled_sim_page1 = OLED_PAGES - 1;
+static uint8_t oled_sim_col, oled_sim_page;
+
+static bool oled_sim_write(uint8_t addr, const uint8_t *buf, size_t len)
+{
+    (void)addr;
+    if (buf[0] == 0x40)
+    {
+        for (size_t i = 1; i < len; i++)
+        {
+            oled_sim_gddram[oled_sim_page][oled_sim_col] = buf[i];
+            if (oled_sim_col++ == oled_sim_col1)
+            {
+                oled_sim_col = oled_sim_col0;
+                oled_sim_page = (oled_sim_page == oled_sim_page1) ? oled_sim_page0 : oled_sim_page + 1;
+            }
+        }
+        return true;
+    }
+    for (size_t i = 1; i < len; i++)
+    {
+        if (buf[i] == 0x21 && i + 2 < len)
+        {
+            oled_sim_col = oled_sim_col0 = buf[i + 1];
+            oled_sim_col1 = buf[i + 2];
+            i += 2;
+        }
+        else if (buf[i] == 0x22 && i + 2 < len)
+        {
+            oled_sim_page = oled_sim_page0 = buf[i + 1];
+            oled_sim_page1 = buf[i + 2];
+            i += 2;
+        }
+    }
+    return true;
+}
+static oled_bus_write_t oled_bus_write = oled_sim_write;
+
+#define OLED_LOCK()
+#define OLED_UNLOCK()
+#endif
+
+/* Wire traffic of the flush in progress; published to oled_stats when done */
+static uint32_t oled_tx_bytes, oled_tx_writes;
+
+static bool oled_send(const uint8_t *buf, size_t len)
+{
+    oled_tx_bytes += len + 1; // + address byte
+    oled_tx_writes++;
+    return oled_bus_write(OLED_I2C_ADDR, buf, len);
+}
+
+static bool oled_command(const uint8_t *cmds, size_t n)
+{
+    uint8_t buf[8];
+    buf[0] = 0x00; // Co = 0, D/C = 0: command stream
+    memcpy(&buf[1], cmds, n);
+    return oled_send(buf, n + 1);
+}
+
+/* Drawing */
+static inline void oled_mark(uint8_t page, int16_t x)
+{
+    if (x < oled_dirty_x0[page])
+        oled_dirty_x0[page] = x;
+    if (x > oled_dirty_x1[page])
+        oled_dirty_x1[page] = x;
+}
+
+static inline void oled_set_byte(uint8_t page, int16_t x, uint8_t value)
+{
+    if (oled_buffer[page][x] != value)
+    {
+        oled_buffer[page][x] = value;
+        oled_mark(page, x);
+    }
+}
+
+static void oled_set_pixel(int16_t x, int16_t y, bool on)
+{
+    if (x < 0 || x >= SCREEN_WIDTH || y < 0 || y >= SCREEN_HEIGHT)
+        return;
+    uint8_t page = y >> 3;
+    uint8_t bit = 1 << (y & 7);
+    oled_set_byte(page, x, on ? (oled_buffer[page][x] | bit) : (oled_buffer[page][x] & ~bit));
+}
+
+void oled_draw_pixel(int16_t x, int16_t y, bool on)
+{
+    OLED_LOCK();
+    oled_set_pixel(x, y, on);
+    OLED_UNLOCK();
+}
+
+void oled_fill_rect(int16_t x, int16_t y, int16_t w, int16_t h, bool on)
+{
+    OLED_LOCK();
+    for (int16_t j = y; j < y + h; j++)
+        for (int16_t i = x; i < x + w; i++)
+            oled_set_pixel(i, j, on);
+    OLED_UNLOCK();
+}
+
+void oled_clear()
+{
+    OLED_LOCK();
+    for (uint8_t p = 0; p < OLED_PAGES; p++)
+        for (int16_t x = 0; x < SCREEN_WIDTH; x++)
+            oled_set_byte(p, x, 0);
+    OLED_UNLOCK();
+}
+
+/* Text on 8-pixel page rows: each glyph is 6 columns wide (5 + spacing) */
+void oled_draw_text(int16_t x, uint8_t page, const char *text)
+{
+    if (page >= OLED_PAGES)
+        return;
+    OLED_LOCK();
+    for (; *text && x < SCREEN_WIDTH; text++)
+    {
+        const char *f = strchr(oled_font_chars, *text);
+        const uint8_t *glyph = oled_font[f ? (f - oled_font_chars) : 0];
+        for (uint8_t i = 0; i < 6 && x < SCREEN_WIDTH; i++, x++)
+        {
+            if (x >= 0)
+                oled_set_byte(page, x, i < 5 ? glyph[i] : 0);
+        }
+    }
+    OLED_UNLOCK();
+}
+
+/* Flush */
+static void oled_send_window(uint8_t p0, uint8_t p1, int16_t x0, int16_t x1, uint8_t frame[][SCREEN_WIDTH])
+{
+    const uint8_t addr[] = {0x21, (uint8_t)x0, (uint8_t)x1, 0x22, p0, p1};
+    oled_command(addr, sizeof(addr));
+
+    uint8_t buf[OLED_I2C_CHUNK + 1];
+    size_t n = 0;
+    buf[0] = 0x40; // data stream
+    for (uint8_t p = p0; p <= p1; p++)
+    {
+        for (int16_t x = x0; x <= x1; x++)
+        {
+            buf[1 + n++] = frame[p][x];
+            if (n == OLED_I2C_CHUNK)
+            {
+                oled_send(buf, n + 1);
+                n = 0;
+            }
+        }
+    }
+    if (n)
+        oled_send(buf, n + 1);
+}
+
+/* Sends the dirty spans of frame[] given per-page ranges; returns wire bytes */
+static uint32_t oled_flush(uint8_t frame[][SCREEN_WIDTH], const int16_t *dx0, const int16_t *dx1)
+{
+    oled_tx_bytes = 0;
+    oled_tx_writes = 0;
+
+    uint8_t p = 0;
+    while (p < OLED_PAGES)
+    {
+        if (dx0[p] > dx1[p])
+        {
+            p++;
+            continue;
+        }
+        // grow the window downwards while the union costs less than a new window
+        uint8_t p1 = p;
+        int16_t x0 = dx0[p], x1 = dx1[p];
+        while (p1 + 1 < OLED_PAGES && dx0[p1 + 1] <= dx1[p1 + 1])
+        {
+            int16_t ux0 = dx0[p1 + 1] < x0 ? dx0[p1 + 1] : x0;
+            int16_t ux1 = dx1[p1 + 1] > x1 ? dx1[p1 + 1] : x1;
+            int32_t merged = (int32_t)(p1 - p + 2) * (ux1 - ux0 + 1);
+            int32_t separate = (int32_t)(p1 - p + 1) * (x1 - x0 + 1) + (dx1[p1 + 1] - dx0[p1 + 1] + 1);
+            if (merged - separate > OLED_MERGE_SLACK)
+                break;
+            x0 = ux0;
+            x1 = ux1;
+            p1++;
+        }
+        oled_send_window(p, p1, x0, x1, frame);
+        p = p1 + 1;
+    }
+
+    uint32_t bytes = oled_tx_bytes;
+    if (oled_tx_writes)
+    {
+        OLED_LOCK();
+        oled_stats.updates++;
+        oled_stats.last_bytes = oled_tx_bytes;
+        oled_stats.last_writes = oled_tx_writes;
+        oled_stats.total_bytes += oled_tx_bytes;
+        oled_stats.total_writes += oled_tx_writes;
+        OLED_UNLOCK();
+    }
+    return bytes;
+}
+
+static void oled_mark_clean()
+{
+    for (uint8_t p = 0; p < OLED_PAGES; p++)
+    {
+        oled_dirty_x0[p] = SCREEN_WIDTH;
+        oled_dirty_x1[p] = -1;
+    }
+}
+
+/* One flush on the bus at a time: set under the lock by whichever update
+   claims it, so the oled_tx_* counters have a single writer */
+static volatile bool oled_busy = false;
+
+#ifdef ARDUINO
+/* Asynchronous update: the dirty spans are snapshotted and sent by a task */
+static TaskHandle_t oled_task_handle;
+static uint8_t oled_shadow[OLED_PAGES][SCREEN_WIDTH];
+static int16_t oled_shadow_x0[OLED_PAGES], oled_shadow_x1[OLED_PAGES];
+#endif
+
+/* Blocking update: returns the number of bytes put on the bus */
+uint32_t oled_update()
+{
+    // flushed from a snapshot so the lock is not held across I2C
+    static uint8_t frame[OLED_PAGES][SCREEN_WIDTH];
+    int16_t x0[OLED_PAGES], x1[OLED_PAGES];
+    for (;;)
+    {
+        OLED_LOCK();
+        if (!oled_busy)
+            break;
+        OLED_UNLOCK();
+#ifdef ARDUINO
+        vTaskDelay(1); // an async update is on the bus
+#endif
+    }
+    oled_busy = true;
+    memcpy(frame, oled_buffer, sizeof(frame));
+    memcpy(x0, oled_dirty_x0, sizeof(x0));
+    memcpy(x1, oled_dirty_x1, sizeof(x1));
+    oled_mark_clean();
+    OLED_UNLOCK();
+    uint32_t bytes = oled_flush(frame, x0, x1);
+    oled_busy = false;
+    return bytes;
+}
+
+#ifdef ARDUINO
+static void oled_task(void *)
+{
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        oled_flush(oled_shadow, oled_shadow_x0, oled_shadow_x1);
+        oled_busy = false;
+    }
+}
+
+/* Returns false if the previous async update is still on the bus */
+bool oled_update_async()
+{
+    OLED_LOCK();
+    if (oled_busy)
+    {
+        OLED_UNLOCK();
+        return false;
+    }
+    bool dirty = false;
+    for (uint8_t p = 0; p < OLED_PAGES; p++)
+        dirty |= oled_dirty_x0[p] <= oled_dirty_x1[p];
+    if (!dirty)
+    {
+        OLED_UNLOCK();
+        return true;
+    }
+    // whole frame: merged windows may resend clean bytes next to dirty ones
+    memcpy(oled_shadow, oled_buffer, sizeof(oled_shadow));
+    memcpy(oled_shadow_x0, oled_dirty_x0, sizeof(oled_shadow_x0));
+    memcpy(oled_shadow_x1, oled_dirty_x1, sizeof(oled_shadow_x1));
+    oled_mark_clean();
+    oled_busy = true;
+    OLED_UNLOCK();
+    xTaskNotifyGive(oled_task_handle);
+    return true;
+}
+#endif
+
+bool oled_init()
+{
+    static const uint8_t init_seq[][3] = {
+        {0xAE},             // display off
+        {0xD5, 0x80},       // clock divide
+        {0xA8, SCREEN_HEIGHT - 1},
+        {0xD3, 0x00},       // display offset
+        {0x40},             // start line 0
+        {0x8D, 0x14},       // charge pump on
+        {0x20, 0x00},       // horizontal addressing: windows wrap page by page
+        {0xA1},             // segment remap
+        {0xC8},             // COM scan descending
+        {0xDA, 0x12},       // COM pins
+        {0x81, 0xCF},       // contrast
+        {0xD9, 0xF1},       // precharge
+        {0xDB, 0x40},       // VCOMH
+        {0xA4},             // resume from RAM
+        {0xA6},             // normal (not inverted)
+        {0xAF}};            // display on
+    static const uint8_t init_len[] = {1, 2, 2, 2, 1, 2, 2, 1, 1, 2, 2, 2, 2, 1, 1, 1};
+
+#ifdef ARDUINO
+    if (!oled_mutex)
+        oled_mutex = xSemaphoreCreateMutex();
+#endif
+
+    for (uint8_t i = 0; i < sizeof(init_len); i++)
+    {
+        if (!oled_command(init_seq[i], init_len[i]))
+            return false;
+    }
+
+    // panel RAM content is undefined at power up: push one full frame
+    memset(oled_buffer, 0, sizeof(oled_buffer));
+    for (uint8_t p = 0; p < OLED_PAGES; p++)
+    {
+        oled_dirty_x0[p] = 0;
+        oled_dirty_x1[p] = SCREEN_WIDTH - 1;
+    }
+    oled_update();
+
+#ifdef ARDUINO
+    if (!oled_task_handle)
+        xTaskCreate(oled_task, "oled", 2048, NULL, 1, &oled_task_handle);
+#endif
+    return true;
+}
+
+/* Consistent copy of the counters, the async task may be updating them */
+oled_stats_t oled_get_stats()
+{
+    OLED_LOCK();
+    oled_stats_t s = oled_stats;
+    OLED_UNLOCK();
+    return s;
+}
+
+void oled_print_stats()
+{
+    oled_stats_t s = oled_get_stats();
+#ifdef ARDUINO
+    Serial.printf(
+#else
+    printf(
+#endif
+        "oled: updates %u, last %u bytes in %u writes, total %u bytes (full frame %u)\n",
+        (unsigned)s.updates, (unsigned)s.last_bytes, (unsigned)s.last_writes,
+        (unsigned)s.total_bytes, (unsigned)OLED_FULL_FRAME_BYTES);
+}
+
+#endif // _OLED_H
@@ -0,0 +1,278 @@
+/*******************************************************************************
+ * Activity governor: adaptive refresh and idle power mode
+ * With no input for GOV_IDLE_MS the display refresh and touch read timers are
+ * slowed down and the backlight is dimmed; after GOV_DOZE_MS they slow down
+ * further. Touch, key or audio activity snaps everything back to the lv_conf.h
+ * rates (15 ms refresh, 30 ms touch read) at once.
+ *
+ * Usage:
+ *   governor_begin(touch_indev, set_backlight);
+ *   loop(): governor_wait(lv_timer_handler());
+ *   input:  governor_activity(GOV_SRC_TOUCH, event_ms);
+ *   keys:   while (keypad_get_event(&ev)) governor_activity(GOV_SRC_KEY, ev.time_ms);
+ *
+ * event_ms is when the input really happened: the GT911 interrupt edge, or
+ * for a polled panel the last read that still saw no contact (touch.h), so
+ * the reported wake-up latency is the real one or its upper bound. Keypad
+ * events (ESP32/keypad.h) carry the debounced press time, ~5 ms after the
+ * contact; polled from loop(), they wait at most one governor_wait().
+ *
+ * Between LVGL deadlines the loop task blocks in delay(). governor_begin()
+ * configures esp_pm frequency scaling with an 80 MHz floor, so the idle CPU
+ * clocks down while LEDC, UART, SPI and the core-0 tasks keep running. With
+ * GOV_LIGHT_SLEEP=1 (needs tickless idle in the sdkconfig) IDF also enters
+ * light sleep on its own when both cores are idle; the governor holds an
+ * ESP_PM_NO_LIGHT_SLEEP lock unless the profile allows sleep and the backlight
+ * is off, since light sleep stops the APB clock that LEDC dims the backlight
+ * with. Serial output waits while the chip sleeps.
+ *
+ * Wakeups per second, CPU duty, a modeled energy figure and the inputs that
+ * ended IDLE or DOZE are reported as
+ *   GOV,<state>,<wakeups/s>,<duty %>,<mJ>,<wake latency max ms>,<touch wakes>,<audio wakes>,<key wakes>
+ * Without ARDUINO waiting only advances a virtual clock; host/governor_sim.cpp
+ * checks the wake-up latency of each state on it.
+ ******************************************************************************/
+#ifndef _POWER_GOVERNOR_H
+#define _POWER_GOVERNOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <lvgl.h>
+
+#define GOV_IDLE_MS 10000          // no activity -> IDLE
+#define GOV_DOZE_MS 60000          // no activity -> DOZE
+#define GOV_MIN_SLEEP_MS 4         // shorter waits are not worth a light sleep
+#define GOV_REPORT_MS 10000
+#define GOV_PM_MIN_MHZ 80          // keeps APB at 80 MHz for LEDC, UART and SPI
+
+#ifndef GOV_LIGHT_SLEEP
+#define GOV_LIGHT_SLEEP 0
+#endif
+
+/* Energy model (3.3 V rail): CPU awake, idle at full clock, idle at GOV_PM_MIN_MHZ,
+   light sleep, backlight at 255 */
+#define GOV_VOLTS 3.3f
+#define GOV_MA_RUN 50.0f
+#define GOV_MA_IDLE 20.0f
+#define GOV_MA_IDLE_PM 12.0f
+#define GOV_MA_SLEEP 0.8f
+#define GOV_MA_BACKLIGHT 40.0f
+
+enum gov_state_t
+{
+    GOV_ACTIVE,
+    GOV_IDLE,
+    GOV_DOZE
+};
+
+enum gov_source_t
+{
+    GOV_SRC_TOUCH,
+    GOV_SRC_AUDIO,
+    GOV_SRC_KEY,
+    GOV_SOURCES
+};
+
+typedef struct
+{
+    uint16_t refr_ms;
+    uint16_t indev_ms;  // also the worst-case touch and key wake-up latency
+    uint8_t backlight;
+    bool light_sleep;   // may light sleep between deadlines (GOV_LIGHT_SLEEP)
+} gov_profile_t;
+
+static const gov_profile_t gov_profiles[] = {
+    {LV_DISP_DEF_REFR_PERIOD, LV_INDEV_DEF_READ_PERIOD, 255, false}, // ACTIVE
+    {50, 60, 96, true},                                              // IDLE
+    {200, 100, GOV_LIGHT_SLEEP ? 0 : 24, true},                      // DOZE: dark if it may sleep
+};
+
+typedef struct
+{
+    uint32_t wakeups;
+    uint32_t busy_us;
+    uint32_t idle_us;      // waited with light sleep held off
+    uint32_t sleep_us;     // waited with light sleep allowed
+    float energy_mj;
+    uint32_t wake_latency_max_ms;
+    uint32_t wakes[GOV_SOURCES]; // activity that ended IDLE or DOZE, by source
+    uint32_t window_start_ms;
+} gov_stats_t;
+
+/* Platform layer */
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <esp_pm.h>
+static inline uint32_t gov_now_ms() { return millis(); }
+static inline uint32_t gov_now_us() { return micros(); }
+static bool gov_pm_on = false;             // esp_pm_configure() accepted the config
+#if CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t gov_pm_lock = NULL;
+static bool gov_pm_locked = false;
+#endif
+
+static void gov_pm_begin()
+{
+#if CONFIG_PM_ENABLE
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_pm_config_t cfg = {};
+#else
+    esp_pm_config_esp32_t cfg = {};
+#endif
+    cfg.max_freq_mhz = getCpuFrequencyMhz();
+    cfg.min_freq_mhz = GOV_PM_MIN_MHZ;
+    cfg.light_sleep_enable = GOV_LIGHT_SLEEP;
+    gov_pm_on = esp_pm_configure(&cfg) == ESP_OK;
+    if (gov_pm_on && esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "gov", &gov_pm_lock) == ESP_OK)
+    {
+        esp_pm_lock_acquire(gov_pm_lock);
+        gov_pm_locked = true;
+    }
+#endif
+}
+
+/* Releases the no-light-sleep lock only while sleeping is allowed */
+static void gov_pm_allow_sleep(bool allow)
+{
+#if CONFIG_PM_ENABLE
+    if (!gov_pm_lock || allow != gov_pm_locked)
+        return;
+    if (allow)
+        esp_pm_lock_release(gov_pm_lock);
+    else
+        esp_pm_lock_acquire(gov_pm_lock);
+    gov_pm_locked = !allow;
+#else
+    (void)allow;
+#endif
+}
+
+/* Blocks the loop task; the idle hook scales the clock or sleeps */
+static void gov_sleep(uint32_t ms) { delay(ms); }
+#define GOV_PRINTF Serial.printf
+#else
+#include <stdio.h>
+static uint64_t gov_sim_time_us = 0;
+static bool gov_pm_on = true;
+static bool gov_sim_sleep_allowed = false;
+static inline uint32_t gov_now_ms() { return (uint32_t)(gov_sim_time_us / 1000); }
+static inline uint32_t gov_now_us() { return (uint32_t)gov_sim_time_us; }
+static void gov_pm_begin() {}
+static void gov_pm_allow_sleep(bool allow) { gov_sim_sleep_allowed = allow; }
+static void gov_sleep(uint32_t ms) { gov_sim_time_us += (uint64_t)ms * 1000; }
+#define GOV_PRINTF printf
+#endif
+
+static uint8_t gov_state = GOV_ACTIVE;
+static uint32_t gov_last_activity_ms = 0;
+static uint32_t gov_wake_us = 0;           // end of the last wait
+static lv_indev_t *gov_indev = NULL;
+static void (*gov_set_backlight)(uint8_t level) = NULL;
+static gov_stats_t gov_stats;
+
+/* Light sleep stops the APB clock, so LEDC could not hold a dimmed backlight */
+static inline bool gov_may_sleep(const gov_profile_t *p)
+{
+    return GOV_LIGHT_SLEEP && p->light_sleep && p->backlight == 0;
+}
+
+static void gov_apply(uint8_t state)
+{
+    gov_state = state;
+    const gov_profile_t *p = &gov_profiles[state];
+    lv_disp_t *disp = lv_disp_get_default();
+    if (disp && disp->refr_timer)
+        lv_timer_set_period(disp->refr_timer, p->refr_ms);
+    if (gov_indev)
+        lv_timer_set_period(lv_indev_get_read_timer(gov_indev), p->indev_ms);
+    if (gov_set_backlight)
+        gov_set_backlight(p->backlight);
+}
+
+void governor_begin(lv_indev_t *indev, void (*set_backlight)(uint8_t level))
+{
+    gov_indev = indev;
+    gov_set_backlight = set_backlight;
+    gov_pm_begin();
+    gov_last_activity_ms = gov_now_ms();
+    gov_stats.window_start_ms = gov_last_activity_ms;
+    gov_wake_us = gov_now_us();
+    gov_apply(GOV_ACTIVE);
+}
+
+/* Input seen; event_ms is when it happened, see the top of the file */
+void governor_activity(uint8_t source, uint32_t event_ms)
+{
+    uint32_t now = gov_now_ms();
+    if (gov_state != GOV_ACTIVE)
+    {
+        if (source < GOV_SOURCES)
+            gov_stats.wakes[source]++;
+        if ((int32_t)(now - event_ms) > 0 && now - event_ms > gov_stats.wake_latency_max_ms)
+            gov_stats.wake_latency_max_ms = now - event_ms;
+        gov_apply(GOV_ACTIVE);
+        // the next frame should show the reaction right away, not one idle period later
+        lv_disp_t *disp = lv_disp_get_default();
+        if (disp && disp->refr_timer)
+            lv_timer_ready(disp->refr_timer);
+    }
+    gov_last_activity_ms = now;
+}
+
+void governor_print_stats()
+{
+    static const char *names[] = {"active", "idle", "doze"};
+    uint32_t window_ms = gov_now_ms() - gov_stats.window_start_ms;
+    uint32_t total_us = gov_stats.busy_us + gov_stats.idle_us + gov_stats.sleep_us;
+    GOV_PRINTF("GOV,%s,%u,%u,%u,%u,%u,%u,%u\n", names[gov_state],
+               (unsigned)(window_ms ? gov_stats.wakeups * 1000 / window_ms : 0),
+               (unsigned)(total_us ? (uint64_t)gov_stats.busy_us * 100 / total_us : 0),
+               (unsigned)gov_stats.energy_mj, (unsigned)gov_stats.wake_latency_max_ms,
+               (unsigned)gov_stats.wakes[GOV_SRC_TOUCH], (unsigned)gov_stats.wakes[GOV_SRC_AUDIO],
+               (unsigned)gov_stats.wakes[GOV_SRC_KEY]);
+    uint32_t latency = gov_stats.wake_latency_max_ms;
+    gov_stats = gov_stats_t();
+    gov_stats.wake_latency_max_ms = latency;
+    gov_stats.window_start_ms = gov_now_ms();
+}
+
+/* Replaces delay() in loop(): next_ms is what lv_timer_handler() returned */
+void governor_wait(uint32_t next_ms)
+{
+    uint32_t now = gov_now_ms();
+    uint32_t quiet = now - gov_last_activity_ms;
+    uint8_t want = quiet >= GOV_DOZE_MS ? GOV_DOZE : quiet >= GOV_IDLE_MS ? GOV_IDLE : GOV_ACTIVE;
+    if (want != gov_state)
+        gov_apply(want);
+
+    const gov_profile_t *p = &gov_profiles[gov_state];
+    if (next_ms > p->indev_ms)
+        next_ms = p->indev_ms;
+    if (gov_state == GOV_ACTIVE && next_ms > 5)
+        next_ms = 5; // the old delay(5) cadence keeps serial protocols responsive
+    bool light_sleep = gov_may_sleep(p) && next_ms >= GOV_MIN_SLEEP_MS;
+    gov_pm_allow_sleep(light_sleep);
+
+    // account for the time awake since the last wait, then for this wait
+    uint32_t start_us = gov_now_us();
+    uint32_t busy_us = start_us - gov_wake_us;
+    gov_sleep(next_ms);
+    gov_wake_us = gov_now_us();
+    uint32_t wait_us = gov_wake_us - start_us;
+
+    float backlight_ma = GOV_MA_BACKLIGHT * p->backlight / 255.0f;
+    float wait_ma = light_sleep ? GOV_MA_SLEEP : gov_pm_on ? GOV_MA_IDLE_PM : GOV_MA_IDLE;
+    gov_stats.wakeups++;
+    gov_stats.busy_us += busy_us;
+    gov_stats.energy_mj += GOV_VOLTS * ((GOV_MA_RUN + backlight_ma) * busy_us +
+                                        (wait_ma + backlight_ma) * wait_us) / 1e6f;
+    if (light_sleep)
+        gov_stats.sleep_us += wait_us;
+    else
+        gov_stats.idle_us += wait_us;
+
+    if (gov_now_ms() - gov_stats.window_start_ms >= GOV_REPORT_MS)
+        governor_print_stats();
+}
+
+#endif // _POWER_GOVERNOR_H
@@ -0,0 +1,353 @@
+/*******************************************************************************
+ * Binary delta-sync protocol between the firmware and the Flutter app
+ * The device keeps a small table of UI state fields (active tab, slider
+ * values) and mirrors it to the app. Only fields that changed since the last
+ * message are sent, as varint-encoded (field, value) pairs, and a full
+ * snapshot goes out periodically so a peer that joined late or lost a frame
+ * resynchronises. Button presses are one-shot events.
+ *
+ * Frame:  A5 | version | type | seq (varint) | len (varint) | payload | crc8
+ * STATE payload:  { field (varint), value (zigzag varint) } ...
+ * EVENT payload:  { event id (varint) }
+ *
+ * On the wire a frame is wrapped in SOF (C0) ... EOF (C1), with any C0, C1
+ * or DB (ESC) inside sent as ESC, byte ^ 0x20. The log lines are plain ASCII
+ * and never contain those bytes, so BOOT/GOV/LAT/... lines can share the
+ * Serial port: a receiver treats everything outside SOF...EOF as text, and a
+ * lost byte costs at most the frame it belonged to.
+ *
+ * The transport is a single write function (Serial, a WiFiClient, a BLE
+ * characteristic). sync_peer_feed() is the reference receiver; it is plain
+ * C++ and builds on the host as well (host/sync_fuzz.cpp).
+ ******************************************************************************/
+#ifndef _SYNC_H
+#define _SYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#define SYNC_MAGIC 0xA5
+#define SYNC_VERSION 1
+#define SYNC_MAX_PAYLOAD 96
+#define SYNC_MAX_FRAME (SYNC_MAX_PAYLOAD + 12)
+#define SYNC_MAX_WIRE (2 * SYNC_MAX_FRAME + 2) // every byte escaped, plus SOF/EOF
+#define SYNC_SOF 0xC0
+#define SYNC_EOF 0xC1
+#define SYNC_ESC 0xDB
+#define SYNC_MIN_INTERVAL_MS 20   // coalesce slider drags into one delta per interval
+#define SYNC_SNAPSHOT_MS 2000     // full state at least this often
+
+/* State table */
+#define SYNC_TABS 2
+#define SYNC_SLIDERS_PER_TAB 2
+#define SYNC_FIELD_TAB 0
+#define SYNC_FIELD_SLIDER(tab, i) (1 + (tab) * SYNC_SLIDERS_PER_TAB + (i))
+#define SYNC_FIELDS (1 + SYNC_TABS * SYNC_SLIDERS_PER_TAB)
+
+#define SYNC_EVENT_BUTTON(tab, i) ((tab) * 2 + (i))
+
+enum sync_msg_type_t
+{
+    SYNC_MSG_SNAPSHOT = 1,
+    SYNC_MSG_DELTA = 2,
+    SYNC_MSG_EVENT = 3
+};
+
+typedef size_t (*sync_write_t)(const uint8_t *buf, size_t len);
+
+typedef struct
+{
+    uint32_t frames;
+    uint32_t bytes;
+    uint32_t snapshots;
+} sync_stats_t;
+
+/* Encoding helpers */
+static inline size_t sync_put_varint(uint8_t *p, uint32_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80)
+    {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+/* Returns bytes consumed, 0 if truncated or longer than 5 bytes */
+static inline size_t sync_get_varint(const uint8_t *p, size_t len, uint32_t *v)
+{
+    uint32_t r = 0;
+    for (size_t n = 0; n < len && n < 5; n++)
+    {
+        r |= (uint32_t)(p[n] & 0x7F) << (7 * n);
+        if (!(p[n] & 0x80))
+        {
+            *v = r;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+static inline uint32_t sync_zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+static inline int32_t sync_unzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+static uint8_t sync_crc8(const uint8_t *p, size_t len)
+{
+    uint8_t crc = 0;
+    while (len--)
+    {
+        crc ^= *p++;
+        for (uint8_t i = 0; i < 8; i++)
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+/* Builds a frame into out[SYNC_MAX_FRAME]; returns its length */
+static size_t sync_build_frame(uint8_t *out, uint8_t type, uint32_t seq, const uint8_t *payload, size_t len)
+{
+    size_t n = 0;
+    out[n++] = SYNC_MAGIC;
+    out[n++] = SYNC_VERSION;
+    out[n++] = type;
+    n += sync_put_varint(&out[n], seq);
+    n += sync_put_varint(&out[n], (uint32_t)len);
+    memcpy(&out[n], payload, len);
+    n += len;
+    out[n] = sync_crc8(&out[1], n - 1);
+    return n + 1;
+}
+
+/* Wraps a frame in SOF/EOF and escapes it into out[SYNC_MAX_WIRE]; returns the wire length */
+static size_t sync_escape(uint8_t *out, const uint8_t *frame, size_t len)
+{
+    size_t n = 0;
+    out[n++] = SYNC_SOF;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (frame[i] == SYNC_SOF || frame[i] == SYNC_EOF || frame[i] == SYNC_ESC)
+        {
+            out[n++] = SYNC_ESC;
+            out[n++] = frame[i] ^ 0x20;
+        }
+        else
+        {
+            out[n++] = frame[i];
+        }
+    }
+    out[n++] = SYNC_EOF;
+    return n;
+}
+
+/* Sender */
+static int32_t sync_values[SYNC_FIELDS];
+static int32_t sync_sent[SYNC_FIELDS];
+static uint32_t sync_seq = 0;
+static uint32_t sync_last_send_ms = 0;
+static uint32_t sync_last_snapshot_ms = 0;
+static bool sync_pending_snapshot = true;
+static sync_write_t sync_transport = NULL;
+static sync_stats_t sync_stats;
+
+void sync_begin(sync_write_t transport)
+{
+    sync_transport = transport;
+    sync_pending_snapshot = true;
+}
+
+void sync_set(uint8_t field, int32_t value)
+{
+    if (field < SYNC_FIELDS)
+        sync_values[field] = value;
+}
+
+static void sync_send(uint8_t type, const uint8_t *payload, size_t len)
+{
+    uint8_t frame[SYNC_MAX_FRAME], wire[SYNC_MAX_WIRE];
+    size_t n = sync_escape(wire, frame, sync_build_frame(frame, type, sync_seq++, payload, len));
+    if (sync_transport)
+        sync_transport(wire, n);
+    sync_stats.frames++;
+    sync_stats.bytes += n;
+}
+
+/* Events bypass the delta table and go out immediately */
+void sync_event(uint32_t id)
+{
+    uint8_t payload[5];
+    sync_send(SYNC_MSG_EVENT, payload, sync_put_varint(payload, id));
+}
+
+/* Call from loop(): sends a delta of changed fields, or a periodic snapshot */
+void sync_poll(uint32_t now_ms)
+{
+    if (now_ms - sync_last_snapshot_ms >= SYNC_SNAPSHOT_MS)
+        sync_pending_snapshot = true;
+    if (!sync_pending_snapshot && now_ms - sync_last_send_ms < SYNC_MIN_INTERVAL_MS)
+        return;
+
+    uint8_t payload[SYNC_MAX_PAYLOAD];
+    size_t n = 0;
+    for (uint8_t f = 0; f < SYNC_FIELDS; f++)
+    {
+        if (sync_pending_snapshot || sync_values[f] != sync_sent[f])
+        {
+            n += sync_put_varint(&payload[n], f);
+            n += sync_put_varint(&payload[n], sync_zigzag(sync_values[f]));
+            sync_sent[f] = sync_values[f];
+        }
+    }
+    if (sync_pending_snapshot)
+    {
+        sync_send(SYNC_MSG_SNAPSHOT, payload, n);
+        sync_stats.snapshots++;
+        sync_last_snapshot_ms = now_ms;
+        sync_pending_snapshot = false;
+    }
+    else if (n)
+    {
+        sync_send(SYNC_MSG_DELTA, payload, n);
+    }
+    else
+    {
+        return;
+    }
+    sync_last_send_ms = now_ms;
+}
+
+const sync_stats_t *sync_get_stats() { return &sync_stats; }
+
+/* Reference receiver: feed it bytes from any transport */
+typedef void (*sync_event_cb_t)(uint32_t id);
+
+typedef struct
+{
+    int32_t values[SYNC_FIELDS];
+    bool synced;          // false until the first snapshot and after any sequence gap
+    uint32_t next_seq;
+    uint32_t frames;
+    uint32_t lost;        // frames skipped according to the sequence numbers
+    uint32_t errors;      // bad framing, CRC, version or payload
+    sync_event_cb_t on_event;
+    uint8_t buf[SYNC_MAX_FRAME];
+    size_t len;
+    bool in_frame;        // between SOF and EOF
+    bool escaped;         // last byte was ESC
+} sync_peer_t;
+
+void sync_peer_init(sync_peer_t *peer, sync_event_cb_t on_event)
+{
+    memset(peer, 0, sizeof(*peer));
+    peer->on_event = on_event;
+}
+
+static bool sync_peer_apply(sync_peer_t *peer, uint8_t type, const uint8_t *p, size_t len)
+{
+    if (type == SYNC_MSG_EVENT)
+    {
+        uint32_t id;
+        if (!sync_get_varint(p, len, &id))
+            return false;
+        if (peer->on_event)
+            peer->on_event(id);
+        return true;
+    }
+    if (type != SYNC_MSG_SNAPSHOT && type != SYNC_MSG_DELTA)
+        return false;
+
+    // validate the whole payload before touching the mirror
+    for (int pass = 0; pass < 2; pass++)
+    {
+        size_t i = 0;
+        while (i < len)
+        {
+            uint32_t field, value;
+            size_t a = sync_get_varint(&p[i], len - i, &field);
+            size_t b = a ? sync_get_varint(&p[i + a], len - i - a, &value) : 0;
+            if (!b || field >= SYNC_FIELDS)
+                return false;
+            if (pass)
+                peer->values[field] = sync_unzigzag(value);
+            i += a + b;
+        }
+    }
+    return true;
+}
+
+/* A complete, unescaped frame from between SOF and EOF */
+static bool sync_peer_frame(sync_peer_t *peer, const uint8_t *b, size_t n)
+{
+    uint32_t seq, len;
+    size_t hdr = 3;
+    if (n < hdr + 3 || b[0] != SYNC_MAGIC || b[1] != SYNC_VERSION)
+        return false;
+    size_t a = sync_get_varint(&b[hdr], n - hdr, &seq);
+    size_t c = a ? sync_get_varint(&b[hdr + a], n - hdr - a, &len) : 0;
+    if (!c)
+        return false;
+    hdr += a + c;
+    if (n != hdr + len + 1 || sync_crc8(&b[1], hdr + len - 1) != b[hdr + len])
+        return false;
+    if (!sync_peer_apply(peer, b[2], &b[hdr], len))
+        return false;
+
+    if (peer->frames && seq != peer->next_seq)
+        peer->lost += seq - peer->next_seq;
+    // after any gap only a snapshot brings the mirror back: a lost delta
+    // stays missing whatever kind of frame arrives next
+    if (b[2] == SYNC_MSG_SNAPSHOT)
+        peer->synced = true;
+    else if (peer->frames && seq != peer->next_seq)
+        peer->synced = false;
+    peer->next_seq = seq + 1;
+    peer->frames++;
+    return true;
+}
+
+/* Returns true when a complete, valid frame was applied. Bytes outside
+ * SOF...EOF are text lines from the same port and are ignored */
+bool sync_peer_feed(sync_peer_t *peer, uint8_t byte)
+{
+    if (byte == SYNC_SOF)
+    {
+        if (peer->in_frame)
+            peer->errors++; // EOF lost: drop the unfinished frame
+        peer->in_frame = true;
+        peer->escaped = false;
+        peer->len = 0;
+        return false;
+    }
+    if (!peer->in_frame)
+        return false;
+    if (byte == SYNC_EOF)
+    {
+        peer->in_frame = false;
+        if (peer->escaped || !sync_peer_frame(peer, peer->buf, peer->len))
+        {
+            peer->errors++;
+            return false;
+        }
+        return true;
+    }
+    if (byte == SYNC_ESC)
+    {
+        peer->escaped = true;
+        return false;
+    }
+    if (peer->len == SYNC_MAX_FRAME)
+    {
+        peer->in_frame = false; // too long, wait for the next SOF
+        peer->errors++;
+        return false;
+    }
+    peer->buf[peer->len++] = peer->escaped ? byte ^ 0x20 : byte;
+    peer->escaped = false;
+    return false;
+}
+
+#endif // _SYNC_H
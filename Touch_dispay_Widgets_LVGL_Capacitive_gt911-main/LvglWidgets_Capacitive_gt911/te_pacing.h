@@ -0,0 +1,402 @@
+/*******************************************************************************
+ * Tear-free frame pacing on the ST7789 tearing-effect (TE) output
+ * The panel pulses TE at the start of vertical blanking (~60 Hz), then scans
+ * its lines top to bottom. A frame shows without a tear if every line of it
+ * is written after the scan that follows the frame's pulse has read that
+ * line, and before the next scan reads it: the panel shows the old frame
+ * once more, then the whole new one. With a half-screen draw buffer a frame
+ * is two or more flushes, so every flush is gated and checked against this
+ * scan model, not only the first:
+ *
+ *   line l is read at   pulse + (TE_BLANK_LINES + l) * period / (lines + TE_BLANK_LINES)
+ *   a flush may start   once its lines are written behind the scan
+ *   and must end        before the next scan reaches them
+ *
+ * In TE mode loop() starts rendering so that it ends just before the next
+ * pulse,
+ *
+ *   render start = predicted pulse - render estimate - TE_MARGIN_US
+ *
+ * the first flush waits for that pulse, and each flush waits until it can no
+ * longer overtake the scan (using the measured SPI time per pixel). The
+ * render estimate follows the measured time from render start to the first
+ * flush (rises at once, decays slowly). A frame whose first flush comes later
+ * than TE_LATE_US after its pulse waits for the next one and is counted as
+ * missed; a frame with any flush outside its window is counted as torn.
+ *
+ * In TE mode the LVGL refresh timer stays, with its period, but only marks a
+ * refresh as due; loop() renders it on the next reachable pulse. So the
+ * activity governor's refresh period still applies, and the timer pauses
+ * while nothing is invalidated, as LVGL's own does. When no pulse arrives
+ * within two periods the panel is assumed to have no TE line and the timer
+ * renders again itself; pulses seen again later switch TE mode back on.
+ *
+ * Portrait only. The scan runs along the panel's native lines; in landscape
+ * (scan_x) those are LVGL columns, and every row of a flushed area crosses
+ * all of them. Such a flush only fits if it ends within the blanking, and
+ * LVGL flushes full-width row bands, so every landscape frame tears: the
+ * sketch leaves TE pacing off at rotation 1/3. scan_x stays so that a
+ * landscape setup reports its frames as torn instead of claiming them.
+ *
+ * Usage:
+ *   te_pacing_begin(TFT_TE, lines, scan_x);   // pin -1: timer pacing only
+ *   my_disp_flush(): te_pacing_flush_gate(area); ... te_pacing_flush_done(last);
+ *   loop(): next_ms = te_pacing_poll(lv_timer_handler());
+ *
+ * Every TE_REPORT_MS with frames drawn:
+ *   TE,<te|timer>,<frames>,<missed>,<torn>,<fallbacks>,<period_us>,<render_us>
+ * Without ARDUINO a simulated TE generator on a virtual clock stands in for
+ * the interrupt; host/te_pacing_sim.cpp drives the module through it.
+ ******************************************************************************/
+#ifndef _TE_PACING_H
+#define _TE_PACING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <lvgl.h>
+
+#define TE_PERIOD_US 16667         // nominal 60 Hz until measured
+#define TE_BLANK_LINES 24          // ST7789 default porches: 12 + 12 lines of vertical blanking
+#define TE_MARGIN_US 2000          // covers the ms granularity of the loop wait
+#define TE_LATE_US 1000            // first flush this soon after the pulse still stays ahead of the scan
+#define TE_PROBE_MS 500            // timer mode: look for pulses again
+#define TE_REPORT_MS 10000
+
+enum te_mode_t
+{
+    TE_MODE_TIMER,
+    TE_MODE_TE
+};
+
+typedef struct
+{
+    uint32_t frames;
+    uint32_t missed;       // waited an extra pulse because rendering ran late
+    uint32_t torn;         // a flush of the frame crossed the scan (or no pulse to align to)
+    uint32_t fallbacks;    // TE -> timer switches
+} te_stats_t;
+
+/* Shared with the interrupt */
+static volatile uint32_t te_count = 0;
+static volatile uint32_t te_last_us = 0;
+static volatile uint32_t te_period_us = TE_PERIOD_US;
+
+static inline void te_on_pulse(uint32_t now)
+{
+    uint32_t delta = now - te_last_us;
+    if (te_count && delta > te_period_us / 2 && delta < te_period_us * 3 / 2)
+        te_period_us += ((int32_t)delta - (int32_t)te_period_us) / 8;
+    te_last_us = now;
+    te_count++;
+}
+
+/* Platform layer */
+#ifdef ARDUINO
+#include <Arduino.h>
+static TaskHandle_t te_waiter = NULL;
+static inline uint32_t te_now_us() { return (uint32_t)esp_timer_get_time(); }
+
+static void IRAM_ATTR te_isr()
+{
+    te_on_pulse((uint32_t)esp_timer_get_time());
+    if (te_waiter)
+    {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(te_waiter, &woken);
+        if (woken)
+            portYIELD_FROM_ISR();
+    }
+}
+
+/* Blocks until the next pulse; false after timeout_us without one */
+static bool te_wait_pulse(uint32_t timeout_us)
+{
+    te_waiter = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTake(pdTRUE, 0);
+    uint32_t seen = te_count, start = te_now_us();
+    while (te_count == seen)
+    {
+        uint32_t waited = te_now_us() - start;
+        if (waited >= timeout_us)
+            break;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS((timeout_us - waited) / 1000 + 1));
+    }
+    te_waiter = NULL;
+    return te_count != seen;
+}
+
+/* Short waits for the scan to pass: a few ms at most, below the tick */
+static inline void te_wait_us(uint32_t us) { delayMicroseconds(us); }
+#define TE_PRINTF Serial.printf
+#else
+#include <stdio.h>
+#include <stdlib.h>
+/* Simulated panel: pulses every te_sim_period_us +- te_sim_jitter_us on a virtual clock */
+static uint32_t te_sim_us = 0;
+static uint32_t te_sim_next_us = 0;
+static uint32_t te_sim_period_us = 16949; // 59 Hz, off the nominal period on purpose
+static uint32_t te_sim_jitter_us = 150;
+static bool te_sim_enabled = true;
+static inline uint32_t te_now_us() { return te_sim_us; }
+
+/* Advances the virtual clock, firing the pulses that fall into the interval */
+static void te_sim_spend(uint32_t us)
+{
+    uint32_t end = te_sim_us + us;
+    while (te_sim_enabled && (int32_t)(te_sim_next_us - end) <= 0)
+    {
+        te_sim_us = te_sim_next_us;
+        te_on_pulse(te_sim_us);
+        te_sim_next_us += te_sim_period_us - te_sim_jitter_us + (uint32_t)rand() % (2 * te_sim_jitter_us + 1);
+    }
+    te_sim_us = end;
+}
+
+static bool te_wait_pulse(uint32_t timeout_us)
+{
+    uint32_t seen = te_count;
+    if (te_sim_enabled && te_sim_next_us - te_sim_us <= timeout_us)
+        te_sim_spend(te_sim_next_us - te_sim_us);
+    else
+        te_sim_spend(timeout_us);
+    return te_count != seen;
+}
+
+static inline void te_wait_us(uint32_t us) { te_sim_spend(us); }
+#define TE_PRINTF printf
+#endif
+
+static int8_t te_pin = -1;
+static uint8_t te_mode = TE_MODE_TIMER;
+static uint16_t te_lines = 240;            // panel scan lines
+static bool te_scan_x = false;             // scan lines are LVGL columns (landscape)
+static bool te_frame_open = false;         // between the first and the last flush of a frame
+static bool te_frame_torn = false;
+static bool te_refresh_due = false;        // TE mode: the refresh timer asked for a frame
+static uint32_t te_target = 0;             // te_count the current frame should flush after
+static uint32_t te_frame_pulse_us = 0;     // pulse the current frame is aligned to
+static bool te_frame_aligned = false;      // there was a recent pulse to align to
+static uint32_t te_frame_start_us = 0;
+static uint32_t te_flush_start_us = 0;
+static uint16_t te_flush_first = 0, te_flush_last = 0;   // scan lines of the flush in progress
+static uint32_t te_flush_px = 0;
+static uint32_t te_px_ns = 0;              // measured SPI time per pixel, 0 until the first flush
+static uint32_t te_render_us = 4000;       // render estimate
+static uint32_t te_probe_count = 0;
+static uint32_t te_probe_ms = 0;
+static uint32_t te_report_ms = 0;
+static te_stats_t te_stats;
+
+/* TE mode: the refresh timer keeps its period (the governor sets it) but
+   only marks the frame as due; te_pacing_poll() renders it on a pulse. With
+   nothing invalidated it pauses, as _lv_disp_refr_timer does: the next
+   invalidation resumes it, and an idle screen leaves no timer running */
+static void te_refr_timer_cb(lv_timer_t *t)
+{
+    lv_disp_t *disp = (lv_disp_t *)t->user_data;
+    if (!disp->inv_p)
+    {
+        lv_timer_pause(t);
+        return;
+    }
+    te_refresh_due = true;
+}
+
+static void te_set_mode(uint8_t mode)
+{
+    te_mode = mode;
+    // the probe only counts pulses seen in the new mode
+    te_probe_count = te_count;
+    te_probe_ms = te_now_us() / 1000;
+    lv_disp_t *disp = lv_disp_get_default();
+    if (!disp || !disp->refr_timer)
+        return;
+    lv_timer_set_cb(disp->refr_timer, mode == TE_MODE_TE ? te_refr_timer_cb : _lv_disp_refr_timer);
+}
+
+void te_pacing_print_stats()
+{
+    TE_PRINTF("TE,%s,%u,%u,%u,%u,%u,%u\n", te_mode == TE_MODE_TE ? "te" : "timer", (unsigned)te_stats.frames,
+              (unsigned)te_stats.missed, (unsigned)te_stats.torn, (unsigned)te_stats.fallbacks,
+              (unsigned)te_period_us, (unsigned)te_render_us);
+    te_stats = te_stats_t();
+}
+
+/* Call after lv_disp_drv_register(); pin < 0 keeps timer pacing. lines: the
+   panel's scan lines, scan_x: they run along LVGL x (landscape) */
+bool te_pacing_begin(int8_t pin, uint16_t lines, bool scan_x)
+{
+    te_pin = pin;
+    te_lines = lines;
+    te_scan_x = scan_x;
+#ifdef ARDUINO
+    if (pin < 0)
+        return false;
+    pinMode(pin, INPUT);
+    attachInterrupt(digitalPinToInterrupt(pin), te_isr, RISING);
+#endif
+    // two pulses measure the first period
+    bool ok = te_wait_pulse(3 * TE_PERIOD_US) && te_wait_pulse(3 * TE_PERIOD_US);
+    te_set_mode(ok ? TE_MODE_TE : TE_MODE_TIMER);
+    if (!ok)
+        TE_PRINTF("TE,no signal on pin %d, timer pacing\n", pin);
+    return ok;
+}
+
+/* Window for a flush of `us` over lines [first, last], relative to the frame's
+   pulse: it may start from *lo (behind this scan) and must start by *hi
+   (ahead of the next). Scan and writes are linear in the line, so the two
+   end lines bound all of them. */
+static void te_flush_window(uint16_t first, uint16_t last, uint32_t us, int32_t *lo, int32_t *hi)
+{
+    int32_t period = (int32_t)te_period_us;
+    int32_t line_us = period / (te_lines + TE_BLANK_LINES);
+    int32_t read_first = (TE_BLANK_LINES + first) * line_us, read_last = (TE_BLANK_LINES + last) * line_us;
+    if (te_scan_x)
+    {
+        // every row crosses every line: start after the last is read, end before the first is read again
+        *lo = read_last;
+        *hi = period + read_first - (int32_t)us;
+        return;
+    }
+    int32_t n = last - first + 1, span = (int32_t)((int64_t)us * (n - 1) / n), per_line = (int32_t)us / n;
+    *lo = read_first > read_last - span ? read_first : read_last - span;
+    *hi = (read_first < read_last - span ? read_first : read_last - span) + period - per_line;
+}
+
+/* Every flush: the first one of a frame starts on a pulse, each one starts
+   where it cannot overtake the scan */
+void te_pacing_flush_gate(const lv_area_t *area)
+{
+    if (te_pin < 0)
+        return;
+    uint32_t now = te_now_us();
+    if (!te_frame_open)
+    {
+        te_frame_open = true;
+        te_frame_torn = false;
+        te_stats.frames++;
+        if (te_mode == TE_MODE_TE)
+        {
+            // rendering up to here is what the next schedule has to fit in
+            uint32_t render = now - te_frame_start_us;
+            te_render_us = render > te_render_us ? render : te_render_us - (te_render_us - render) / 16;
+
+            bool on_time = te_count == te_target && now - te_last_us <= TE_LATE_US;
+            if (!on_time)
+            {
+                if ((int32_t)(te_count - te_target) >= 0)
+                    te_stats.missed++;
+                if (!te_wait_pulse(2 * te_period_us))
+                {
+                    te_stats.fallbacks++;
+                    te_set_mode(TE_MODE_TIMER);
+                }
+                now = te_now_us();
+            }
+        }
+        // timer mode: aligned to nothing unless a pulse came within the last period
+        te_frame_pulse_us = te_last_us;
+        te_frame_aligned = te_count && now - te_last_us < te_period_us;
+    }
+
+    te_flush_first = te_scan_x ? area->x1 : area->y1;
+    te_flush_last = te_scan_x ? area->x2 : area->y2;
+    te_flush_px = (uint32_t)(area->x2 - area->x1 + 1) * (area->y2 - area->y1 + 1);
+    if (te_mode == TE_MODE_TE && te_frame_aligned)
+    {
+        // before the first measurement the flush counts as instant: it waits for the whole area
+        int32_t lo, hi;
+        te_flush_window(te_flush_first, te_flush_last, (uint32_t)((uint64_t)te_flush_px * te_px_ns / 1000), &lo, &hi);
+        int32_t at = (int32_t)(now - te_frame_pulse_us);
+        if (at < lo)
+            te_wait_us(lo - at);
+    }
+    te_flush_start_us = te_now_us();
+}
+
+/* Every flush: checks it against the scan with its real duration */
+void te_pacing_flush_done(bool last)
+{
+    if (te_pin < 0 || !te_frame_open)
+        return;
+    uint32_t us = te_now_us() - te_flush_start_us;
+    if (te_flush_px)
+    {
+        uint32_t ns = (uint32_t)((uint64_t)us * 1000 / te_flush_px);
+        te_px_ns = te_px_ns ? te_px_ns + ((int32_t)ns - (int32_t)te_px_ns) / 8 : ns;
+    }
+    int32_t lo, hi;
+    te_flush_window(te_flush_first, te_flush_last, us, &lo, &hi);
+    int32_t at = (int32_t)(te_flush_start_us - te_frame_pulse_us);
+    if (!te_frame_aligned || at < lo || at > hi)
+        te_frame_torn = true;
+    if (last)
+    {
+        te_frame_open = false;
+        if (te_frame_torn)
+            te_stats.torn++;
+    }
+}
+
+/* Time until rendering should start for the next reachable pulse (<= 0: now) */
+static int32_t te_schedule(uint32_t now)
+{
+    uint32_t period = te_period_us;
+    uint32_t lead = te_render_us + TE_MARGIN_US;
+    uint32_t count = te_count, last = te_last_us;
+    uint32_t k = (now - last) / period + 1;
+    // skip pulses that are too close to render for
+    while (last + k * period - now < lead && k * period < lead + 2 * period)
+        k++;
+    te_target = count + k;
+    return (int32_t)(last + k * period - lead - now);
+}
+
+static void te_frame_begin(uint32_t now)
+{
+    te_frame_start_us = now;
+    te_frame_open = false;
+}
+
+/* loop(): triggers TE-paced refreshes and shortens the wait that follows */
+uint32_t te_pacing_poll(uint32_t next_ms)
+{
+    uint32_t now_ms = te_now_us() / 1000;
+    if (te_pin >= 0 && now_ms - te_probe_ms >= TE_PROBE_MS)
+    {
+        uint32_t pulses = te_count - te_probe_count;
+        if (te_mode == TE_MODE_TIMER && pulses * te_period_us >= TE_PROBE_MS * 1000 / 2)
+            te_set_mode(TE_MODE_TE);
+        te_probe_count = te_count;
+        te_probe_ms = now_ms;
+    }
+    if (te_stats.frames && now_ms - te_report_ms >= TE_REPORT_MS)
+    {
+        te_pacing_print_stats();
+        te_report_ms = now_ms;
+    }
+    if (te_mode != TE_MODE_TE || !te_refresh_due)
+        return next_ms;
+
+    lv_disp_t *disp = lv_disp_get_default();
+    if (!disp || !disp->inv_p)
+    {
+        te_refresh_due = false;
+        return next_ms;
+    }
+    uint32_t now = te_now_us();
+    int32_t wait_us = te_schedule(now);
+    if (wait_us >= 1000)
+    {
+        // loop() waits in whole ms; less than that is inside TE_MARGIN_US
+        uint32_t wait_ms = (uint32_t)wait_us / 1000;
+        return wait_ms < next_ms ? wait_ms : next_ms;
+    }
+    te_refresh_due = false;
+    te_frame_begin(now);
+    _lv_disp_refr_timer(disp->refr_timer);
+    return 0;
+}
+
+#endif // _TE_PACING_H
@@ -19,17 +19,9 @@
 // #define TOUCH_MAP_Y1 0
 // #define TOUCH_MAP_Y2 480
 
-/* uncomment for GT911 */
+/* uncomment for GT911; its pins, rotation and TOUCH_MAP_* come from
+   tabview_board.h (edit the map there when switching controllers) */
  #define TOUCH_GT911
- #define TOUCH_GT911_SCL 32
- #define TOUCH_GT911_SDA 33
- #define TOUCH_GT911_INT -1
- #define TOUCH_GT911_RST 25
- #define TOUCH_GT911_ROTATION ROTATION_RIGHT//ROTATION_NORMAL
- #define TOUCH_MAP_X1 320
- #define TOUCH_MAP_X2 0
- #define TOUCH_MAP_Y1 240
- #define TOUCH_MAP_Y2 0
 
 /* uncomment for XPT2046 */
 // #define TOUCH_XPT2046
@@ -44,8 +36,38 @@
 // #define TOUCH_MAP_Y1 100
 // #define TOUCH_MAP_Y2 4000
 
+#include "latency_trace.h"
+
 int touch_last_x = 0, touch_last_y = 0;
 
+/* When the current contact started, for the governor's wake-up latency: the
+   GT911 interrupt edge if TOUCH_GT911_INT is wired, otherwise the last read
+   that still saw no contact, the latest moment the panel was untouched */
+static uint32_t touch_idle_read_ms = 0;
+static uint32_t touch_down_ms = 0;
+static bool touch_down = false;
+static volatile uint32_t touch_irq_ms = 0; // first INT edge since the last idle read, 0 = none
+
+static void touch_note_read(bool touched)
+{
+  if (touched && !touch_down)
+  {
+    uint32_t irq = touch_irq_ms;
+    touch_down_ms = irq && (int32_t)(irq - touch_idle_read_ms) >= 0 ? irq : touch_idle_read_ms;
+  }
+  touch_down = touched;
+  if (!touched)
+  {
+    touch_idle_read_ms = millis();
+    touch_irq_ms = 0;
+  }
+}
+
+uint32_t touch_event_ms()
+{
+  return touch_down_ms;
+}
+
 #if defined(TOUCH_FT6X36)
 #include <Wire.h>
 #include <FT6X36.h>
@@ -55,8 +77,27 @@ bool touch_touched_flag = true, touch_released_flag = true;
 #elif defined(TOUCH_GT911)
 #include <Wire.h>
 #include <TAMC_GT911.h>
+#include "i2c_bus.h"
 TAMC_GT911 ts = TAMC_GT911(TOUCH_GT911_SDA, TOUCH_GT911_SCL, TOUCH_GT911_INT, TOUCH_GT911_RST, max(TOUCH_MAP_X1, TOUCH_MAP_X2), max(TOUCH_MAP_Y1, TOUCH_MAP_Y2));
 
+// status register + 5 points + clear, roughly what one ts.read() puts on the bus
+#define TOUCH_GT911_READ_BYTES 50
+
+/* ts.read() drives Wire itself, so it runs as a high priority bus manager call */
+bool touch_gt911_read(void *)
+{
+  ts.read();
+  return true;
+}
+
+#if TOUCH_GT911_INT >= 0
+static void IRAM_ATTR touch_gt911_isr()
+{
+  if (!touch_irq_ms)
+    touch_irq_ms = millis();
+}
+#endif
+
 #elif defined(TOUCH_XPT2046)
 #include <XPT2046_Touchscreen.h>
 #include <SPI.h>
@@ -107,6 +148,7 @@ void touch(TPoint p, TEvent e)
 
 void touch_init()
 {
+  touch_idle_read_ms = millis();
 #if defined(TOUCH_FT6X36)
   Wire.begin(TOUCH_FT6X36_SDA, TOUCH_FT6X36_SCL);
   ts.begin();
@@ -117,6 +159,11 @@ void touch_init()
   Wire.begin(TOUCH_GT911_SDA, TOUCH_GT911_SCL);
   ts.begin();
   ts.setRotation(TOUCH_GT911_ROTATION);
+#if TOUCH_GT911_INT >= 0
+  // after ts.begin(): the reset sequence drives INT to select the address
+  attachInterrupt(TOUCH_GT911_INT, touch_gt911_isr, FALLING);
+#endif
+  i2c_bus_init();
 
 #elif defined(TOUCH_XPT2046)
   SPI.begin(TOUCH_XPT2046_SCK, TOUCH_XPT2046_MISO, TOUCH_XPT2046_MOSI, TOUCH_XPT2046_CS);
@@ -149,6 +196,7 @@ bool touch_touched()
   if (touch_touched_flag)
   {
     touch_touched_flag = false;
+    touch_note_read(true);
     return true;
   }
   else
@@ -157,9 +205,11 @@ bool touch_touched()
   }
 
 #elif defined(TOUCH_GT911)
-  ts.read();
+  i2c_bus_call(I2C_CLIENT_TOUCH, I2C_PRIO_HIGH, touch_gt911_read, NULL, TOUCH_GT911_READ_BYTES);
+  touch_note_read(ts.isTouched);
   if (ts.isTouched)
   {
+    latency_trace_sample();
 #if defined(TOUCH_SWAP_XY)
     touch_last_x = map(ts.points[0].y, TOUCH_MAP_X1, TOUCH_MAP_X2, 0, gfx->width() - 1);
     touch_last_y = map(ts.points[0].x, TOUCH_MAP_Y1, TOUCH_MAP_Y2, 0, gfx->height() - 1);
@@ -175,7 +225,9 @@ bool touch_touched()
   }
 
 #elif defined(TOUCH_XPT2046)
-  if (ts.touched())
+  bool touched = ts.touched();
+  touch_note_read(touched);
+  if (touched)
   {
     TS_Point p = ts.getPoint();
 #if defined(TOUCH_SWAP_XY)
@@ -203,6 +255,7 @@ bool touch_released()
   if (touch_released_flag)
   {
     touch_released_flag = false;
+    touch_note_read(false);
     return true;
   }
   else
@@ -0,0 +1,368 @@
+/*******************************************************************************
+ * Touch trace record / replay and frame-time benchmarks
+ * Record: every change of the touch state seen by my_touchpad_read is written
+ * as a "TT,<ms>,<pressed>,<x>,<y>" line to Serial, or to /touch.trc on
+ * LittleFS when TOUCH_TRACE_FILE is defined.
+ * Replay: a trace (recorded, or one of the canned scenarios below) is fed
+ * back through the same my_touchpad_read / LVGL indev path while LVGL runs on
+ * a virtual clock, so the same frames are rendered on every run.
+ * Benchmark: touch_bench_run_all() replays each scenario, reports frame time
+ * p50/p99, flushed bytes and heap high-water as
+ *   BENCH,<name>,<frames>,<p50_us>,<p99_us>,<flush_bytes>,<lv_mem_max>,<heap_min>,PASS|FAIL|NOBASE
+ * and fails a scenario whose numbers exceed its platform's baseline in
+ * touch_benches[] by more than the slack. heap_min (ESP.getMinFreeHeap) is
+ * device-only and printed as "-" on the host. host/touch_trace_bench.cpp
+ * runs the scenarios on a PC build.
+ *
+ * Replays need LV_TICK_VIRTUAL=1, which lv_conf.h leaves off: put
+ *   -DLV_TICK_VIRTUAL=1
+ * in a build_opt.h next to the sketch for a TOUCH_BENCH build, so the LVGL
+ * library is compiled with the same setting.
+ ******************************************************************************/
+#ifndef _TOUCH_TRACE_H
+#define _TOUCH_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <lvgl.h>
+
+#if defined(TOUCH_BENCH) && !LV_TICK_VIRTUAL
+#error "TOUCH_BENCH needs LV_TICK_VIRTUAL=1: add -DLV_TICK_VIRTUAL=1 to build_opt.h"
+#endif
+
+#define TOUCH_TRACE_STEP_MS 5          // virtual time per loop iteration: governor_wait()'s 5 ms cap while active
+#define TOUCH_TRACE_SETTLE_MS 500      // keep rendering after the last sample so animations finish
+#define TOUCH_BENCH_MAX_SAMPLES 512
+#define TOUCH_BENCH_MAX_FRAMES 1024
+#define TOUCH_BENCH_REPEAT 5           // replays per scenario, the best p50/p99 count: one preemption is not a regression
+#define TOUCH_BENCH_TIME_SLACK 3       // frame times may reach this many times the baseline
+#define TOUCH_BENCH_PX_SLACK_PCT 10    // flushed pixels per frame may exceed the baseline by this much
+
+typedef struct
+{
+    uint32_t t_ms;  // relative to the start of the trace
+    uint8_t pressed;
+    int16_t x, y;
+} touch_sample_t;
+
+enum touch_trace_mode_t
+{
+    TOUCH_TRACE_OFF,
+    TOUCH_TRACE_RECORD,
+    TOUCH_TRACE_REPLAY
+};
+
+/* Platform layer */
+#ifdef ARDUINO
+#include <Arduino.h>
+#ifdef TOUCH_TRACE_FILE
+#include <LittleFS.h>
+static File touch_trace_file;
+#endif
+static inline uint32_t touch_trace_real_ms() { return millis(); }
+static inline uint32_t touch_trace_us() { return micros(); }
+#define TOUCH_TRACE_PRINTF Serial.printf
+#else
+#include <stdio.h>
+#include <time.h>
+static inline uint32_t touch_trace_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+static inline uint32_t touch_trace_real_ms() { return touch_trace_us() / 1000; }
+#define TOUCH_TRACE_PRINTF printf
+#endif
+
+static uint8_t touch_trace_mode = TOUCH_TRACE_OFF;
+static uint32_t touch_trace_vtime = 0;       // virtual ms while replaying
+static uint32_t touch_trace_offset = 0;      // keeps the LVGL clock monotonic after a replay
+static uint32_t touch_trace_start = 0;
+static const touch_sample_t *touch_trace_samples;
+static size_t touch_trace_len, touch_trace_idx;
+static touch_sample_t touch_trace_last = {0, 0, -1, -1};
+static uint32_t touch_trace_flush_px = 0;    // pixels flushed, bumped by my_disp_flush
+static bool touch_trace_flushed = false;
+
+/* LVGL tick source: real time, or the virtual clock during a replay */
+extern "C" uint32_t lv_virtual_millis(void)
+{
+    return touch_trace_mode == TOUCH_TRACE_REPLAY ? touch_trace_vtime : touch_trace_real_ms() + touch_trace_offset;
+}
+
+static inline void touch_trace_on_flush(uint32_t px)
+{
+    touch_trace_flush_px += px;
+    touch_trace_flushed = true;
+}
+
+/* Recording */
+void touch_trace_record_start()
+{
+#if defined(ARDUINO) && defined(TOUCH_TRACE_FILE)
+    LittleFS.begin(true);
+    touch_trace_file = LittleFS.open("/touch.trc", "w");
+#endif
+    touch_trace_start = touch_trace_real_ms();
+    touch_trace_last.x = touch_trace_last.y = -1;
+    touch_trace_mode = TOUCH_TRACE_RECORD;
+}
+
+void touch_trace_record_stop()
+{
+#if defined(ARDUINO) && defined(TOUCH_TRACE_FILE)
+    touch_trace_file.close();
+#endif
+    touch_trace_mode = TOUCH_TRACE_OFF;
+}
+
+/* Called with the state my_touchpad_read hands to LVGL; only changes are logged */
+void touch_trace_record(bool pressed, int16_t x, int16_t y)
+{
+    if (touch_trace_mode != TOUCH_TRACE_RECORD)
+        return;
+    if (pressed == touch_trace_last.pressed && (!pressed || (x == touch_trace_last.x && y == touch_trace_last.y)))
+        return;
+    touch_trace_last.pressed = pressed;
+    touch_trace_last.x = x;
+    touch_trace_last.y = y;
+    uint32_t t = touch_trace_real_ms() - touch_trace_start;
+#if defined(ARDUINO) && defined(TOUCH_TRACE_FILE)
+    touch_trace_file.printf("TT,%u,%d,%d,%d\n", (unsigned)t, pressed, x, y);
+#else
+    TOUCH_TRACE_PRINTF("TT,%u,%d,%d,%d\n", (unsigned)t, pressed, x, y);
+#endif
+}
+
+/* Replay */
+void touch_trace_replay_start(const touch_sample_t *samples, size_t len)
+{
+    touch_trace_samples = samples;
+    touch_trace_len = len;
+    touch_trace_idx = 0;
+    touch_trace_last.pressed = 0;
+    // continue from the current time so LVGL timers do not see the clock jump back
+    touch_trace_vtime = lv_virtual_millis();
+    touch_trace_start = touch_trace_vtime;
+    touch_trace_mode = TOUCH_TRACE_REPLAY;
+}
+
+/* The virtual clock usually ran ahead of real time: carry the difference over */
+void touch_trace_replay_stop()
+{
+    uint32_t now = touch_trace_real_ms();
+    if ((int32_t)(touch_trace_vtime - (now + touch_trace_offset)) > 0)
+        touch_trace_offset = touch_trace_vtime - now;
+    touch_trace_mode = TOUCH_TRACE_OFF;
+}
+
+bool touch_trace_replay_done()
+{
+    return touch_trace_idx >= touch_trace_len &&
+           touch_trace_vtime - touch_trace_start >= (touch_trace_len ? touch_trace_samples[touch_trace_len - 1].t_ms : 0) + TOUCH_TRACE_SETTLE_MS;
+}
+
+void touch_trace_advance(uint32_t ms) { touch_trace_vtime += ms; }
+
+/* Replaces the hardware read while replaying; returns false otherwise */
+bool touch_trace_replay_read(lv_indev_data_t *data)
+{
+    if (touch_trace_mode != TOUCH_TRACE_REPLAY)
+        return false;
+    uint32_t t = touch_trace_vtime - touch_trace_start;
+    while (touch_trace_idx < touch_trace_len && touch_trace_samples[touch_trace_idx].t_ms <= t)
+    {
+        touch_sample_t s = touch_trace_samples[touch_trace_idx++];
+        if (!s.pressed)
+        {
+            // a release happens where the finger last was, like the GT911 path
+            s.x = touch_trace_last.x;
+            s.y = touch_trace_last.y;
+        }
+        touch_trace_last = s;
+    }
+    data->state = touch_trace_last.pressed ? LV_INDEV_STATE_PR : LV_INDEV_STATE_REL;
+    data->point.x = touch_trace_last.x;
+    data->point.y = touch_trace_last.y;
+    return true;
+}
+
+#if defined(ARDUINO) && defined(TOUCH_TRACE_FILE)
+/* Loads a recorded trace from LittleFS; the caller frees the returned buffer */
+touch_sample_t *touch_trace_load(size_t *len)
+{
+    LittleFS.begin(true);
+    File f = LittleFS.open("/touch.trc", "r");
+    touch_sample_t *s = (touch_sample_t *)malloc(sizeof(touch_sample_t) * TOUCH_BENCH_MAX_SAMPLES);
+    *len = 0;
+    while (s && f && f.available() && *len < TOUCH_BENCH_MAX_SAMPLES)
+    {
+        String line = f.readStringUntil('\n');
+        unsigned t;
+        int p, x, y;
+        if (sscanf(line.c_str(), "TT,%u,%d,%d,%d", &t, &p, &x, &y) == 4)
+            s[(*len)++] = {t, (uint8_t)p, (int16_t)x, (int16_t)y};
+    }
+    f.close();
+    return s;
+}
+#endif
+
+/* Canned scenarios for the 320x240 tabview: the tab bar is 30 px high and
+ * create_controls_for_tab puts the buttons at y 20..70 and the sliders at
+ * y 90 and 140 of the tab content */
+static size_t touch_trace_gen_swipes(touch_sample_t *s)
+{
+    size_t n = 0;
+    uint32_t t = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        bool left = (i % 2) == 0;
+        for (int step = 0; step <= 20; step++, t += 10)
+            s[n++] = {t, 1, (int16_t)(left ? 280 - step * 12 : 40 + step * 12), 200};
+        s[n++] = {t, 0, 0, 0};
+        t += 400;
+    }
+    return n;
+}
+
+static size_t touch_trace_gen_slider_drag(touch_sample_t *s)
+{
+    size_t n = 0;
+    uint32_t t = 0;
+    for (int pass = 0; pass < 4; pass++)
+    {
+        for (int step = 0; step <= 50; step++, t += 10)
+        {
+            int16_t x = (pass % 2) ? 260 - step * 4 : 60 + step * 4;
+            s[n++] = {t, 1, x, 30 + 90 + 5};
+        }
+    }
+    s[n++] = {t, 0, 0, 0};
+    return n;
+}
+
+static size_t touch_trace_gen_taps(touch_sample_t *s)
+{
+    size_t n = 0;
+    for (uint32_t i = 0; i < 40; i++)
+    {
+        int16_t x = (i % 2) ? 230 : 90; // Btn1 / Btn2
+        s[n++] = {i * 100, 1, x, 30 + 45};
+        s[n++] = {i * 100 + 40, 0, x, 30 + 45};
+    }
+    return n;
+}
+
+typedef struct
+{
+    const char *name;
+    size_t (*generate)(touch_sample_t *s);
+    uint32_t p50_us;          // baseline; 0: not measured on this platform yet, reported only
+    uint32_t p99_us;
+    uint32_t frame_px;        // flushed pixels per frame, on average
+} touch_bench_t;
+
+/* Baselines: the BENCH output of a reference run, frame_px = flush_bytes / 2 / frames.
+ * The pixel counts are exact for a given LVGL and layout, so a scenario that
+ * starts redrawing more of the screen fails; the frame times allow for noise.
+ * Re-baseline after a deliberate UI change. */
+static const touch_bench_t touch_benches[] = {
+#ifdef ARDUINO
+    // no device run recorded yet: paste a TOUCH_BENCH build's BENCH lines here
+    {"tab_swipe", touch_trace_gen_swipes, 0, 0, 0},
+    {"slider_drag", touch_trace_gen_slider_drag, 0, 0, 0},
+    {"button_taps", touch_trace_gen_taps, 0, 0, 0},
+#else
+    // host/touch_trace_bench on host/lvgl.h, x86-64 g++ -O2:
+    //   BENCH,tab_swipe,120,85,100,15436800,3628,-
+    //   BENCH,slider_drag,68,8,10,651664,3628,-
+    //   BENCH,button_taps,80,17,20,1187840,3628,-
+    {"tab_swipe", touch_trace_gen_swipes, 85, 100, 64320},
+    {"slider_drag", touch_trace_gen_slider_drag, 8, 10, 4791},
+    {"button_taps", touch_trace_gen_taps, 17, 20, 7424},
+#endif
+};
+
+static int touch_bench_cmp(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Replays one trace on the virtual clock; returns the frame count */
+static size_t touch_bench_replay(const touch_sample_t *samples, size_t len, uint32_t *frame_us)
+{
+    size_t frames = 0;
+    touch_trace_replay_start(samples, len);
+    while (!touch_trace_replay_done())
+    {
+        touch_trace_flushed = false;
+        uint32_t t0 = touch_trace_us();
+        lv_timer_handler();
+        uint32_t dt = touch_trace_us() - t0;
+        if (touch_trace_flushed && frames < TOUCH_BENCH_MAX_FRAMES)
+            frame_us[frames++] = dt;
+        touch_trace_advance(TOUCH_TRACE_STEP_MS);
+    }
+    touch_trace_replay_stop();
+    return frames;
+}
+
+/* Replays a trace TOUCH_BENCH_REPEAT times and checks it against a baseline */
+bool touch_bench_run(const touch_bench_t *b, const touch_sample_t *samples, size_t len)
+{
+    static uint32_t frame_us[TOUCH_BENCH_MAX_FRAMES];
+    size_t frames = 0;
+    uint32_t p50 = UINT32_MAX, p99 = UINT32_MAX, flush_px = 0;
+
+    for (uint8_t rep = 0; rep < TOUCH_BENCH_REPEAT; rep++)
+    {
+        touch_trace_flush_px = 0;
+        frames = touch_bench_replay(samples, len, frame_us);
+        flush_px = touch_trace_flush_px;
+        qsort(frame_us, frames, sizeof(frame_us[0]), touch_bench_cmp);
+        if (frames && frame_us[frames / 2] < p50)
+            p50 = frame_us[frames / 2];
+        if (frames && frame_us[(frames * 99) / 100] < p99)
+            p99 = frame_us[(frames * 99) / 100];
+    }
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+
+    bool measured = b->p50_us && b->p99_us && b->frame_px;
+    bool pass = frames && (!measured || (p50 <= b->p50_us * TOUCH_BENCH_TIME_SLACK &&
+                                         p99 <= b->p99_us * TOUCH_BENCH_TIME_SLACK &&
+                                         flush_px / frames <= b->frame_px * (100 + TOUCH_BENCH_PX_SLACK_PCT) / 100));
+    char heap_min[12] = "-";
+#ifdef ARDUINO
+    snprintf(heap_min, sizeof(heap_min), "%u", (unsigned)ESP.getMinFreeHeap());
+#endif
+    TOUCH_TRACE_PRINTF("BENCH,%s,%u,%u,%u,%u,%u,%s,%s\n", b->name, (unsigned)frames, (unsigned)p50, (unsigned)p99,
+                       (unsigned)(flush_px * sizeof(lv_color_t)), (unsigned)mon.max_used, heap_min,
+                       !pass ? "FAIL" : measured ? "PASS" : "NOBASE");
+    return pass;
+}
+
+/* Runs every canned scenario; returns the number of failed ones */
+int touch_bench_run_all()
+{
+    touch_sample_t *s = (touch_sample_t *)malloc(sizeof(touch_sample_t) * TOUCH_BENCH_MAX_SAMPLES);
+    if (!s)
+        return -1;
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(touch_benches) / sizeof(touch_benches[0]); i++)
+    {
+        const touch_bench_t *b = &touch_benches[i];
+        size_t n = b->generate(s);
+        if (!touch_bench_run(b, s, n))
+            failed++;
+    }
+    free(s);
+    TOUCH_TRACE_PRINTF("BENCH,done,%d failed\n", failed);
+    return failed;
+}
+
+#endif // _TOUCH_TRACE_H
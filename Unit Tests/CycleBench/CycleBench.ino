@@ -0,0 +1,107 @@
+/*******************************************************************************
+ * Cycle benchmarks for the display, touch and LVGL paths of the tabview demo
+ * The panel, bus clock and touch setup come from libraries/tabview_board,
+ * which LvglWidgets_Capacitive_gt911 includes as well. LVGL takes its tick
+ * from millis() (LV_TICK_VIRTUAL is off without the demo's build_opt.h).
+ * All benchmarks run once after boot; send a line over Serial to run again,
+ * e.g. "flush" runs only the benchmarks whose name starts with "flush".
+ * Output format: see cycle_bench.h. host/cycle_bench_host.cpp prints the
+ * same lines for a PC build (its stand-ins for the flush and touch paths as
+ * host_*), plus the keypad and audio benchmarks; cycle_bench_report.txt
+ * collects the runs.
+ *
+ * Not covered on this board:
+ *   keypad scans  ESP32/keypad.h drives GPIO 13, 27 and 33, which are MOSI,
+ *                 backlight and touch SDA here. On the keypad board
+ *                 keypad_print_stats() reports the CCOUNT cycles per scan
+ *   I2S reads     no microphone on this board; i2s_read() itself only waits
+ *                 for DMA. The CPU work behind it (KWS front-end, meter
+ *                 analysis) is timed by the host runner
+ ******************************************************************************/
+#include <lvgl.h>
+#include <Arduino_GFX_Library.h>
+#include <Wire.h>
+#include <TAMC_GT911.h>
+#include <tabview_board.h>
+#include "cycle_bench.h"
+#include "bench_lvgl.h"
+
+TAMC_GT911 ts = TAMC_GT911(TOUCH_GT911_SDA, TOUCH_GT911_SCL, TOUCH_GT911_INT, TOUCH_GT911_RST, max(TOUCH_MAP_X1, TOUCH_MAP_X2), max(TOUCH_MAP_Y1, TOUCH_MAP_Y2));
+
+static uint16_t *bench_pixels;      // half screen, the demo's LVGL draw buffer size
+static lv_color_t *bench_lv_buf;
+
+/* Flush as in my_disp_flush */
+static void bench_disp_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p)
+{
+    gfx->draw16bitRGBBitmap(area->x1, area->y1, (uint16_t *)&color_p->full, area->x2 - area->x1 + 1, area->y2 - area->y1 + 1);
+    lv_disp_flush_ready(disp);
+}
+
+/* Largest flush: one half-screen draw buffer */
+static void bench_flush_half(void *)
+{
+    gfx->draw16bitRGBBitmap(0, 0, bench_pixels, gfx->width(), gfx->height() / 2);
+}
+
+/* Typical small flush: a slider value label */
+static void bench_flush_label(void *)
+{
+    gfx->draw16bitRGBBitmap(140, 60, bench_pixels, 40, 20);
+}
+
+volatile int touch_last_x, touch_last_y;
+
+/* What touch_touched() does on the GT911 path, without the bus arbiter */
+static void bench_touch_read(void *)
+{
+    ts.read();
+    if (ts.isTouched)
+    {
+        touch_last_x = map(ts.points[0].x, TOUCH_MAP_X1, TOUCH_MAP_X2, 0, gfx->width() - 1);
+        touch_last_y = map(ts.points[0].y, TOUCH_MAP_Y1, TOUCH_MAP_Y2, 0, gfx->height() - 1);
+    }
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    gfx->begin(TFT_SPI_HZ);
+    pinMode(TFT_BL, OUTPUT);
+    digitalWrite(TFT_BL, HIGH);
+    Wire.begin(TOUCH_GT911_SDA, TOUCH_GT911_SCL);
+    ts.begin();
+    ts.setRotation(TOUCH_GT911_ROTATION);
+
+    uint32_t half_px = gfx->width() * gfx->height() / 2;
+    bench_pixels = (uint16_t *)heap_caps_malloc(half_px * sizeof(uint16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    bench_lv_buf = (lv_color_t *)heap_caps_malloc(half_px * sizeof(lv_color_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!bench_pixels || !bench_lv_buf)
+    {
+        Serial.println("CYC,error,buffer allocate failed");
+        return;
+    }
+    for (uint32_t i = 0; i < half_px; i++)
+        bench_pixels[i] = (uint16_t)(i * 2654435761u >> 16);
+
+    cycle_bench_add("flush_half", bench_flush_half, NULL, 3, 50);
+    cycle_bench_add("flush_label", bench_flush_label, NULL, 10, 500);
+    cycle_bench_add("touch_read", bench_touch_read, NULL, 5, 200);
+    bench_lvgl_begin(gfx->width(), gfx->height(), bench_lv_buf, half_px, bench_disp_flush);
+
+    cycle_bench_run_all(NULL);
+}
+
+void loop()
+{
+    if (Serial.available())
+    {
+        static char line[32];
+        size_t n = Serial.readBytesUntil('\n', line, sizeof(line) - 1);
+        while (n && (line[n - 1] == '\r' || line[n - 1] == ' '))
+            n--;
+        line[n] = 0;
+        cycle_bench_run_all(line);
+    }
+    delay(5);
+}
@@ -0,0 +1,58 @@
+/*******************************************************************************
+ * LVGL timer path benchmarks, shared by the device sketch and the host runner
+ * so both measure the same code:
+ *   lv_timer_idle    lv_timer_handler() with nothing to redraw
+ *   lv_slider_step   slider value +-1, then invalidate, render and flush
+ * The caller provides the draw buffer and the flush callback of its platform.
+ * Built against the demo's host/lvgl.h stand-in instead of LVGL, the lines
+ * are named host_lv_*: the calls are the same, the timers and renderer
+ * behind them are not LVGL's.
+ ******************************************************************************/
+#ifndef _BENCH_LVGL_H
+#define _BENCH_LVGL_H
+
+#include <lvgl.h>
+#include "cycle_bench.h"
+
+#ifdef _HOST_LVGL_H
+#define BENCH_LVGL_NAME(name) "host_" name
+#else
+#define BENCH_LVGL_NAME(name) name
+#endif
+
+static lv_disp_draw_buf_t bench_draw_buf;
+static lv_disp_drv_t bench_disp_drv;
+static lv_obj_t *bench_slider;
+
+static void bench_lv_timer_idle(void *) { lv_timer_handler(); }
+
+static void bench_lv_slider_step(void *)
+{
+    lv_slider_set_value(bench_slider, lv_slider_get_value(bench_slider) == 50 ? 51 : 50, LV_ANIM_OFF);
+    lv_refr_now(NULL);
+}
+
+void bench_lvgl_begin(lv_coord_t w, lv_coord_t h, lv_color_t *buf, uint32_t buf_px,
+                      void (*flush)(lv_disp_drv_t *, const lv_area_t *, lv_color_t *))
+{
+    lv_init();
+    lv_disp_draw_buf_init(&bench_draw_buf, buf, NULL, buf_px);
+    lv_disp_drv_init(&bench_disp_drv);
+    bench_disp_drv.hor_res = w;
+    bench_disp_drv.ver_res = h;
+    bench_disp_drv.flush_cb = flush;
+    bench_disp_drv.draw_buf = &bench_draw_buf;
+    lv_disp_drv_register(&bench_disp_drv);
+
+    // same slider as the demo tabs
+    bench_slider = lv_slider_create(lv_scr_act());
+    lv_obj_set_size(bench_slider, 200, 10);
+    lv_obj_center(bench_slider);
+    lv_slider_set_value(bench_slider, 50, LV_ANIM_OFF);
+    lv_refr_now(NULL);
+
+    cycle_bench_add(BENCH_LVGL_NAME("lv_timer_idle"), bench_lv_timer_idle, NULL, 10, 1000);
+    cycle_bench_add(BENCH_LVGL_NAME("lv_slider_step"), bench_lv_slider_step, NULL, 10, 200);
+}
+
+#endif // _BENCH_LVGL_H
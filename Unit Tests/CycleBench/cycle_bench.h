@@ -0,0 +1,135 @@
+/*******************************************************************************
+ * Cycle-count microbenchmarks
+ * Named benchmarks are registered with cycle_bench_add() and run with a number
+ * of untimed warm-up calls followed by timed repetitions. Each repetition is
+ * timed on its own, the cost of reading the counter is subtracted, and the
+ * minimum, median and 99th percentile are reported, one line per benchmark:
+ *   CYC,<platform>,<name>,<reps>,<min>,<median>,<p99>,<ticks_per_us>
+ *   CYC,done,<benchmarks>
+ *
+ * Ticks are CPU cycles from the Xtensa CCOUNT register on the ESP32 (per
+ * core: run the benchmarks from one task, loop() is pinned to core 1) and
+ * nanoseconds from clock_gettime() on a host build. Divide by ticks_per_us to
+ * compare a host run with a device run.
+ ******************************************************************************/
+#ifndef _CYCLE_BENCH_H
+#define _CYCLE_BENCH_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define CYCLE_BENCH_MAX 16
+#define CYCLE_BENCH_MAX_REPS 1000
+
+typedef void (*cycle_bench_fn_t)(void *ctx);
+
+typedef struct
+{
+    const char *name;
+    cycle_bench_fn_t fn;
+    void *ctx;
+    uint16_t warmup;
+    uint16_t reps;
+} cycle_bench_t;
+
+/* Platform layer */
+#if defined(ARDUINO) && defined(__XTENSA__)
+#include <Arduino.h>
+#define CYCLE_BENCH_PLATFORM "esp32"
+static inline uint32_t cycle_bench_ticks()
+{
+    uint32_t c;
+    asm volatile("rsr %0, ccount" : "=a"(c));
+    return c;
+}
+static inline uint32_t cycle_bench_ticks_per_us() { return getCpuFrequencyMhz(); }
+#define CYCLE_BENCH_PRINTF Serial.printf
+#elif defined(ARDUINO)
+#include <Arduino.h>
+#define CYCLE_BENCH_PLATFORM "arduino"
+static inline uint32_t cycle_bench_ticks() { return micros(); }
+static inline uint32_t cycle_bench_ticks_per_us() { return 1; }
+#define CYCLE_BENCH_PRINTF Serial.printf
+#else
+#include <stdio.h>
+#include <time.h>
+#define CYCLE_BENCH_PLATFORM "host"
+static inline uint32_t cycle_bench_ticks()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+static inline uint32_t cycle_bench_ticks_per_us() { return 1000; }
+#define CYCLE_BENCH_PRINTF printf
+#endif
+
+static cycle_bench_t cycle_benches[CYCLE_BENCH_MAX];
+static uint8_t cycle_bench_count = 0;
+static uint32_t cycle_bench_samples[CYCLE_BENCH_MAX_REPS];
+
+bool cycle_bench_add(const char *name, cycle_bench_fn_t fn, void *ctx, uint16_t warmup, uint16_t reps)
+{
+    if (cycle_bench_count >= CYCLE_BENCH_MAX || !reps || reps > CYCLE_BENCH_MAX_REPS)
+        return false;
+    cycle_benches[cycle_bench_count++] = {name, fn, ctx, warmup, reps};
+    return true;
+}
+
+static int cycle_bench_cmp(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Cost of two back-to-back counter reads */
+static uint32_t cycle_bench_overhead()
+{
+    uint32_t best = UINT32_MAX;
+    for (int i = 0; i < 64; i++)
+    {
+        uint32_t t0 = cycle_bench_ticks();
+        uint32_t t1 = cycle_bench_ticks();
+        if (t1 - t0 < best)
+            best = t1 - t0;
+    }
+    return best;
+}
+
+void cycle_bench_run(const cycle_bench_t *b)
+{
+    uint32_t overhead = cycle_bench_overhead();
+    for (uint16_t i = 0; i < b->warmup; i++)
+        b->fn(b->ctx);
+    for (uint16_t i = 0; i < b->reps; i++)
+    {
+        uint32_t t0 = cycle_bench_ticks();
+        b->fn(b->ctx);
+        uint32_t t = cycle_bench_ticks() - t0;
+        cycle_bench_samples[i] = t > overhead ? t - overhead : 0;
+    }
+    qsort(cycle_bench_samples, b->reps, sizeof(cycle_bench_samples[0]), cycle_bench_cmp);
+    CYCLE_BENCH_PRINTF("CYC,%s,%s,%u,%u,%u,%u,%u\n", CYCLE_BENCH_PLATFORM, b->name, (unsigned)b->reps,
+                       (unsigned)cycle_bench_samples[0], (unsigned)cycle_bench_samples[b->reps / 2],
+                       (unsigned)cycle_bench_samples[b->reps * 99 / 100], (unsigned)cycle_bench_ticks_per_us());
+}
+
+/* Runs every registered benchmark whose name starts with prefix (NULL: all) */
+int cycle_bench_run_all(const char *prefix)
+{
+    int ran = 0;
+    for (uint8_t i = 0; i < cycle_bench_count; i++)
+    {
+        const char *n = cycle_benches[i].name, *p = prefix;
+        while (p && *p && *p == *n)
+            p++, n++;
+        if (p && *p)
+            continue;
+        cycle_bench_run(&cycle_benches[i]);
+        ran++;
+    }
+    CYCLE_BENCH_PRINTF("CYC,done,%d\n", ran);
+    return ran;
+}
+
+#endif // _CYCLE_BENCH_H
@@ -0,0 +1,163 @@
+/*******************************************************************************
+ * Host runner for the cycle benchmarks
+ * Same report lines as CycleBench.ino (cycle_bench.h). A name means the same
+ * code on both: benchmarks that run other code here are prefixed host_, so
+ * they are not compared line by line with the device's.
+ *   lv_timer_idle / lv_slider_step
+ *                bench_lvgl.h, shared with the sketch. On $DEMO/host/lvgl.h
+ *                they are host_lv_*; with the simulator's LVGL build first on
+ *                the include path they are LVGL's own code and keep the names
+ * Without the panel and touch controller, the CPU side of the device's
+ * flush_* and touch_read:
+ *   host_flush_half / host_flush_label
+ *                RGB565 pixels byte-swapped into a frame buffer, as the SPI
+ *                bus does before a transfer
+ *   host_touch_decode
+ *                decoding a GT911 status + point report and mapping it; the
+ *                report is re-read and its point moved on every repetition
+ * Host only, the device sketch cannot run these on the display board:
+ *   keypad_scan_idle / keypad_scan_held
+ *                one keypad_scan() of ESP32/keypad.h on its simulated matrix,
+ *                no key / '5' held: debounce and event logic, without the
+ *                GPIO reads and row settle time of the device
+ *   kws_mfcc     one 20 ms hop of the keyword spotter front-end (ESP32/kws.h)
+ *   audio_meter_block
+ *                one 16 ms block through the spectrum meter: queue push,
+ *                analysis and publish (audio_meter.h)
+ * The audio benchmarks are the CPU work behind each I2S read; i2s_read()
+ * itself and the int32 -> int16 conversion of the capture tasks are device
+ * code and not timed. From this folder, with
+ * DEMO=../../../Touch_dispay_Widgets_LVGL_Capacitive_gt911-main/LvglWidgets_Capacitive_gt911:
+ *   g++ -O2 -I../../../ESP32 -I../../../libraries/q15_dsp/src -I$DEMO/host -I$DEMO \
+ *       -o cycle_bench_host cycle_bench_host.cpp
+ * or, for LVGL's own lv_* lines, the simulator's LVGL build in place of $DEMO/host:
+ *   g++ -O2 -I<lvgl dir> -I<lv_conf dir> -I../../../ESP32 -I../../../libraries/q15_dsp/src \
+ *       -I$DEMO -o cycle_bench_host cycle_bench_host.cpp <liblvgl>
+ * ../cycle_bench_report.txt has a host run next to the device's lines.
+ ******************************************************************************/
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../cycle_bench.h"
+#include "../bench_lvgl.h"
+#include "audio_meter.h"
+#include "keypad.h"
+#include "kws.h"
+
+#define SCREEN_W 320
+#define SCREEN_H 240
+
+static uint16_t frame_buffer[SCREEN_W * SCREEN_H];
+static uint16_t bench_pixels[SCREEN_W * SCREEN_H / 2];
+
+static void host_flush(int32_t x, int32_t y, const uint16_t *px, int32_t w, int32_t h)
+{
+    for (int32_t row = 0; row < h; row++)
+    {
+        uint16_t *dst = &frame_buffer[(y + row) * SCREEN_W + x];
+        for (int32_t col = 0; col < w; col++, px++)
+            dst[col] = (uint16_t)(*px << 8 | *px >> 8);
+    }
+}
+
+static void bench_host_flush_half(void *) { host_flush(0, 0, bench_pixels, SCREEN_W, SCREEN_H / 2); }
+
+static void bench_host_flush_label(void *) { host_flush(140, 60, bench_pixels, 40, 20); }
+
+volatile int touch_last_x, touch_last_y;
+
+/* GT911 report: status byte, then 8 bytes per point (id, x, y, size, reserved).
+   Raw (120, 160) maps to screen (159, 119); volatile, so the compiler cannot
+   fold the decode, and raw x steps through 88..151 to vary the result */
+static volatile uint8_t touch_report[1 + 5 * 8] = {0x81, 0, 0x78, 0x00, 0xA0, 0x00, 0x20, 0x00, 0x00};
+
+static void bench_host_touch_decode(void *)
+{
+    static uint8_t step = 0;
+    touch_report[2] = (uint8_t)(0x58 + (step++ & 0x3F));
+    uint8_t touches = touch_report[0] & 0x0F;
+    if ((touch_report[0] & 0x80) && touches)
+    {
+        const volatile uint8_t *p = &touch_report[1];
+        int px = p[1] | p[2] << 8, py = p[3] | p[4] << 8;
+        // rotation, then the TOUCH_MAP_* scaling of touch_touched()
+        int rx = SCREEN_W - py, ry = px;
+        touch_last_x = (rx - 320) * (SCREEN_W - 1) / (0 - 320);
+        touch_last_y = (ry - 240) * (SCREEN_H - 1) / (0 - 240);
+    }
+}
+
+/* Scan with the given key state; ctx: the key held, NULL for none */
+static void bench_keypad_scan(void *ctx)
+{
+    keypad_sim_set_key(1, 1, ctx != NULL);
+    keypad_scan();
+    keypad_event_t ev;
+    while (keypad_get_event(&ev))
+        ;
+}
+
+static int16_t bench_audio[KWS_FFT_LEN];   // speech-like test signal
+
+static void bench_kws_mfcc(void *)
+{
+    int32_t mfcc[KWS_MFCC], e;
+    kws_mfcc(bench_audio, mfcc, &e);
+}
+
+static void bench_audio_meter_block(void *)
+{
+    audio_meter_push(bench_audio, AUDIO_METER_BLOCK);
+    audio_meter_analyze();
+}
+
+static lv_color_t bench_lv_buf[SCREEN_W * SCREEN_H / 2];
+
+/* Tick for an lv_conf.h with LV_TICK_VIRTUAL, and for host/lvgl.h */
+extern "C" uint32_t lv_virtual_millis(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static void bench_disp_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p)
+{
+    host_flush(area->x1, area->y1, (const uint16_t *)&color_p->full, area->x2 - area->x1 + 1, area->y2 - area->y1 + 1);
+    lv_disp_flush_ready(disp);
+}
+
+int main(int argc, char **argv)
+{
+    for (uint32_t i = 0; i < SCREEN_W * SCREEN_H / 2; i++)
+        bench_pixels[i] = (uint16_t)(i * 2654435761u >> 16);
+
+    cycle_bench_add("host_flush_half", bench_host_flush_half, NULL, 3, 50);
+    cycle_bench_add("host_flush_label", bench_host_flush_label, NULL, 10, 500);
+    cycle_bench_add("host_touch_decode", bench_host_touch_decode, NULL, 5, 200);
+
+    static const char held = '5';
+    keypad_init();
+    cycle_bench_add("keypad_scan_idle", bench_keypad_scan, NULL, 10, 500);
+    cycle_bench_add("keypad_scan_held", bench_keypad_scan, (void *)&held, 10, 500);
+
+    uint32_t pos = 0;
+    audio_meter_synth(bench_audio, KWS_FFT_LEN, &pos);
+    kws_frontend_init();
+    audio_meter_begin();
+    cycle_bench_add("kws_mfcc", bench_kws_mfcc, NULL, 5, 200);
+    cycle_bench_add("audio_meter_block", bench_audio_meter_block, NULL, 5, 200);
+#ifdef _HOST_LVGL_H
+    lv_sim_tick_ms = lv_virtual_millis;
+#endif
+    bench_lvgl_begin(SCREEN_W, SCREEN_H, bench_lv_buf, SCREEN_W * SCREEN_H / 2, bench_disp_flush);
+
+    bool ok = cycle_bench_run_all(argc > 1 ? argv[1] : NULL);
+    // the last decoded point has to be on the screen
+    if (touch_last_x < 0 || touch_last_x >= SCREEN_W || touch_last_y < 0 || touch_last_y >= SCREEN_H)
+    {
+        printf("CYC,error,touch decoded to (%d, %d)\n", touch_last_x, touch_last_y);
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
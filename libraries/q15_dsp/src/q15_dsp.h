@@ -0,0 +1,121 @@
+/*******************************************************************************
+ * Fixed-point DSP shared by the audio code
+ * The spectrum meter (LvglWidgets_Capacitive_gt911/audio_meter.h) and the
+ * keyword spotter (ESP32/kws.h) run the same integer front-end; it lives here
+ * once so the two sketches cannot drift apart. Copy this folder to your
+ * Arduino libraries folder, like the LVGL/GFX libraries (see INSTALLING
+ * LIBRARIES.txt); host tools add -I<repo>/libraries/q15_dsp/src.
+ *
+ *   q15_hann(w, n)             Hann window, Q15
+ *   q15_twiddles(c, s, n)      cos / sin of 2*pi*k/n for k < n/2, Q15
+ *   q15_fft(re, im, bits, c, s, mode)
+ *                              in-place radix-2 complex FFT of n = 1 << bits
+ *                              points with those twiddles; returns the
+ *                              exponent, true spectrum = output * 2^exp
+ *       Q15_FFT_SCALED         halves every stage: exp is always `bits`, no
+ *                              data-dependent work (levels on a fixed scale)
+ *       Q15_FFT_BLOCK_FLOAT    halves (or quarters) a stage only when it could
+ *                              overflow: quiet input keeps its precision
+ *   q15_log2_q8(x)             log2(x) in Q8 (256 = 3 dB of power), x >= 1
+ *
+ * Tables are built once with floating point; everything per block is integer.
+ ******************************************************************************/
+#ifndef _Q15_DSP_H
+#define _Q15_DSP_H
+
+#include <stdint.h>
+#include <math.h>
+
+#define Q15_FFT_SCALED 0
+#define Q15_FFT_BLOCK_FLOAT 1
+
+static const uint16_t q15_log2_tab[33] = {0, 11, 22, 33, 44, 54, 63, 73, 82, 92, 100,
+                                          109, 118, 126, 134, 142, 150, 157, 165, 172, 179, 186,
+                                          193, 200, 207, 213, 220, 226, 232, 238, 244, 250, 256};
+
+/* log2(x) in Q8, x >= 1; 0 for 0 */
+static inline int32_t q15_log2_q8(uint64_t x)
+{
+    if (!x)
+        return 0;
+    int msb = 63 - __builtin_clzll(x);
+    uint32_t m = msb >= 16 ? (uint32_t)(x >> (msb - 16)) : (uint32_t)(x << (16 - msb));
+    uint32_t f = m - 65536, i = f >> 11, r = f & 2047;
+    return msb * 256 + q15_log2_tab[i] + (((q15_log2_tab[i + 1] - q15_log2_tab[i]) * r) >> 11);
+}
+
+static void q15_hann(int16_t *w, uint16_t n)
+{
+    const float pi = 3.14159265358979f;
+    for (uint16_t i = 0; i < n; i++)
+        w[i] = (int16_t)lrintf(32767.0f * (0.5f - 0.5f * cosf(2 * pi * i / n)));
+}
+
+static void q15_twiddles(int16_t *cos_tab, int16_t *sin_tab, uint16_t n)
+{
+    const float pi = 3.14159265358979f;
+    for (uint16_t k = 0; k < n / 2; k++)
+    {
+        cos_tab[k] = (int16_t)lrintf(32767.0f * cosf(2 * pi * k / n));
+        sin_tab[k] = (int16_t)lrintf(32767.0f * sinf(2 * pi * k / n));
+    }
+}
+
+static int q15_fft(int16_t *re, int16_t *im, uint8_t bits, const int16_t *cos_tab, const int16_t *sin_tab,
+                   uint8_t mode)
+{
+    const uint16_t n = 1 << bits;
+    for (uint16_t i = 1, j = 0; i < n; i++)
+    {
+        uint16_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+        {
+            int16_t t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+        }
+    }
+
+    int exp = 0;
+    for (uint16_t half = 1, step = n / 2; half < n; half <<= 1, step >>= 1)
+    {
+        uint8_t sh = 1;
+        if (mode == Q15_FFT_BLOCK_FLOAT)
+        {
+            // a butterfly grows a component by up to 1 + sqrt(2)
+            int32_t peak = 0;
+            for (uint16_t i = 0; i < n; i++)
+            {
+                int32_t a = re[i] < 0 ? -re[i] : re[i], b = im[i] < 0 ? -im[i] : im[i];
+                peak = a > peak ? a : peak;
+                peak = b > peak ? b : peak;
+            }
+            sh = peak > 27146 ? 2 : peak > 13573 ? 1 : 0;
+        }
+        exp += sh;
+        for (uint16_t k = 0; k < half; k++)
+        {
+            int32_t c = cos_tab[k * step], s = sin_tab[k * step];
+            for (uint16_t i = k; i < n; i += 2 * half)
+            {
+                uint16_t j = i + half;
+                int32_t tr = (re[j] * c + im[j] * s + (1 << 14)) >> 15;
+                int32_t ti = (im[j] * c - re[j] * s + (1 << 14)) >> 15;
+                int32_t ar = re[i], ai = im[i];
+                re[i] = (int16_t)((ar + tr) >> sh);
+                im[i] = (int16_t)((ai + ti) >> sh);
+                re[j] = (int16_t)((ar - tr) >> sh);
+                im[j] = (int16_t)((ai - ti) >> sh);
+            }
+        }
+    }
+    return exp;
+}
+
+#endif // _Q15_DSP_H
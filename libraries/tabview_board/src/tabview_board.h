@@ -0,0 +1,37 @@
+/*******************************************************************************
+ * Display and touch setup of the LVGL tabview demo board
+ * LvglWidgets_Capacitive_gt911 and Unit Tests/CycleBench both include this, so
+ * the benchmarks measure the demo's own panel, bus clock and touch mapping.
+ * Copy this folder to your Arduino libraries folder, like libraries/q15_dsp
+ * (see INSTALLING LIBRARIES.txt). Include it once per sketch: it defines the
+ * panel objects.
+ *
+ *   bus, gfx            ST7789 320x240 on SPI, landscape (rotation 3)
+ *   TFT_SPI_HZ          SPI clock for gfx->begin()
+ *   TFT_BL              backlight pin
+ *   TOUCH_GT911_*       GT911 pins and rotation
+ *   TOUCH_MAP_*         raw GT911 range -> screen, as touch_touched() maps it
+ ******************************************************************************/
+#ifndef _TABVIEW_BOARD_H
+#define _TABVIEW_BOARD_H
+
+#include <Arduino_GFX_Library.h>
+
+/* Display */
+#define TFT_BL 27
+#define TFT_SPI_HZ 80000000
+Arduino_DataBus *bus = new Arduino_ESP32SPI(2 /* DC */, 15 /* CS */, 14 /* SCK */, 13 /* MOSI */, GFX_NOT_DEFINED /* MISO */);
+Arduino_GFX *gfx = new Arduino_ST7789(bus, -1 /* RST */, 3 /* rotation */, true /* IPS */);
+
+/* GT911 touch */
+#define TOUCH_GT911_SCL 32
+#define TOUCH_GT911_SDA 33
+#define TOUCH_GT911_INT -1
+#define TOUCH_GT911_RST 25
+#define TOUCH_GT911_ROTATION ROTATION_RIGHT
+#define TOUCH_MAP_X1 320
+#define TOUCH_MAP_X2 0
+#define TOUCH_MAP_Y1 240
+#define TOUCH_MAP_Y2 0
+
+#endif // _TABVIEW_BOARD_H